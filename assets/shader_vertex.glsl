@@ -5,6 +5,17 @@
 layout (location = 0) in vec4 model_coefficients;
 layout (location = 1) in vec4 color_coefficients;
 
+// Transformação de cada instância (partículas), lida do buffer de streaming
+// nos desenhos instanciados. Nos outros desenhos o atributo não está
+// habilitado e vale a identidade (veja main.cpp).
+layout (location = 4) in mat4 instance_model;
+
+// Os atributos podem estar armazenados em formatos compactos (half float,
+// inteiros normalizados de 16 e 8 bits, 10_10_10_2; veja "vertexformat.h"):
+// a GPU os converte para float ao ler cada vértice. Posições quantizadas
+// contra a caixa envolvente do modelo chegam aqui em [0, 1] e são
+// decodificadas pela matriz "model" (veja mesh::GpuMesh em "meshcache.h").
+
 // Atributos de vértice que serão gerados como saída ("out") pelo Vertex Shader.
 // ** Estes serão interpolados pelo rasterizador! ** gerando, assim, valores
 // para cada fragmento, os quais serão recebidos como entrada pelo Fragment
@@ -32,7 +43,7 @@ void main()
     // deste Vertex Shader, a placa de vídeo (GPU) fará a divisão por W. Veja
     // slides 41-67 e 69-86 do documento Aula_09_Projecoes.pdf.
 
-    gl_Position = projection * view * model * model_coefficients;
+    gl_Position = projection * view * model * instance_model * model_coefficients;
 
     // Como as variáveis acima  (tipo vec4) são vetores com 4 coeficientes,
     // também é possível acessar e modificar cada coeficiente de maneira
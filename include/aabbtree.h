@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include <stdint.h>
+
+#include "collisions.h"
+
+namespace collision {
+    // Bounding volume tree for moving objects. Each leaf stores a "fat" box,
+    // the object's bounds grown by a margin, so small moves do not touch the
+    // tree. Inserts pick the sibling that grows the surface area the least
+    // and rotations keep the tree balanced. Nodes live in a pool with a free
+    // list: no allocation per node.
+    class AabbTree {
+    public:
+        static const int32_t NULL_NODE = -1;
+
+        explicit AabbTree(float margin = 0.1f) : margin(margin) {}
+
+        // Returns the proxy of the object, valid until remove().
+        int32_t insert(const Cube &bounds, uint32_t userData);
+        void remove(int32_t proxy);
+        // Returns true when "bounds" left the fat box and the leaf was
+        // reinserted.
+        bool move(int32_t proxy, const Cube &bounds);
+
+        const Cube &fatBounds(int32_t proxy) const { return nodes[proxy].box; }
+        uint32_t userData(int32_t proxy) const { return nodes[proxy].userData; }
+
+        // Calls "callback(proxy)" for every leaf whose fat box intersects
+        // "box". The callback returns false to stop the query.
+        template <typename Callback>
+        void query(const Cube &box, Callback callback) const;
+
+        // Calls "callback(proxy, tMax)" for every leaf whose fat box "ray"
+        // enters before "tMax", returning the new tMax: returning the
+        // distance of a hit culls everything behind it, 0 stops the ray.
+        template <typename Callback>
+        void raycast(const Ray &ray, float tMax, Callback callback) const;
+
+        size_t leafCount() const { return leaves; }
+        int height() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+        // Total surface of the inner nodes over that of the root: lower is
+        // a better tree.
+        float areaRatio() const;
+
+    private:
+        struct Node {
+            Cube box;
+            uint32_t userData;
+            // Parent, or next free node while in the free list
+            int32_t parent;
+            int32_t child1;
+            int32_t child2;
+            // 0 for leaves, -1 for free nodes
+            int32_t height;
+
+            bool isLeaf() const { return child1 == NULL_NODE; }
+        };
+
+        int32_t allocateNode();
+        void freeNode(int32_t node);
+        void insertLeaf(int32_t leaf);
+        void removeLeaf(int32_t leaf);
+        int32_t balance(int32_t node);
+        void refit(int32_t node);
+
+        float margin;
+        std::vector<Node> nodes;
+        int32_t root = NULL_NODE;
+        int32_t freeList = NULL_NODE;
+        size_t leaves = 0;
+    };
+
+    // Moves, removes and inserts 5000 boxes at random for a few frames and
+    // checks query() and raycast() against testing every box.
+    void benchmarkAabbTree();
+
+    namespace _internal {
+        inline bool overlaps(const Cube &a, const Cube &b) {
+            return a.positionMin.x <= b.positionMax.x && a.positionMax.x >= b.positionMin.x &&
+                   a.positionMin.y <= b.positionMax.y && a.positionMax.y >= b.positionMin.y &&
+                   a.positionMin.z <= b.positionMax.z && a.positionMax.z >= b.positionMin.z;
+        }
+
+        // Ray parameter where the ray enters "box", or infinity when it
+        // misses it or enters past "tMax".
+        inline float entryDistance(const Cube &box, const Ray &ray, const float *inverse, float tMax) {
+            const float origin[3] = {ray.startPosition.x, ray.startPosition.y, ray.startPosition.z};
+            const float boundsMin[3] = {box.positionMin.x, box.positionMin.y, box.positionMin.z};
+            const float boundsMax[3] = {box.positionMax.x, box.positionMax.y, box.positionMax.z};
+            float tNear = 0.0f;
+            float tFar = tMax;
+            for (int k = 0; k < 3; k++) {
+                float t1 = (boundsMin[k] - origin[k]) * inverse[k];
+                float t2 = (boundsMax[k] - origin[k]) * inverse[k];
+                tNear = std::fmax(tNear, std::fmin(t1, t2));
+                tFar = std::fmin(tFar, std::fmax(t1, t2));
+            }
+            return tNear <= tFar ? tNear : std::numeric_limits<float>::infinity();
+        }
+
+        // Traversal stack kept in place, moving to the heap only when a
+        // query outgrows it.
+        class NodeStack {
+        public:
+            NodeStack() : data(local), capacity(LOCAL_SIZE) {}
+
+            void push(int32_t node) {
+                if (count == capacity) {
+                    std::vector<int32_t> larger(capacity * 2);
+                    std::copy(data, data + count, larger.begin());
+                    heap.swap(larger);
+                    data = heap.data();
+                    capacity = heap.size();
+                }
+                data[count++] = node;
+            }
+            int32_t pop() { return data[--count]; }
+            bool empty() const { return count == 0; }
+
+        private:
+            NodeStack(const NodeStack &);
+            NodeStack &operator=(const NodeStack &);
+
+            static const size_t LOCAL_SIZE = 64;
+            int32_t local[LOCAL_SIZE];
+            std::vector<int32_t> heap;
+            int32_t *data;
+            size_t capacity;
+            size_t count = 0;
+        };
+    }
+
+    // The tree stays balanced, so its height grows with the logarithm of the
+    // leaf count and the stack rarely leaves its in-place storage.
+    template <typename Callback>
+    void AabbTree::query(const Cube &box, Callback callback) const {
+        _internal::NodeStack stack;
+        if (root != NULL_NODE) {
+            stack.push(root);
+        }
+        while (!stack.empty()) {
+            int32_t index = stack.pop();
+            const Node &node = nodes[index];
+            if (!_internal::overlaps(node.box, box)) {
+                continue;
+            }
+            if (node.isLeaf()) {
+                if (!callback(index)) {
+                    return;
+                }
+            } else {
+                stack.push(node.child1);
+                stack.push(node.child2);
+            }
+        }
+    }
+
+    template <typename Callback>
+    void AabbTree::raycast(const Ray &ray, float tMax, Callback callback) const {
+        const float inverse[3] = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+        _internal::NodeStack stack;
+        if (root != NULL_NODE) {
+            stack.push(root);
+        }
+        while (!stack.empty()) {
+            int32_t index = stack.pop();
+            const Node &node = nodes[index];
+            if (_internal::entryDistance(node.box, ray, inverse, tMax) == std::numeric_limits<float>::infinity()) {
+                continue;
+            }
+            if (node.isLeaf()) {
+                tMax = callback(index, tMax);
+                if (tMax <= 0.0f) {
+                    return;
+                }
+            } else {
+                stack.push(node.child1);
+                stack.push(node.child2);
+            }
+        }
+    }
+}
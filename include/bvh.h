@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include <stdint.h>
+
+#include "glm/mat4x4.hpp"
+
+#include "collisions.h"
+#include "raytriangle.h"
+
+namespace collision {
+    // Bounding volume hierarchy over axis aligned boxes, built top-down with
+    // the binned surface area heuristic. Nodes are stored depth first with
+    // both children of a node next to each other.
+    class Bvh {
+    public:
+        struct Node {
+            float boundsMin[3];
+            uint32_t leftOrFirst;  // First child, or first slot of a leaf
+            float boundsMax[3];
+            uint32_t count;        // Primitives of a leaf, 0 for inner nodes
+        };
+
+        // Leaves are at most this deep (the root is at depth 0), so a
+        // traversal stack of MAX_DEPTH + 1 entries never overflows.
+        static const int MAX_DEPTH = 63;
+
+        // Leaves hold up to "leafSize" primitives, more only when the
+        // surface area heuristic finds splitting them does not pay or the
+        // leaf is at MAX_DEPTH.
+        void build(const std::vector<Cube> &bounds, uint32_t leafSize = 4);
+
+        const std::vector<Node> &nodes() const { return tree; }
+        // Primitive stored at each slot; leaves cover consecutive slots.
+        const std::vector<uint32_t> &primitives() const { return order; }
+
+        // Visits the leaves hit by "ray" closer than "tMax", nearest child
+        // first. "leaf(slot, tMax)" returns the new tMax, which lets a hit
+        // cull everything behind it.
+        template <typename LeafFunction>
+        void traverse(const Ray &ray, float &tMax, LeafFunction leaf) const;
+        // Same, once per leaf: "leaf(node, tMax)" gets the index of the
+        // leaf node, for callers that test all its primitives at once.
+        template <typename LeafFunction>
+        void traverseLeaves(const Ray &ray, float &tMax, LeafFunction leaf) const;
+
+    private:
+        void subdivide(uint32_t node, uint32_t first, uint32_t count, uint32_t leafSize, int depth,
+                       const std::vector<Cube> &bounds, const std::vector<Point> &centroids);
+
+        std::vector<Node> tree;
+        std::vector<uint32_t> order;
+    };
+
+    // Result of a scene raycast.
+    struct RaycastHit {
+        float t;             // Ray parameter of the hit
+        uint32_t object;     // Id given to SceneBvh::add()
+        uint32_t triangle;   // Triangle (index / 3) in the object's mesh
+        Point position;      // World space
+    };
+
+    // Triangles of one mesh, in object space.
+    class TriangleBvh {
+    public:
+        // "indices" holds 3 vertex indices per triangle into "positions"
+        // (x, y, z per vertex).
+        void build(const float *positions, const uint32_t *indices, size_t triangleCount);
+
+        // Nearest triangle hit closer than "tMax"; updates "tMax".
+        bool raycast(const Ray &ray, float &tMax, uint32_t &triangle) const;
+
+        size_t triangleCount() const { return count; }
+        const Cube &bounds() const { return box; }
+
+    private:
+        Bvh bvh;
+        // Every leaf owns whole blocks, tested by intersect() in one call;
+        // leafBlocks gives the first block of each leaf node.
+        std::vector<TriangleBlock> blocks;
+        std::vector<uint32_t> leafBlocks;
+        // Triangle of each block lane, UINT32_MAX for padding.
+        std::vector<uint32_t> ids;
+        size_t count = 0;
+        Cube box;
+    };
+
+    // Two levels: a BVH over object bounds whose leaves hold the meshes'
+    // triangle BVHs, instanced with a model matrix.
+    class SceneBvh {
+    public:
+        void clear();
+        // "model" maps the object space of "mesh" to world space. "mesh"
+        // must outlive the scene BVH.
+        void add(const TriangleBvh *mesh, const glm::mat4 &model, uint32_t id);
+        void build();
+
+        // Nearest triangle hit by "ray" (t >= 0).
+        bool raycast(const Ray &ray, RaycastHit &hit) const;
+
+        size_t objectCount() const { return objects.size(); }
+        size_t triangleCount() const;
+
+        // BVH over the objects' world bounds; its primitives index the
+        // objects in the order they were added.
+        const Bvh &hierarchy() const { return bvh; }
+        const Cube &objectBounds(uint32_t object) const { return objects[object].bounds; }
+        uint32_t objectId(uint32_t object) const { return objects[object].id; }
+
+    private:
+        struct Object {
+            const TriangleBvh *mesh;
+            glm::mat4 worldToObject;
+            uint32_t id;
+            Cube bounds;  // World space
+        };
+
+        std::vector<Object> objects;
+        Bvh bvh;
+    };
+
+    namespace _internal {
+        // Distance along "ray" at which it enters the box, or infinity when
+        // it misses it or enters past "tMax".
+        inline float entryDistance(const Bvh::Node &node, const float *origin, const float *inverse, float tMax) {
+            float tNear = 0.0f;
+            float tFar = tMax;
+            for (int k = 0; k < 3; k++) {
+                float t1 = (node.boundsMin[k] - origin[k]) * inverse[k];
+                float t2 = (node.boundsMax[k] - origin[k]) * inverse[k];
+                tNear = std::fmax(tNear, std::fmin(t1, t2));
+                tFar = std::fmin(tFar, std::fmax(t1, t2));
+            }
+            return tNear <= tFar ? tNear : std::numeric_limits<float>::infinity();
+        }
+    }
+
+    template <typename LeafFunction>
+    void Bvh::traverse(const Ray &ray, float &tMax, LeafFunction leaf) const {
+        traverseLeaves(ray, tMax, [&](uint32_t node, float limit) {
+            for (uint32_t i = 0; i < tree[node].count; i++) {
+                limit = leaf(tree[node].leftOrFirst + i, limit);
+            }
+            return limit;
+        });
+    }
+
+    template <typename LeafFunction>
+    void Bvh::traverseLeaves(const Ray &ray, float &tMax, LeafFunction leaf) const {
+        if (tree.empty()) {
+            return;
+        }
+        const float origin[3] = {ray.startPosition.x, ray.startPosition.y, ray.startPosition.z};
+        const float inverse[3] = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+
+        // Every entry is the far child of a different level, plus the near
+        // one on top: the stack never outgrows the tree depth.
+        const int STACK_SIZE = MAX_DEPTH + 1;
+        uint32_t stack[STACK_SIZE];
+        float entries[STACK_SIZE];
+        int size = 0;
+
+        float rootEntry = _internal::entryDistance(tree[0], origin, inverse, tMax);
+        if (rootEntry == std::numeric_limits<float>::infinity()) {
+            return;
+        }
+        stack[size] = 0;
+        entries[size++] = rootEntry;
+
+        while (size > 0) {
+            size--;
+            // A closer hit may have been found since this node was pushed.
+            if (entries[size] > tMax) {
+                continue;
+            }
+            const Node &node = tree[stack[size]];
+            if (node.count > 0) {
+                tMax = leaf(stack[size], tMax);
+                continue;
+            }
+
+            uint32_t near = node.leftOrFirst;
+            uint32_t far = node.leftOrFirst + 1;
+            float nearEntry = _internal::entryDistance(tree[near], origin, inverse, tMax);
+            float farEntry = _internal::entryDistance(tree[far], origin, inverse, tMax);
+            if (farEntry < nearEntry) {
+                std::swap(near, far);
+                std::swap(nearEntry, farEntry);
+            }
+            // The far child goes first on the stack so the near one pops
+            // first.
+            if (farEntry != std::numeric_limits<float>::infinity()) {
+                stack[size] = far;
+                entries[size++] = farEntry;
+            }
+            if (nearEntry != std::numeric_limits<float>::infinity()) {
+                stack[size] = near;
+                entries[size++] = nearEntry;
+            }
+        }
+    }
+}
@@ -36,7 +36,53 @@ namespace game {
         float bezierTime = 2.0f;
         float bezierDuration = 5.0f;
 
+        // The matrices are only rebuilt when the fields they depend on
+        // changed since the last call; see version().
         void computeMatrices(glm::mat4 &view, glm::mat4 &projection);
         void onUpdate(float deltaTime);
+
+        // Results of the last computeMatrices()
+        const glm::mat4 &viewMatrix() const { return cache.view; }
+        const glm::mat4 &projectionMatrix() const { return cache.projection; }
+        const glm::mat4 &viewProjectionMatrix() const { return cache.viewProjection; }
+        const glm::mat4 &inverseViewMatrix() const { return cache.inverseView; }
+        const glm::mat4 &inverseProjectionMatrix() const { return cache.inverseProjection; }
+        const glm::mat4 &inverseViewProjectionMatrix() const { return cache.inverseViewProjection; }
+
+        // Incremented by computeMatrices() whenever it rebuilds a matrix.
+        // Code that derives data from the matrices (uniforms, culling) can
+        // skip the work while it is unchanged. Starts at 0, before any
+        // matrix exists.
+        unsigned long version() const { return cache.version; }
+
+    private:
+        // The fields are public and changed all over, so instead of
+        // setters marking the matrices dirty, the inputs of the last
+        // rebuild are kept and compared.
+        struct ViewInputs {
+            bool isLookAt;
+            bool followsBezier;
+            float distance, theta, phi;
+            glm::vec4 position, lookAtPoint, upVector;
+
+            bool operator==(const ViewInputs &other) const;
+        };
+        struct ProjectionInputs {
+            bool usePerspectiveProjection;
+            float distance, field_of_view, screenRatio, nearPlane, farPlane;
+
+            bool operator==(const ProjectionInputs &other) const;
+        };
+        ViewInputs viewInputs() const;
+        ProjectionInputs projectionInputs() const;
+
+        struct Cache {
+            unsigned long version = 0;
+            ViewInputs lastView;
+            ProjectionInputs lastProjection;
+            glm::mat4 view, projection, viewProjection;
+            glm::mat4 inverseView, inverseProjection, inverseViewProjection;
+            glm::vec4 viewVector;
+        } cache;
     };
 }
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+#include "collisions.h"
+
+// Batch versions of the tests in collisions.h: one shape against "count"
+// shapes stored as structure of arrays, 4 at a time with SSE. They compare
+// squared distances instead of taking square roots, so they can only differ
+// from the scalar functions (which remain the reference) by rounding right
+// at the border.
+namespace collision {
+    // Arrays are not owned; each one holds "count" values.
+    struct PointArrays {
+        const float *x, *y, *z;
+    };
+
+    struct SphereArrays {
+        const float *x, *y, *z, *r;
+    };
+
+    struct CubeArrays {
+        const float *minX, *minY, *minZ;
+        const float *maxX, *maxY, *maxZ;
+    };
+
+    // Bitmasks hold one bit per element: bit i % 32 of word i / 32. Callers
+    // provide maskWords(count) words.
+    inline size_t maskWords(size_t count) { return (count + 31) / 32; }
+    inline bool maskBit(const uint32_t *mask, size_t i) { return (mask[i / 32] >> (i % 32)) & 1u; }
+
+    // Points inside the sphere, as check(Sphere&, Point&)
+    void check(const Sphere &sphere, const PointArrays &points, size_t count, uint32_t *mask);
+
+    // Points inside the box (borders included)
+    void check(const Cube &cube, const PointArrays &points, size_t count, uint32_t *mask);
+
+    // Boxes that intersect the box, as check(Cube&, Cube&)
+    void check(const Cube &cube, const CubeArrays &cubes, size_t count, uint32_t *mask);
+
+    // Boxes that intersect the plane, as check(Cube&, Plane&)
+    void check(const Plane &plane, const CubeArrays &cubes, size_t count, uint32_t *mask);
+
+    // Spheres that intersect the box
+    void check(const Cube &cube, const SphereArrays &spheres, size_t count, uint32_t *mask);
+
+    // Spheres that intersect the sphere
+    void check(const Sphere &sphere, const SphereArrays &spheres, size_t count, uint32_t *mask);
+
+    // Slab test of the ray against each box. "distances" receives the ray
+    // parameter where the ray enters the box (0 when it starts inside), or
+    // the negative infinity of float when it misses the box or the box is
+    // behind the ray.
+    void collide(const Ray &ray, const CubeArrays &cubes, size_t count, float *distances);
+
+    // Swept tests for one time step, in which each point or sphere moves by
+    // "motion". "times" receives the fraction of the step at which it
+    // reaches the plane (from either side), using the ray formulation of
+    // collide(Plane&, Ray&) with the motion as the ray's direction. Values in
+    // [0, 1] are contacts during the step; anything else means no contact,
+    // with the negative infinity of float for motion parallel to the plane.
+    // Spheres already touching the plane get 0.
+    void collide(const Plane &plane, const PointArrays &points, const PointArrays &motion, size_t count, float *times);
+    void collide(const Plane &plane, const SphereArrays &spheres, const PointArrays &motion, size_t count, float *times);
+}
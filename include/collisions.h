@@ -1,3 +1,5 @@
+#pragma once
+
 namespace collision {
     // Ponto ou vertor no espaço tridimensional
     struct Point {
@@ -32,6 +34,11 @@ namespace collision {
         Point at(float t);
     };
 
+    // Triângulo com vértices em sentido anti-horário
+    struct Triangle {
+        Point a, b, c;
+    };
+
     // Verifica se os cubos se intersectam
      bool check(Cube &cube1, Cube &cube2);
 
@@ -46,4 +53,10 @@ namespace collision {
     // - Caso o plano esteja atrás do raio, o retorna é negativo
     // - Caso o raio seja paralelo ao plano, o retorno é o infinito negativo de float
     float collide(Plane &plane, Ray &ray);
+
+    // Calcula quando o raio intersecciona o triângulo (Möller–Trumbore)
+    // - Caso o raio interseccione o triângulo, o retorno é o parâmetro do raio
+    //   no ponto de intersecção (negativo se estiver atrás do raio)
+    // - Caso contrário, o retorno é o infinito negativo de float
+    float collide(const Triangle &triangle, const Ray &ray);
 }
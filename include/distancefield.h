@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "collisionbatch.h"
+#include "collisions.h"
+
+namespace collision {
+    // On-disk layout of a baked field: this header, then the distances as
+    // floats, x fastest.
+    struct DistanceFieldHeader {
+        char magic[4];
+        uint32_t version;
+        // Hash of the source mesh (see mesh::hashFile())
+        uint64_t sourceHash;
+        uint32_t resolution;
+        uint32_t size[3];
+        float origin[3];
+        float cellSize;
+    };
+
+    const uint32_t DISTANCE_FIELD_VERSION = 1;
+
+    // Signed distance to a mesh, sampled on a regular grid around it in the
+    // mesh's object space. Negative inside.
+    class DistanceField {
+    public:
+        // Bakes the distances of the triangles ("indices" holds 3 vertex
+        // indices per triangle into "positions", x, y, z per vertex).
+        // "resolution" cells cover the longest side of the mesh's bounds and
+        // the grid extends a few cells past them. The sign comes from the
+        // parity of ray crossings along the three axes (majority vote), so
+        // small holes in the mesh are tolerated. Slices are split across
+        // "threads" threads (0 = one per core).
+        void bake(const float *positions, const uint32_t *indices, size_t triangleCount,
+                  uint32_t resolution, unsigned threads = 0);
+
+        bool save(const std::string &path, uint64_t sourceHash) const;
+        // Fails when the file is missing, invalid or was baked from another
+        // source or at another resolution.
+        bool load(const std::string &path, uint64_t sourceHash, uint32_t resolution);
+
+        // Trilinear sample at "point". Outside the grid, the distance to the
+        // grid is added to the sample at the nearest point of the grid.
+        // "gradient" (may be null) receives the derivative of the
+        // interpolation, which points away from the surface. An empty field
+        // (no triangles) gives infinity and a zero gradient.
+        float sample(const Point &point, Point *gradient = nullptr) const;
+
+        // sample() for "count" points, 4 at a time with SSE. The gradient
+        // arrays may be null.
+        void sample(const PointArrays &points, size_t count, float *distances,
+                    float *gradientX = nullptr, float *gradientY = nullptr, float *gradientZ = nullptr) const;
+
+        bool empty() const { return values.empty(); }
+        const uint32_t *size() const { return dimensions; }
+        const float *origin() const { return corner; }
+        float cellSize() const { return cell; }
+
+    private:
+        uint32_t resolution = 0;
+        uint32_t dimensions[3] = {0, 0, 0};
+        float corner[3] = {0.0f, 0.0f, 0.0f};
+        float cell = 1.0f;
+        std::vector<float> values;
+    };
+
+    // Path of the field baked from "sourcePath" inside "cacheDirectory", next
+    // to the cooked mesh.
+    std::string distanceFieldPathOf(const std::string &sourcePath, const std::string &cacheDirectory);
+
+    // Loads the cached field of the mesh in "sourcePath", baking it (and
+    // writing the cache) when it is missing or stale.
+    bool loadOrBakeDistanceField(const std::string &sourcePath, const std::string &cacheDirectory,
+                                 uint32_t resolution, DistanceField &field);
+
+    // Bakes the mesh in "path" with 1 thread and with every core, checks
+    // that both agree and times scalar against batched sampling.
+    void benchmarkDistanceField(const std::string &path, uint32_t resolution);
+}
@@ -31,6 +31,9 @@
 #include "matrices.h"
 #include "renderer.h"
 #include "object.h"
+#include "renderqueue.h"
+#include "streambuffer.h"
+#include "geometryarena.h"
 
 namespace Emitter {
     namespace _internal {
@@ -71,13 +74,21 @@ namespace Emitter {
         float time = 0.0f;
         unsigned long int particleStart;
         unsigned long int particleEnd;
+        // Arena buffers plus the per-particle transforms (see onRender())
+        GLuint vao = 0;
 
     public:
         ParticleEmitter(int maxParticleCount, ParticleProprieties proprieties);
         void emit(float x, float y, float z, float xs, float ys, float zs, float startSize);
         void emitIn(float x, float y, float z, float xs, float ys, float zs, float startSize, float timeToEmit);
         void onUpdate(float dt);
-        void onRender(Renderer &renderer);
+        // Queues one instanced draw of every live particle, based on
+        // "prototype" (program, arena VAO and uniform locations). The
+        // particle transforms are written to "stream" and read, one mat4
+        // per instance, by the emitter's own VAO, which also binds the
+        // buffers "arena" keeps for the prototype's VAO.
+        void onRender(game::RenderQueue &queue, game::StreamBuffer &stream, mesh::GeometryArena &arena,
+                      const game::DrawPacket &prototype);
     };
 }
 
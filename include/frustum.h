@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+
+#include "bvh.h"
+#include "collisions.h"
+
+namespace collision {
+    // The 6 planes that bound what a camera sees, as (normal, offset) with
+    // the normals pointing inside: a point p is inside plane i when
+    // dot(planes[i], (p, 1)) >= 0.
+    struct Frustum {
+        enum {
+            PLANE_LEFT,
+            PLANE_RIGHT,
+            PLANE_BOTTOM,
+            PLANE_TOP,
+            PLANE_NEAR,
+            PLANE_FAR,
+            PLANE_COUNT,
+        };
+
+        glm::vec4 planes[PLANE_COUNT];
+
+        // Extracts the planes from "projection * view" (Gribb & Hartmann):
+        // each one is a sum or difference of two rows of the matrix. Works
+        // for both perspective and orthographic projections into the
+        // OpenGL clip cube; the planes come out in world space.
+        static Frustum fromMatrix(const glm::mat4 &viewProjection);
+
+        // Whether "box" is at least partly inside.
+        bool intersects(const Cube &box) const;
+    };
+
+    struct CullStatistics {
+        size_t nodesVisited = 0;
+        size_t planeTests = 0;
+        // Rejections by the first plane tested, the one that rejected the
+        // node (or object) the frame before.
+        size_t coherentRejections = 0;
+        // Nodes inside every plane, whose subtree was accepted without
+        // further tests.
+        size_t acceptedSubtrees = 0;
+        size_t visible = 0;
+        size_t culled = 0;
+    };
+
+    // Frustum culling of the objects of a SceneBvh, top down over its
+    // hierarchy:
+    // - Plane masking: a node only tests the planes its parent straddles.
+    //   Once a node is inside all of them its subtree needs no tests.
+    // - Plane coherency: the plane that rejected a node is tested first on
+    //   the next frame, since the camera moves little between frames.
+    class FrustumCuller {
+    public:
+        // Replaces "visible" with the ids (see SceneBvh::add()) of the
+        // objects whose bounds intersect "frustum".
+        void cull(const SceneBvh &scene, const Frustum &frustum, std::vector<uint32_t> &visible);
+
+        const CullStatistics &statistics() const { return stats; }
+
+    private:
+        // Returns false when the box is outside a plane in "mask". Removes
+        // from "mask" the planes the box is entirely inside of.
+        bool classify(const float *boundsMin, const float *boundsMax, const Frustum &frustum,
+                      uint8_t &mask, uint8_t &lastPlane);
+
+        // Plane that last rejected each node and each object
+        std::vector<uint8_t> nodePlanes;
+        std::vector<uint8_t> objectPlanes;
+        CullStatistics stats;
+    };
+
+    // Culls 10000 boxes from a camera orbiting them and compares
+    // FrustumCuller with testing every box.
+    void benchmarkFrustumCulling();
+}
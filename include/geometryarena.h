@@ -0,0 +1,91 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+#include "meshcache.h"
+#include "vertexformat.h"
+
+namespace mesh {
+    // Hands out ranges of [0, capacity) in arbitrary units. Picks the
+    // smallest free block that fits (best fit) and merges freed ranges with
+    // their free neighbours.
+    class RangeAllocator {
+    public:
+        void init(uint32_t capacity);
+        // Adds [capacity(), newCapacity) to the free space.
+        void grow(uint32_t newCapacity);
+
+        bool allocate(uint32_t size, uint32_t &offset);
+        void free(uint32_t offset, uint32_t size);
+
+        uint32_t capacity() const { return total; }
+        uint32_t used() const { return allocated; }
+        size_t freeBlocks() const { return byOffset.size(); }
+
+    private:
+        void insertFree(uint32_t offset, uint32_t size);
+        void eraseFree(std::map<uint32_t, uint32_t>::iterator block);
+
+        std::map<uint32_t, uint32_t> byOffset;    // offset -> size
+        std::multimap<uint32_t, uint32_t> bySize; // size -> offset
+        uint32_t total = 0;
+        uint32_t allocated = 0;
+    };
+
+    // Shared storage for static geometry. Every vertex layout gets one
+    // vertex buffer and one VAO; indices of all layouts live in a single
+    // index buffer. Meshes are ranges of these buffers, drawn with
+    // glDrawElementsBaseVertex(), so consecutive draws of meshes with the
+    // same layout need no rebinding. Buffers grow (by GPU copies) when full.
+    class GeometryArena {
+    public:
+        void init(uint32_t initialVertices = 1 << 16, uint32_t initialIndices = 1 << 20);
+        void destroy();
+
+        // Reserves "vertexCount" vertices of "layout" and "indexCount"
+        // indices. Sets the vao, baseVertex, firstIndex, vertexCount and
+        // layout of "mesh".
+        bool allocate(const VertexLayout &layout, uint32_t vertexCount, uint32_t indexCount, GpuMesh &mesh);
+        void release(GpuMesh &mesh);
+
+        // Fills the ranges of "mesh". Indices are relative to its first
+        // vertex.
+        void write(const GpuMesh &mesh, const void *vertices, const void *indices);
+
+        // Allocates and fills a mesh straight from a mapped file.
+        bool upload(const MeshFile &file, GpuMesh &mesh);
+        // Moves a mesh made by uploadBuffers() into the arena with GPU
+        // copies, deleting its own buffers.
+        bool adopt(GpuMesh &mesh);
+
+        // Binds the vertex buffer (with its layout) and the index buffer
+        // read by the arena VAO "vao" to the current VAO, so a VAO with
+        // attributes of its own (per-instance data) draws the same meshes.
+        // Rebinding after allocations is needed, since buffers grow. False
+        // when "vao" is not one of the arena's.
+        bool bindBuffers(GLuint vao);
+
+        void printStatistics() const;
+
+    private:
+        struct Pool {
+            VertexLayout layout;
+            GLuint vao;
+            GLuint vertexBuffer;
+            RangeAllocator vertices;
+        };
+
+        Pool *poolOf(const VertexLayout &layout);
+        void growVertices(Pool &pool, uint32_t needed);
+        void growIndices(uint32_t needed);
+
+        std::vector<Pool *> pools;
+        GLuint indexBuffer = 0;
+        RangeAllocator indices;
+        uint32_t initialVertices = 0;
+    };
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "glad/glad.h"
+
+// The vendored glad loader only covers core OpenGL 3.3 without extensions.
+// Entry points and enums from newer versions/extensions that we use
+// opportunistically are declared and loaded here.
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace glext {
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+    typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+    typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+    // GL 4.1 / GL_ARB_get_program_binary
+    extern bool programBinary;
+    extern GetProgramBinaryProc GetProgramBinary;
+    extern ProgramBinaryProc ProgramBinary;
+    extern ProgramParameteriProc ProgramParameteri;
+
+    // GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile
+    extern bool parallelShaderCompile;
+    extern MaxShaderCompilerThreadsProc MaxShaderCompilerThreads;
+
+    // GL 4.4 / GL_ARB_buffer_storage
+    extern bool bufferStorage;
+    extern BufferStorageProc BufferStorage;
+
+    // Loads the optional entry points. Must be called after gladLoadGLLoader()
+    // with the same loader.
+    void load(GLADloadproc loader);
+
+    // Checks the extension list of the current context.
+    bool hasExtension(const char *name);
+
+    // Returns true if the current context is at least version major.minor.
+    bool hasVersion(int major, int minor);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+
+#include "glad/glad.h"
+
+namespace game {
+    // Shadow copy of the GL state touched by the renderer. Every setter
+    // compares against the shadow and only reaches the driver when the value
+    // actually changes; the skipped calls are counted per kind so state churn
+    // shows up in the statistics.
+    //
+    // Code that changes state behind the tracker's back (e.g. during
+    // initialization) must call invalidate() afterwards.
+    class GLState {
+    public:
+        enum Kind {
+            PROGRAM,
+            VERTEX_ARRAY,
+            BUFFER,
+            TEXTURE,
+            DEPTH,
+            BLEND,
+            CULL,
+            POLYGON_MODE,
+            LINE_WIDTH,
+            KIND_COUNT
+        };
+
+        static const int TEXTURE_UNITS = 16;
+
+        struct Counter {
+            unsigned long issued = 0;
+            unsigned long skipped = 0;
+        };
+
+        GLState();
+
+        void useProgram(GLuint program);
+        void bindVertexArray(GLuint vao);
+        // GL_ARRAY_BUFFER and GL_ELEMENT_ARRAY_BUFFER are shadowed, other
+        // targets are always forwarded.
+        void bindBuffer(GLenum target, GLuint buffer);
+        void bindTexture(int unit, GLenum target, GLuint texture);
+
+        void setDepthTest(bool enabled);
+        void depthFunc(GLenum func);
+        void depthMask(bool write);
+
+        void setBlend(bool enabled);
+        void blendFunc(GLenum src, GLenum dst);
+
+        void setCullFace(bool enabled);
+        void polygonMode(GLenum mode);
+        void lineWidth(float width);
+
+        // Objects that are deleted must be forgotten, since GL may reuse
+        // their names.
+        void forgetProgram(GLuint program);
+        void forgetVertexArray(GLuint vao);
+        void forgetBuffer(GLuint buffer);
+
+        // Forgets everything; the next call of each kind reaches the driver.
+        void invalidate();
+
+        const Counter &counter(Kind kind) const { return counters[kind]; }
+        Counter total() const;
+        void resetStatistics();
+        void printStatistics() const;
+
+        GLuint program() const { return currentProgram; }
+        GLuint vertexArray() const { return currentVertexArray; }
+
+    private:
+        Counter counters[KIND_COUNT];
+
+        GLuint currentProgram;
+        GLuint currentVertexArray;
+        GLuint currentArrayBuffer;
+        GLuint currentElementBuffer;
+        int activeUnit;
+        GLuint currentTextures[TEXTURE_UNITS];
+        int depthTest;
+        GLenum currentDepthFunc;
+        int currentDepthMask;
+        int blend;
+        GLenum blendSrc, blendDst;
+        int cullFace;
+        GLenum currentPolygonMode;
+        float currentLineWidth;
+
+        inline bool changed(Kind kind, bool differs) {
+            if (differs) {
+                counters[kind].issued += 1;
+            } else {
+                counters[kind].skipped += 1;
+            }
+            return differs;
+        }
+    };
+
+    // State tracker of the main context.
+    extern GLState glState;
+}
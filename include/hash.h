@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace hash {
+    const uint64_t FNV64_OFFSET = 0xcbf29ce484222325ULL;
+    const uint64_t FNV64_PRIME = 0x100000001b3ULL;
+    const uint32_t FNV32_OFFSET = 0x811c9dc5u;
+    const uint32_t FNV32_PRIME = 0x01000193u;
+
+    // FNV-1a (64 bits). The seed allows hashing several buffers in sequence:
+    //   h = fnv1a64(a, na); h = fnv1a64(b, nb, h);
+    inline uint64_t fnv1a64(const void *data, size_t length, uint64_t seed = FNV64_OFFSET) {
+        const unsigned char *bytes = (const unsigned char *) data;
+        uint64_t h = seed;
+        for (size_t i = 0; i < length; i++) {
+            h ^= bytes[i];
+            h *= FNV64_PRIME;
+        }
+        return h;
+    }
+
+    inline uint64_t fnv1a64(const char *str, uint64_t seed = FNV64_OFFSET) {
+        uint64_t h = seed;
+        for (; str != nullptr && *str != '\0'; str++) {
+            h ^= (unsigned char) *str;
+            h *= FNV64_PRIME;
+        }
+        return h;
+    }
+
+    // FNV-1a (32 bits) of a string, usable at compile time:
+    //   constexpr uint32_t AXES = hash::fnv1a32("axes");
+    constexpr uint32_t fnv1a32(const char *str, uint32_t h = FNV32_OFFSET) {
+        return *str == '\0' ? h : fnv1a32(str + 1, (h ^ (uint32_t) (unsigned char) *str) * FNV32_PRIME);
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "glad/glad.h"
+
+namespace platform {
+    // OpenGL 3.3 core context without a window or display server, for
+    // benchmarks in containers. EGL with the surfaceless platform is tried
+    // first (any Mesa driver, llvmpipe included), then OSMesa. Both
+    // libraries are loaded at run time, so neither is needed to build or to
+    // run with a window.
+    //
+    // There is no default framebuffer: create() binds a framebuffer object
+    // with RGBA8 color and 24-bit depth, which stays bound for the whole
+    // frame (code that binds framebuffer 0 must bind framebuffer() instead).
+    class HeadlessContext {
+    public:
+        HeadlessContext() {}
+        ~HeadlessContext() { destroy(); }
+
+        // Creates the context, makes it current on this thread, loads glad
+        // and binds a "width" x "height" framebuffer.
+        bool create(int width, int height);
+        void destroy();
+
+        // Entry points of the current context, for gladLoadGLLoader() and
+        // glext::load().
+        static void *getProcAddress(const char *name);
+
+        // "EGL" or "OSMesa"
+        const char *api() const { return backend; }
+        GLuint framebuffer() const { return fbo; }
+        int width() const { return frameWidth; }
+        int height() const { return frameHeight; }
+
+        // Waits for the frame to finish, then reads it back and writes it
+        // as a binary PPM image.
+        bool writeFrame(const std::string &path);
+
+    private:
+        HeadlessContext(const HeadlessContext &);
+        HeadlessContext &operator=(const HeadlessContext &);
+
+        bool createEgl();
+        bool createOsMesa(int width, int height);
+
+        const char *backend = nullptr;
+        void *library = nullptr;
+        void *display = nullptr;
+        void *context = nullptr;
+        // OSMesa always draws into client memory, even if unused here.
+        std::vector<unsigned char> osMesaBuffer;
+
+        int frameWidth = 0, frameHeight = 0;
+        GLuint fbo = 0;
+        GLuint colorBuffer = 0;
+        GLuint depthBuffer = 0;
+    };
+
+    // Times the frames of a headless run: "cpu" until the last command is
+    // issued, "total" until the GPU has finished it (glFinish()), so
+    // frames never overlap.
+    class FrameTimings {
+    public:
+        void beginFrame();
+        void endFrame();
+
+        // Prints the mean, median, 99th percentile and maximum.
+        void print() const;
+        // One line per frame: index, cpu and total milliseconds.
+        bool write(const std::string &path) const;
+
+    private:
+        std::chrono::steady_clock::time_point start;
+        std::vector<double> cpu;
+        std::vector<double> total;
+    };
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+#include "meshopt.h"
+#include "objloader.h"
+#include "platform.h"
+#include "vertexformat.h"
+
+namespace mesh {
+    const uint32_t MESH_FILE_VERSION = 5;
+    // Blobs start at multiples of this, so they can be handed to the GPU
+    // (or read with aligned loads) straight from the mapping.
+    const uint64_t MESH_BLOB_ALIGNMENT = 64;
+
+    // Storage of the mesh attributes in the vertex buffer. Positions stored
+    // as FORMAT_UNORM16 are quantized against the mesh bounds.
+    struct MeshVertexFormat {
+        AttributeFormat position = FORMAT_UNORM16;
+        AttributeFormat normal = FORMAT_SNORM10;
+        AttributeFormat texcoord = FORMAT_HALF;
+    };
+
+    // Range of the index blob drawn for one level of detail.
+    struct MeshLod {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        // Largest distance the simplified surface moved, in object space.
+        float error;
+        uint32_t reserved;
+    };
+
+    // On-disk layout of a cooked mesh: this header, then the vertex and the
+    // index blobs at the offsets it records. All integers are little endian.
+    struct MeshFileHeader {
+        char magic[4];
+        uint32_t version;
+        // Hash of the source file, used to detect stale caches.
+        uint64_t sourceHash;
+
+        VertexLayout layout;
+        uint32_t vertexCount;
+        uint32_t indexCount;  // 32-bit indices, every level of detail
+        uint32_t lodCount;
+        MeshLod lods[MAX_LOD_LEVELS];
+
+        uint64_t vertexOffset;
+        uint64_t vertexBytes;
+        uint64_t indexOffset;
+        uint64_t indexBytes;
+
+        float boundsMin[3];
+        float boundsMax[3];
+        // Decoded position = positionOffset + positionScale * stored value.
+        float positionScale[3];
+        float positionOffset[3];
+    };
+
+    // Hash of a source asset as stored in MeshFileHeader::sourceHash.
+    uint64_t hashFile(const std::string &path);
+
+    // Writes "mesh" to "cachePath" in the binary format, with vertices
+    // stored as "format". "lods" hold the index lists to store, starting
+    // with the full mesh.
+    bool cookMesh(const MeshData &mesh, const std::vector<LodLevel> &lods, uint64_t sourceHash,
+                  const std::string &cachePath, const MeshVertexFormat &format = MeshVertexFormat());
+
+    // Path of the cooked version of "sourcePath" inside "cacheDirectory".
+    std::string cachePathOf(const std::string &sourcePath, const std::string &cacheDirectory);
+
+    // A cooked mesh mapped in memory. The blobs point into the mapping and
+    // stay valid until the file is closed.
+    class MeshFile {
+    public:
+        // False when the file is missing, of another version or corrupt:
+        // blobs smaller than the counts need, attributes past the stride or
+        // indices past the vertices.
+        bool open(const std::string &path);
+        void close() { file.close(); header = nullptr; }
+
+        const MeshFileHeader &info() const { return *header; }
+        const void *vertexData() const { return file.data() + header->vertexOffset; }
+        const void *indexData() const { return file.data() + header->indexOffset; }
+
+    private:
+        platform::MappedFile file;
+        const MeshFileHeader *header = nullptr;
+    };
+
+    // Decodes the positions of "file" to object-space floats (x, y, z).
+    void readPositions(const MeshFile &file, std::vector<float> &positions);
+
+    // Opens the cooked version of "sourcePath", cooking it first when the
+    // cache is missing, outdated or was built from a different source.
+    bool loadCached(const std::string &sourcePath, const std::string &cacheDirectory, MeshFile &file);
+
+    // Cooks every .obj file in "sourceDirectory" whose cache is stale.
+    void cookDirectory(const std::string &sourceDirectory, const std::string &cacheDirectory);
+
+    // GPU copy of a mesh: one VAO with an interleaved vertex buffer and an
+    // index buffer. Meshes in a GeometryArena share both buffers (and the
+    // VAO) with other meshes and are drawn with "baseVertex" and
+    // "firstIndex"; their buffer names are 0.
+    struct GpuMesh {
+        GLuint vao = 0;
+        GLuint vertexBuffer = 0;
+        GLuint indexBuffer = 0;
+        GLint baseVertex = 0;
+        uint32_t firstIndex = 0;  // LOD ranges are relative to this
+        uint32_t vertexCount = 0;
+        uint32_t indexTotal = 0;  // Of every level
+        bool inArena = false;
+        GLsizei indexCount = 0;  // Of the full detail level
+        uint32_t lodCount = 0;
+        MeshLod lods[MAX_LOD_LEVELS];
+        float boundsMin[3] = {0.0f, 0.0f, 0.0f};
+        float boundsMax[3] = {0.0f, 0.0f, 0.0f};
+        // Quantized positions reach the shader in [0, 1]; they are decoded
+        // by drawing with model * translate(positionOffset) * scale(positionScale).
+        float positionScale[3] = {1.0f, 1.0f, 1.0f};
+        float positionOffset[3] = {0.0f, 0.0f, 0.0f};
+        VertexLayout layout = {};
+    };
+
+    // The fields of "file" that do not depend on the GPU (counts, levels of
+    // detail, bounds, decoding and layout), without buffers.
+    GpuMesh describe(const MeshFile &file);
+
+    // Uploads the blobs of "file" directly from the mapping.
+    GpuMesh upload(const MeshFile &file);
+
+    // The two halves of upload(). uploadBuffers() only creates buffers, so
+    // it may run on a context shared with the main one; VAOs are not shared
+    // and createVertexArray() must run on the context that draws.
+    GpuMesh uploadBuffers(const MeshFile &file);
+    void createVertexArray(GpuMesh &gpu);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "glm/vec4.hpp"
+#include "glm/mat4x4.hpp"
+
+#include "camera.h"
+#include "meshcache.h"
+
+namespace mesh {
+    // Pixels covered by one world-space unit at "center" as seen by
+    // "camera" (perspective or orthographic).
+    float pixelsPerUnit(const game::Camera &camera, const glm::vec4 &center);
+
+    // Picks the level of detail of "mesh" whose error projects to at most
+    // "maxPixelError" pixels. "scale" converts object-space to world-space
+    // lengths and "current" is the level picked last frame (-1 if none).
+    // A level is only left when its error leaves a band of +-"hysteresis"
+    // (relative) around the threshold, so objects sitting at a switching
+    // distance do not flicker between levels.
+    int selectLod(const GpuMesh &mesh, float scale, float pixelsPerUnit, int current,
+                  float maxPixelError = 1.0f, float hysteresis = 0.25f);
+
+    // Largest scale factor of the upper 3x3 part of "model".
+    float maxScaleOf(const glm::mat4 &model);
+}
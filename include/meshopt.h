@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+#include "objloader.h"
+
+namespace mesh {
+    // Post-transform cache efficiency of an index buffer, simulated with a
+    // FIFO cache of "cacheSize" entries.
+    struct VertexCacheStatistics {
+        // Average cache miss ratio: transformed vertices per triangle (0.5
+        // is the ideal for large regular meshes, 3 the worst case).
+        float acmr;
+        // Average transform to vertex ratio: transformed vertices per
+        // unique vertex (1 is the ideal).
+        float atvr;
+    };
+
+    const unsigned VERTEX_CACHE_SIZE = 32;
+
+    VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount,
+                                             unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+    // Reorders the triangles for post-transform cache reuse using Tom
+    // Forsyth's "Linear-Speed Vertex Cache Optimisation".
+    void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+    // Reorders the vertices in the order the index buffer first uses them,
+    // so vertex fetches walk memory forward. Unused vertices are dropped.
+    void optimizeVertexFetch(MeshData &mesh);
+
+    // Simplifies the triangles in "indices" (which index "mesh") with
+    // quadric error metric edge collapses until at most "targetIndexCount"
+    // indices remain or the next collapse would cost more than "targetError"
+    // (mean distance to the planes around the vertex, relative to the
+    // largest extent of the mesh). Collapses only move a vertex onto a
+    // neighbour, so the result indexes the same vertices. Vertices on
+    // borders never move; vertices on attribute seams (several vertices at
+    // one position) move together, each corner taking the copy of the
+    // target with the closest normal and texture coordinates. Returns the
+    // largest distance from a removed vertex to the result, in object-space
+    // units, which can exceed "targetError" where thin parts collapse.
+    float simplify(const MeshData &mesh, const std::vector<uint32_t> &indices, size_t targetIndexCount,
+                   float targetError, std::vector<uint32_t> &result);
+
+    const int MAX_LOD_LEVELS = 4;
+
+    // Index list of one level of detail and its simplification error, in
+    // object-space units (0 for the full mesh).
+    struct LodLevel {
+        std::vector<uint32_t> indices;
+        float error;
+    };
+
+    // Builds up to MAX_LOD_LEVELS levels, halving the triangle count each
+    // time. Level 0 is "mesh.indices". Each level is cache optimized.
+    void buildLodChain(const MeshData &mesh, std::vector<LodLevel> &lods, const char *name);
+
+    // Runs both passes above and prints the cache statistics before and
+    // after. "name" identifies the mesh in the report.
+    void optimize(MeshData &mesh, const char *name);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glad/glad.h"
+#include "GLFW/glfw3.h"
+#include "glm/vec4.hpp"
+
+#include "bvh.h"
+#include "geometryarena.h"
+#include "meshcache.h"
+#include "occlusion.h"
+
+namespace mesh {
+    // A mesh finished by the streamer. "loaded" is false when the source
+    // could not be read or cooked. "bvh" holds the triangles of the most
+    // detailed level, for picking; "occluder" the largest triangles of that
+    // level, for occlusion culling.
+    struct StreamedMesh {
+        int ticket;
+        bool loaded;
+        GpuMesh gpu;
+        std::shared_ptr<collision::TriangleBvh> bvh;
+        std::shared_ptr<collision::OccluderMesh> occluder;
+    };
+
+    // Triangle BVH and occluder of the most detailed level of "file".
+    void buildCpuData(const MeshFile &file, std::shared_ptr<collision::TriangleBvh> &bvh,
+                      std::shared_ptr<collision::OccluderMesh> &occluder);
+
+    // Loads meshes in the background. A worker thread opens (cooking when
+    // needed) the cached meshes, nearest to the camera first, and uploads
+    // their buffers on a hidden context that shares objects with the main
+    // window, and build their triangle BVH. The main thread only creates the
+    // VAO once the upload's fence
+    // signals. Without a shared context the worker only maps the files and
+    // update() uploads a few meshes per frame instead. With an arena, the
+    // buffers are copied into it on the GPU instead of getting a VAO.
+    class MeshStreamer {
+    public:
+        ~MeshStreamer() { stop(); }
+
+        // Must be called on the main thread, with the context of
+        // "mainWindow" current. "mainWindow" and "arena" may be null.
+        void start(GLFWwindow *mainWindow, const std::string &cacheDirectory, GeometryArena *arena = nullptr);
+        void stop();
+
+        // Queues "sourcePath". "position" is where it will be drawn, in
+        // world space. Returns the ticket reported by update().
+        int request(const std::string &sourcePath, const glm::vec4 &position);
+
+        // Requests are served by distance to "position" at the time the
+        // worker picks the next one.
+        void setViewPosition(const glm::vec4 &position);
+
+        // Appends the meshes that became ready to draw to "ready". Called
+        // once per frame on the main thread.
+        void update(std::vector<StreamedMesh> &ready);
+
+        // Requests not yet returned by update().
+        size_t pending() const;
+        bool usesSharedContext() const { return sharedContext != nullptr; }
+
+    private:
+        struct Request {
+            int ticket;
+            std::string sourcePath;
+            glm::vec4 position;
+        };
+
+        struct Result {
+            int ticket;
+            bool loaded;
+            GpuMesh gpu;
+            std::shared_ptr<collision::TriangleBvh> bvh;
+            std::shared_ptr<collision::OccluderMesh> occluder;
+            GLsync fence;
+            // Set when the upload is left to the main thread.
+            std::unique_ptr<MeshFile> file;
+        };
+
+        void run();
+
+        GLFWwindow *sharedContext = nullptr;
+        GeometryArena *arena = nullptr;
+        std::string cacheDirectory;
+        std::thread worker;
+        bool running = false;
+
+        mutable std::mutex mutex;
+        std::condition_variable wakeUp;
+        std::vector<Request> requests;
+        std::vector<std::unique_ptr<Result> > finished;
+        glm::vec4 viewPosition = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        int nextTicket = 0;
+
+        // Main thread only.
+        std::vector<std::unique_ptr<Result> > uploading;
+    };
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace mesh {
+    // Indexed triangle mesh with de-interleaved attributes. "normals" and
+    // "texcoords" are empty when the source has none.
+    struct MeshData {
+        std::vector<float> positions; // x, y, z
+        std::vector<float> normals;   // x, y, z
+        std::vector<float> texcoords; // u, v
+        std::vector<uint32_t> indices;
+
+        float boundsMin[3] = {0.0f, 0.0f, 0.0f};
+        float boundsMax[3] = {0.0f, 0.0f, 0.0f};
+
+        size_t vertexCount() const { return positions.size() / 3; }
+        size_t triangleCount() const { return indices.size() / 3; }
+        void computeBounds();
+    };
+
+    // Parses a Wavefront OBJ file (v, vt, vn and f statements; polygons are
+    // triangulated as fans). The file is memory-mapped and split at line
+    // boundaries across "threads" threads (0 = one per core). Vertices that
+    // share the same position/texcoord/normal triple are merged.
+    bool loadObj(const std::string &path, MeshData &mesh, unsigned threads = 0);
+
+    // Parses "count" bytes of OBJ text already in memory. See loadObj().
+    bool parseObj(const char *data, size_t count, MeshData &mesh, unsigned threads = 0);
+
+    // Times loadObj() against tinyobj::LoadObj() on every .obj file in
+    // "directory" and prints the results.
+    void benchmarkObjLoaders(const std::string &directory);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+
+#include "collisions.h"
+
+namespace collision {
+    // Low-poly stand-in of a mesh, drawn into an OcclusionBuffer. Object
+    // space.
+    struct OccluderMesh {
+        std::vector<float> positions;  // x, y, z per vertex
+        std::vector<uint32_t> indices;
+
+        // Keeps the "maxTriangles" largest triangles of the detailed mesh
+        // and the vertices they use. A subset of the real surface never
+        // hides more than the whole would, which a simplified level (whose
+        // triangles may bridge concavities) does not guarantee.
+        void build(const float *positions, const uint32_t *indices, size_t triangleCount,
+                   size_t maxTriangles = 1024);
+    };
+
+    namespace _internal {
+        // Screen space triangle with counter-clockwise vertices, for a
+        // "width" x "height" pixel target. Depths are (w - z) / w in clip
+        // space: 0 at the far plane, growing towards the camera.
+        struct TriangleSetup {
+            // Edge functions a * x + b * y + c, positive inside.
+            float edgeA[3], edgeB[3], edgeC[3];
+            // Depth plane and the farthest vertex depth
+            float depthA, depthB, depthC, depthMin;
+            // Pixels the bounds cover, clamped to the target
+            int minX, maxX, minY, maxY;
+        };
+
+        // False when the triangle crosses the near plane, is degenerate or
+        // is off the target.
+        bool setupTriangle(const glm::vec4 &v0, const glm::vec4 &v1, const glm::vec4 &v2,
+                           int width, int height, TriangleSetup &setup);
+    }
+
+    // Coarse depth buffer for occlusion culling on the CPU, after "Masked
+    // Software Occlusion Culling" (Hasselgren et al.). The screen is split in
+    // tiles of 32x4 pixels; instead of a depth per pixel, each tile keeps
+    // - a reference depth: the farthest point of the occluders that cover
+    //   the whole tile,
+    // - a working layer: the pixels covered since (one bit each) and the
+    //   farthest depth among them.
+    // When the working layer covers the whole tile it becomes the new
+    // reference. Depths never overestimate how close the occluders are, so
+    // a box reported hidden is hidden.
+    //
+    // Coverage is computed 4 pixels at a time with SSE, and bands of tile
+    // rows are rasterized by different threads.
+    class OcclusionBuffer {
+    public:
+        static const int TILE_WIDTH = 32;
+        static const int TILE_HEIGHT = 4;
+
+        struct Statistics {
+            size_t triangles = 0;         // Sent by addOccluder()
+            size_t trianglesDropped = 0;  // Crossing the near plane, degenerate or off screen
+            size_t tileUpdates = 0;
+            size_t occludeesTested = 0;
+            size_t occludeesHidden = 0;
+        };
+
+        // Sizes are rounded up to whole tiles.
+        explicit OcclusionBuffer(int width = 320, int height = 192);
+
+        // Starts a frame: clears the buffer and the queued occluders.
+        // "viewProjection" maps world space to clip space.
+        void begin(const glm::mat4 &viewProjection);
+
+        // Queues the triangles of "occluder", placed by "model".
+        void addOccluder(const OccluderMesh &occluder, const glm::mat4 &model);
+        // Same, with "indices" holding 3 vertex indices per triangle into
+        // "positions" (x, y, z per vertex).
+        void addOccluder(const float *positions, const uint32_t *indices, size_t triangleCount, const glm::mat4 &model);
+
+        // Draws the queued occluders, bands of tile rows split across
+        // "threads" threads (0 = one per core) of parallel::framePool().
+        void rasterize(unsigned threads = 0);
+
+        // False when the world space "box" is behind the occluders drawn
+        // by rasterize() (or off screen). Where a tile's reference is not
+        // enough, the pixels of the box's screen rectangle are checked
+        // against the working layer. Boxes that cross the near plane are
+        // visible.
+        bool isVisible(const Cube &box);
+
+        int width() const { return tilesX * TILE_WIDTH; }
+        int height() const { return tilesY * TILE_HEIGHT; }
+        const Statistics &statistics() const { return stats; }
+
+        // Writes the reference depth of each tile as a grayscale PGM image
+        // (white is near), for debugging.
+        bool writeDepthImage(const std::string &path) const;
+
+    private:
+        void rasterizeBand(int tileRowBegin, int tileRowEnd, size_t &tileUpdates);
+        void updateTile(int tile, const uint32_t *coverage, float depth);
+
+        int tilesX, tilesY;
+        glm::mat4 viewProjection;
+        std::vector<_internal::TriangleSetup> triangles;
+        std::vector<glm::vec4> clipPositions;
+        // Per tile
+        std::vector<float> reference;
+        std::vector<float> working;
+        std::vector<uint32_t> masks;  // TILE_HEIGHT rows of 32 bits
+        Statistics stats;
+    };
+
+    // Rasterizes walls in front of 10000 boxes, checks the hidden boxes
+    // against a full depth buffer and times 1 thread against every core.
+    void benchmarkOcclusion();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+    // Number of worker threads to use for data-parallel jobs.
+    inline unsigned threadCount() {
+        unsigned count = std::thread::hardware_concurrency();
+        return count == 0 ? 1 : count;
+    }
+
+    // Splits [0, count) into at most "threads" contiguous chunks and runs
+    // job(chunk, begin, end) on each of them, one thread per chunk. The
+    // calling thread runs the first chunk. Returns once every chunk is done.
+    template<typename Job>
+    void forChunks(size_t count, unsigned threads, Job job) {
+        if (threads == 0) {
+            threads = threadCount();
+        }
+        size_t chunks = std::min((size_t) threads, count);
+        if (chunks <= 1) {
+            if (count > 0) {
+                job((size_t) 0, (size_t) 0, count);
+            }
+            return;
+        }
+
+        std::vector<std::thread> workers;
+        workers.reserve(chunks - 1);
+        for (size_t chunk = 1; chunk < chunks; chunk++) {
+            size_t begin = count * chunk / chunks;
+            size_t end = count * (chunk + 1) / chunks;
+            workers.push_back(std::thread(job, chunk, begin, end));
+        }
+        job((size_t) 0, (size_t) 0, count / chunks);
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+
+    // Threads that stay alive between jobs, for work that runs every frame
+    // (spawning threads costs more than rasterizing a small buffer). Jobs
+    // are split like forChunks(), but chunks are handed out on demand, so
+    // there may be more chunks than threads. Jobs from several threads run
+    // one after the other.
+    class ThreadPool {
+    public:
+        // "threads" threads in total, the calling one included (0 = one per
+        // core).
+        explicit ThreadPool(unsigned threads = 0);
+        ~ThreadPool();
+
+        unsigned size() const { return (unsigned) workers.size() + 1; }
+
+        // Runs job(chunk, begin, end) on "chunks" contiguous chunks of
+        // [0, count) (0 = one per thread). The calling thread takes chunks
+        // too. Returns once every chunk is done.
+        template<typename Job>
+        void forChunks(size_t count, unsigned chunks, Job job) {
+            if (chunks == 0) {
+                chunks = size();
+            }
+            chunks = (unsigned) std::min((size_t) chunks, count);
+            if (chunks <= 1 || workers.empty()) {
+                for (size_t chunk = 0; chunk < chunks; chunk++) {
+                    job(chunk, count * chunk / chunks, count * (chunk + 1) / chunks);
+                }
+                return;
+            }
+            run(count, chunks, std::function<void(size_t, size_t, size_t)>(job));
+        }
+
+    private:
+        typedef std::function<void(size_t, size_t, size_t)> Job;
+
+        ThreadPool(const ThreadPool &);
+        ThreadPool &operator=(const ThreadPool &);
+
+        void run(size_t count, size_t chunks, const Job &job);
+        void runChunks();
+        void work();
+
+        std::vector<std::thread> workers;
+        std::mutex submitting;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        // Current job, guarded by "mutex"
+        const Job *job = nullptr;
+        size_t count = 0;
+        size_t chunks = 0;
+        size_t nextChunk = 0;
+        size_t pendingChunks = 0;
+        unsigned long generation = 0;
+        bool stopping = false;
+    };
+
+    // Pool shared by the per-frame jobs, created on first use.
+    ThreadPool &framePool();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace platform {
+    // Seconds on a monotonic clock, from an arbitrary start. Unlike
+    // glfwGetTime(), it works before (or without) glfwInit().
+    double seconds();
+
+    // Creates a directory and its parents. Returns true if it exists after
+    // the call.
+    bool makeDirectory(const std::string &path);
+
+    // Reads a whole file into "contents". Returns false if it cannot be opened.
+    bool readFile(const std::string &path, std::string &contents);
+
+    // Writes "size" bytes into "path", replacing it atomically when possible.
+    bool writeFile(const std::string &path, const void *data, size_t size);
+
+    // Lists the files of "directory" whose names end with "suffix", sorted
+    // by name. Returned paths include the directory.
+    std::vector<std::string> listFiles(const std::string &directory, const std::string &suffix);
+
+    // Read-only memory mapping of a whole file. The mapping is released by
+    // close() or by the destructor.
+    class MappedFile {
+    public:
+        MappedFile() {}
+        ~MappedFile() { close(); }
+
+        bool open(const std::string &path);
+        void close();
+
+        const char *data() const { return (const char *) address; }
+        size_t size() const { return length; }
+
+    private:
+        MappedFile(const MappedFile &);
+        MappedFile &operator=(const MappedFile &);
+
+        void *address = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        void *file = nullptr;
+        void *mapping = nullptr;
+#endif
+    };
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+// Hands "source" to the driver and starts compiling it into "shader_id".
+// Does not wait for the compilation to finish; see CheckShader().
+void SubmitShader(GLuint shader_id, const std::string &source);
+
+// Waits for the compilation of "shader_id" and prints its log (if any) to
+// stderr. "label" identifies the shader in the log.
+bool CheckShader(GLuint shader_id, const char *label);
+
+namespace game {
+    // A program whose compilation/link was submitted to the driver but whose
+    // status was not queried yet. Querying any status forces the driver to
+    // finish the work, so this is kept around until the program is needed.
+    struct PendingProgram {
+        std::string name;
+        GLuint program_id = 0;
+        GLuint vertex_shader_id = 0;
+        GLuint fragment_shader_id = 0;
+        uint64_t key = 0;
+        bool fromCache = false;
+        double start = 0.0;
+    };
+
+    // On-disk cache of linked GPU programs.
+    //
+    // Programs are keyed by a hash of their shader sources and of the GL
+    // vendor/renderer/version strings, so a driver update or a shader edit
+    // produces a new key. Binaries come from glGetProgramBinary(); if the
+    // driver rejects a cached binary, the program is compiled from source and
+    // the cache entry is rewritten.
+    //
+    // begin() submits all the work without waiting on the driver, so several
+    // programs (and unrelated setup such as buffer uploads) overlap with
+    // compilation. finish() then collects the result.
+    class ProgramCache {
+    public:
+        // Must be called with a current context. "directory" is created if
+        // it does not exist yet.
+        void init(const std::string &directory);
+
+        // Starts building a program for the given sources.
+        PendingProgram begin(const char *name, const std::string &vertexSource, const std::string &fragmentSource);
+
+        // Returns true if finish() would not block. Always true when the
+        // driver lacks GL_KHR_parallel_shader_compile.
+        bool isReady(const PendingProgram &pending) const;
+
+        // Waits for the program, reports errors and stores newly compiled
+        // binaries in the cache. Returns the linked program.
+        GLuint finish(PendingProgram &pending);
+
+        // Prints the number of cache hits/compilations and the time spent.
+        void printStatistics() const;
+
+    private:
+        std::string directory;
+        uint64_t contextHash = 0;
+        bool enabled = false;
+
+        int hits = 0;
+        int compilations = 0;
+        double hitSeconds = 0.0;
+        double compileSeconds = 0.0;
+
+        std::string pathOf(uint64_t key) const;
+        bool submitBinary(GLuint program_id, uint64_t key);
+        void storeBinary(GLuint program_id, uint64_t key);
+        void submitSource(PendingProgram &pending, const std::string &vertexSource, const std::string &fragmentSource);
+    };
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "collisions.h"
+
+namespace collision {
+    const int TRIANGLE_BLOCK_SIZE = 8;
+
+    // TRIANGLE_BLOCK_SIZE triangles as structure of arrays: one SIMD load
+    // gets the same coordinate of every triangle of the block.
+    struct TriangleBlock {
+        float v0[3][TRIANGLE_BLOCK_SIZE];
+        float edge1[3][TRIANGLE_BLOCK_SIZE];  // v1 - v0
+        float edge2[3][TRIANGLE_BLOCK_SIZE];  // v2 - v0
+    };
+
+    // Triangle soup prepared for the ray–triangle kernels. The last block is
+    // padded with degenerate triangles, which never report a hit.
+    struct TriangleBlocks {
+        std::vector<TriangleBlock> blocks;
+        size_t triangleCount = 0;
+
+        // "indices" holds 3 vertex indices per triangle into "positions"
+        // (x, y, z per vertex).
+        void build(const float *positions, const uint32_t *indices, size_t count);
+    };
+
+    enum RayTriangleKernel {
+        KERNEL_SCALAR,
+        KERNEL_SSE,  // 4 triangles per step
+        KERNEL_AVX,  // 8 triangles per step
+    };
+
+    // Widest kernel the CPU supports.
+    RayTriangleKernel bestRayTriangleKernel();
+    const char *kernelName(RayTriangleKernel kernel);
+
+    // Möller–Trumbore against every triangle of "triangles". Finds the
+    // nearest hit with 0 <= t < tMax, updating "tMax" and "triangle". The
+    // scalar kernel is the reference: the others give the same hits.
+    bool intersect(const TriangleBlocks &triangles, const Ray &ray, float &tMax, uint32_t &triangle,
+                   RayTriangleKernel kernel = bestRayTriangleKernel());
+    // Same, over the "count" blocks at "blocks"; "triangle" counts lanes
+    // from the first of them.
+    bool intersect(const TriangleBlock *blocks, size_t count, const Ray &ray, float &tMax, uint32_t &triangle,
+                   RayTriangleKernel kernel = bestRayTriangleKernel());
+
+    // Casts random rays at the mesh in "path" with every kernel, checks them
+    // against the scalar one and prints the rays per second of each.
+    void benchmarkRayTriangle(const std::string &path);
+}
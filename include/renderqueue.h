@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+
+namespace game {
+    enum BlendMode {
+        BLEND_NONE,
+        BLEND_ALPHA,
+        BLEND_ADDITIVE,
+    };
+
+    // Passes are executed in this order.
+    enum RenderLayer {
+        // Sorted by state (program, VAO, texture), then front to back.
+        LAYER_OPAQUE = 0,
+        // Sorted back to front, so blending composes correctly.
+        LAYER_TRANSLUCENT = 1,
+        // Executed in submission order (text, reticle, ...).
+        LAYER_OVERLAY = 2,
+    };
+
+    // Everything needed to issue one draw call.
+    struct DrawPacket {
+        // Filled by RenderQueue::submit().
+        uint64_t key = 0;
+
+        // State
+        GLuint program = 0;
+        GLuint vao = 0;
+        GLuint texture = 0;
+        GLenum depthFunc = GL_LESS;
+        bool depthWrite = true;
+        BlendMode blend = BLEND_NONE;
+        float lineWidth = 1.0f;
+
+        // Geometry. For indexed draws "first" is a byte offset into the
+        // element buffer, otherwise it is the first vertex.
+        GLenum mode = GL_TRIANGLES;
+        bool indexed = true;
+        GLsizei count = 0;
+        uintptr_t first = 0;
+        GLint baseVertex = 0;
+        // Values above 1 use instanced draws; per-instance attributes come
+        // from the VAO.
+        GLsizei instances = 1;
+
+        // Per-draw uniforms. A location of -1 skips the upload.
+        GLint modelUniform = -1;
+        glm::mat4 model = glm::mat4(1.0f);
+        GLint flagUniform = -1;
+        GLint flag = 0;
+    };
+
+    // Collects the draws of a frame from every system and submits them from
+    // a single place, ordered by a 64-bit sort key so program and VAO
+    // switches are minimized.
+    class RenderQueue {
+    public:
+        struct Statistics {
+            unsigned long packets = 0;
+            unsigned long programSwitches = 0;
+            unsigned long vertexArraySwitches = 0;
+        };
+
+        // Position used to compute the depth part of the sort keys.
+        void setViewPosition(glm::vec4 position) { viewPosition = position; }
+
+        // Queues a draw. "position" (world space) orders it within its layer.
+        void submit(const DrawPacket &packet, RenderLayer layer, glm::vec4 position = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+        // Sorts and issues every queued draw, then empties the queue.
+        void execute();
+
+        size_t size() const { return packets.size(); }
+        const Statistics &statistics() const { return lastFrame; }
+
+        static uint64_t makeKey(RenderLayer layer, const DrawPacket &packet, float depth, uint32_t sequence);
+
+    private:
+        std::vector<DrawPacket> packets;
+        std::vector<std::pair<uint64_t, uint32_t>> order;
+        glm::vec4 viewPosition = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        uint32_t sequence = 0;
+        Statistics lastFrame;
+    };
+}
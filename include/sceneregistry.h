@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+#include "hash.h"
+
+namespace game {
+    // Reference to an object of a SceneRegistry: the slot index in the low
+    // 20 bits and the slot's generation in the high 12. A handle whose
+    // object was destroyed stops resolving instead of reaching whatever
+    // reuses the slot. 0 is never a valid handle.
+    struct SceneHandle {
+        uint32_t value = 0;
+
+        static const uint32_t INDEX_BITS = 20;
+        static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+        uint32_t index() const { return value & INDEX_MASK; }
+        uint32_t generation() const { return value >> INDEX_BITS; }
+        bool valid() const { return value != 0; }
+        bool operator==(const SceneHandle &other) const { return value == other.value; }
+        bool operator!=(const SceneHandle &other) const { return value != other.value; }
+    };
+
+    // Range of the scene's element buffer that draws an object.
+    struct SceneObject {
+        const char *name;
+        uintptr_t firstIndex;  // Byte offset into the element buffer
+        GLsizei indexCount;
+        GLenum renderingMode;
+        GLint baseVertex;
+    };
+
+    // Objects stored contiguously (swap-and-pop on removal), addressed by
+    // generational handles. Names are hashed with hash::fnv1a32() so they
+    // can be resolved once, at load time; per-frame code keeps the handles
+    // or walks data() directly.
+    class SceneRegistry {
+    public:
+        // Returns an invalid handle if "name" is already registered.
+        SceneHandle create(uint32_t name, const SceneObject &object);
+        void destroy(SceneHandle handle);
+
+        // Null if "handle" is stale or invalid.
+        SceneObject *get(SceneHandle handle);
+        const SceneObject *get(SceneHandle handle) const;
+
+        SceneHandle find(uint32_t name) const;
+
+        size_t size() const { return objects.size(); }
+        SceneObject *data() { return objects.data(); }
+        const SceneObject *data() const { return objects.data(); }
+
+    private:
+        struct Slot {
+            uint32_t dense;
+            uint32_t generation;
+        };
+
+        // Dense storage
+        std::vector<SceneObject> objects;
+        std::vector<uint32_t> owners;  // Slot of each object
+        std::vector<uint32_t> names;   // Name of each object
+
+        std::vector<Slot> slots;
+        std::vector<uint32_t> freeSlots;
+        std::unordered_map<uint32_t, SceneHandle> byName;
+    };
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// x86 SIMD kernels are compiled for their instruction set one function at a
+// time (TARGET_SSE, TARGET_AVX), so the rest of the program keeps the default
+// target and still runs on any x86 CPU. Callers check the CPU with
+// __builtin_cpu_supports() before using AVX. Elsewhere SIMD_X86 is not
+// defined and only the scalar paths are built.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#define TARGET_SSE __attribute__((target("sse2")))
+#define TARGET_AVX __attribute__((target("avx")))
+#endif
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+
+#include "renderqueue.h"
+
+namespace game {
+    // Geometry for SoftwareRenderer: what a VAO and its element buffer hold
+    // on the GPU, as floats.
+    struct SoftMesh {
+        std::vector<glm::vec4> positions;
+        // One per position, or empty to use the renderer's default color
+        // (as glVertexAttrib4f() does for a disabled attribute).
+        std::vector<glm::vec4> colors;
+        std::vector<uint32_t> indices;
+    };
+
+    namespace _internal {
+        struct SoftVertex {
+            float x, y, z;     // Window coordinates, z in [0, 1]
+            float inverseW;
+            glm::vec4 color;   // Divided by w
+        };
+
+        // Attributes as planes a * x + b * y + c over the window, at pixel
+        // centers.
+        struct SoftTriangle {
+            float edgeA[3], edgeB[3], edgeC[3];
+            // 0 for top-left edges, the smallest float above 0 otherwise, so
+            // that pixels on shared edges are drawn once.
+            float edgeBias[3];
+            float depth[3];
+            float inverseW[3];
+            float color[4][3];
+            int minX, maxX, minY, maxY;
+            GLenum depthFunc;
+            bool depthWrite;
+        };
+
+        struct SoftLine {
+            SoftVertex ends[2];
+            int width;
+            int minX, maxX, minY, maxY;
+            GLenum depthFunc;
+            bool depthWrite;
+        };
+    }
+
+    // Draws the same DrawPackets as RenderQueue on the CPU, with the shading
+    // of shader_vertex.glsl and shader_fragment.glsl: vertex colors
+    // interpolated with perspective correction, or black when "flag"
+    // (render_as_black) is set. Used where there is no GPU and as a
+    // reference for golden images.
+    //
+    // execute() sets up and bins the primitives into tiles of TILE_SIZE
+    // pixels on several threads, then rasterizes the tiles in parallel:
+    // triangles with edge functions, 4 pixels at a time with SSE, against a
+    // depth buffer. Each tile draws its primitives in submission order, so
+    // the image does not depend on the thread count.
+    //
+    // Not emulated: blending (translucent packets are drawn opaque),
+    // instancing (one instance is drawn) and textures.
+    class SoftwareRenderer {
+    public:
+        static const int TILE_SIZE = 64;
+
+        struct Statistics {
+            size_t draws = 0;
+            size_t triangles = 0;
+            size_t trianglesCulled = 0;   // Back faces, behind the near plane or off screen
+            size_t lines = 0;
+            size_t binnedPrimitives = 0;  // Primitive and tile pairs
+            size_t fragments = 0;         // Pixels written
+        };
+
+        SoftwareRenderer(int width, int height);
+
+        // Packets whose "vao" is "vertexArray" read "mesh", which must
+        // outlive their execution. Indexed packets give "first" in bytes,
+        // as glDrawElementsBaseVertex() does.
+        void setVertexArray(GLuint vertexArray, const SoftMesh *mesh);
+        void setViewProjection(const glm::mat4 &view, const glm::mat4 &projection);
+        // Counter-clockwise triangles face the camera (glFrontFace(GL_CCW)).
+        void setCullFace(bool enabled) { cullFace = enabled; }
+        void setDefaultColor(const glm::vec4 &color) { defaultColor = color; }
+
+        // Fills the color buffer and resets depth to 1.
+        void clear(const glm::vec4 &color);
+        void submit(const DrawPacket &packet);
+        // Draws the submitted packets on "threads" threads (0 = one per
+        // core) of parallel::framePool(), then empties the list.
+        void execute(unsigned threads = 0);
+
+        int width() const { return imageWidth; }
+        int height() const { return imageHeight; }
+        // RGBA8 pixels, "stride" per row, bottom row first (as
+        // glReadPixels()).
+        const uint32_t *pixels() const { return colors.data(); }
+        int stride() const { return rowStride; }
+        const Statistics &statistics() const { return stats; }
+
+        // Binary PPM, top row first.
+        bool writePpm(const std::string &path) const;
+        // Counts the pixels with a channel more than "tolerance" away from
+        // the PPM image in "path". False when it cannot be read or has
+        // another size.
+        bool compareWithPpm(const std::string &path, int tolerance, size_t &differentPixels) const;
+
+    private:
+        // Primitives set up by one thread, in submission order, and the
+        // ones touching each tile (lines have the high bit set).
+        struct Bin {
+            std::vector<_internal::SoftTriangle> triangles;
+            std::vector<_internal::SoftLine> lines;
+            std::vector<std::vector<uint32_t> > tiles;
+            Statistics stats;
+        };
+
+        void setupRange(size_t begin, size_t end, Bin &bin) const;
+        void addTriangle(const glm::vec4 *clip, const glm::vec4 *vertexColors, const DrawPacket &packet, Bin &bin) const;
+        bool setupTriangle(const _internal::SoftVertex *vertices, const DrawPacket &packet, Bin &bin) const;
+        void addLine(const glm::vec4 *clip, const glm::vec4 *vertexColors, const DrawPacket &packet, Bin &bin) const;
+        _internal::SoftVertex toWindow(const glm::vec4 &clip, const glm::vec4 &color) const;
+        void rasterizeTile(int tile, size_t &fragments);
+
+        int imageWidth, imageHeight, rowStride;
+        int tilesX, tilesY;
+        std::vector<uint32_t> colors;
+        std::vector<float> depths;
+
+        std::vector<std::pair<GLuint, const SoftMesh *> > vertexArrays;
+        std::vector<DrawPacket> packets;
+        // Per packet: its mesh, transform and the primitives before it
+        std::vector<const SoftMesh *> packetMeshes;
+        std::vector<glm::mat4> packetTransforms;
+        std::vector<size_t> primitiveStarts;
+        std::vector<Bin> bins;
+
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+        glm::vec4 defaultColor = glm::vec4(0.6f, 0.6f, 0.6f, 1.0f);
+        bool cullFace = true;
+        Statistics stats;
+    };
+}
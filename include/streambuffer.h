@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+#include "glad/glad.h"
+
+namespace game {
+    // Ring buffer for data rewritten every frame (text quads, particle
+    // instances, debug geometry).
+    //
+    // With GL_ARB_buffer_storage the buffer is mapped once, persistently, and
+    // split into STREAM_REGIONS regions: each frame writes into its own
+    // region and endFrame() places a fence after the frame's draws. A region
+    // is only reused after the GPU passed its fence, so writes never touch
+    // data still in flight and the driver never has to sync implicitly.
+    //
+    // On plain GL 3.3 the buffer is orphaned instead whenever a new frame
+    // starts, and each allocation is mapped unsynchronized, which is safe
+    // because ranges within a frame never overlap.
+    //
+    // Either way a frame's allocations must fit in one region, since they
+    // are only drawn at the end of the frame.
+    class StreamBuffer {
+    public:
+        static const int STREAM_REGIONS = 3;
+
+        // Creates the buffer. "regionSize" is the number of bytes available
+        // to a single frame.
+        void init(size_t regionSize);
+        void destroy();
+
+        // Reserves "size" bytes aligned to "alignment". Returns where to
+        // write them; "offset" receives their position inside buffer().
+        // The data must be written before commit() is called. Returns null
+        // for 0 bytes and when the frame's region is full.
+        void *allocate(size_t size, size_t alignment, GLintptr &offset);
+
+        // Makes the written data visible to the GPU. Must be called before
+        // drawing from allocations made since the last commit().
+        void commit();
+
+        // Marks the end of the frame's draws and moves to the next region.
+        void endFrame();
+
+        GLuint buffer() const { return buffer_id; }
+        bool isPersistent() const { return persistent != nullptr; }
+
+        // Number of times allocate() had to wait for the GPU.
+        unsigned long stalls = 0;
+        // Number of allocations dropped because the region was full.
+        unsigned long overflows = 0;
+
+    private:
+        GLuint buffer_id = 0;
+        size_t regionSize = 0;
+        int region = 0;
+        size_t head = 0;
+        GLsync fences[STREAM_REGIONS] = {};
+
+        // Persistent mapping of the whole buffer (GL_ARB_buffer_storage).
+        uint8_t *persistent = nullptr;
+
+        // Fallback path: range currently mapped with glMapBufferRange().
+        bool mapped = false;
+        bool orphaned = false;
+
+        void nextRegion();
+        void waitRegion(int index);
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "collisions.h"
+
+namespace collision {
+    typedef std::pair<uint32_t, uint32_t> ProxyPair;
+
+    // Broadphase for moving boxes: keeps the box endpoints along one axis
+    // sorted and sweeps them to find the pairs that overlap. Boxes move
+    // little between frames, so the endpoints stay nearly sorted and an
+    // insertion sort fixes them in about linear time.
+    class SweepAndPrune {
+    public:
+        // "axis" is 0, 1 or 2 for x, y or z; the one along which the boxes
+        // are most spread out rejects the most pairs.
+        explicit SweepAndPrune(int axis = 0) : axis(axis) {}
+
+        // Returns the proxy of the box, reused once removed.
+        uint32_t add(const Cube &bounds);
+        void remove(uint32_t proxy);
+        void move(uint32_t proxy, const Cube &bounds) { boxes[proxy] = bounds; }
+        const Cube &bounds(uint32_t proxy) const { return boxes[proxy]; }
+
+        // Sorts the endpoints after the moves since the last call and
+        // replaces "pairs" with every pair of boxes that intersect, as
+        // check(Cube&, Cube&). Each pair has its smaller proxy first.
+        void update(std::vector<ProxyPair> &pairs);
+
+        // Endpoint swaps done by the last update().
+        size_t lastSwapCount() const { return swaps; }
+
+    private:
+        struct Endpoint {
+            float value;
+            uint32_t data;  // proxy << 1 | 1 for the end of the box
+        };
+
+        float lowOf(const Cube &box) const;
+        float highOf(const Cube &box) const;
+
+        int axis;
+        std::vector<Cube> boxes;
+        std::vector<uint32_t> freeProxies;
+        std::vector<Endpoint> endpoints;
+        // Boxes open during the sweep (with a copy of their bounds, read
+        // in order) and each one's place in "active".
+        std::vector<uint32_t> active;
+        std::vector<Cube> activeBoxes;
+        std::vector<uint32_t> activeSlot;
+        size_t swaps = 0;
+    };
+
+    // Moves 1000 and 10000 boxes at random for a few frames and compares
+    // SweepAndPrune with testing every pair.
+    void benchmarkBroadphase();
+}
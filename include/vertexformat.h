@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace mesh {
+    const int MAX_VERTEX_ATTRIBUTES = 8;
+
+    // Shader attribute locations shared by every mesh.
+    enum AttributeLocation {
+        LOCATION_POSITION = 0,
+        LOCATION_COLOR = 1,
+        LOCATION_NORMAL = 2,
+        LOCATION_TEXCOORD = 3,
+        // Per-instance mat4, one location per column (4 to 7).
+        LOCATION_INSTANCE_MODEL = 4,
+    };
+
+    // How the values of an attribute are stored in a vertex buffer. All of
+    // them reach the shader as floats: the attribute fetch converts them.
+    enum AttributeFormat {
+        FORMAT_FLOAT,    // 32-bit floats
+        FORMAT_HALF,     // 16-bit floats
+        FORMAT_UNORM16,  // 16-bit integers, [0, 1]
+        FORMAT_SNORM10,  // x, y, z in one 2_10_10_10 word, [-1, 1] (w = 0)
+        FORMAT_UNORM8,   // 8-bit integers, [0, 1]
+    };
+
+    // Arguments of glVertexAttribPointer() for one attribute.
+    struct VertexAttribute {
+        uint32_t location;
+        uint32_t components;
+        uint32_t type;        // GL_FLOAT, GL_HALF_FLOAT, ...
+        uint32_t normalized;
+        uint32_t offset;
+        uint32_t format;      // AttributeFormat
+    };
+
+    struct VertexLayout {
+        uint32_t stride;
+        uint32_t attributeCount;
+        VertexAttribute attributes[MAX_VERTEX_ATTRIBUTES];
+    };
+
+    // Appends an attribute of "components" values stored as "format" to
+    // "layout". Attributes start at 4-byte boundaries.
+    void addAttribute(VertexLayout &layout, uint32_t location, uint32_t components, AttributeFormat format);
+
+    // Size in bytes of "components" values stored as "format", before
+    // padding.
+    size_t attributeSize(uint32_t components, AttributeFormat format);
+
+    // Stores the first "components" values of "values" at "destination".
+    // Values outside the range of normalized formats are clamped.
+    void packAttribute(void *destination, const float *values, uint32_t components, AttributeFormat format);
+
+    // Inverse of packAttribute().
+    void unpackAttribute(const void *source, float *values, uint32_t components, AttributeFormat format);
+
+    uint16_t packHalf(float value);
+    float unpackHalf(uint16_t value);
+
+    // Points the attributes of the bound VAO at the bound vertex buffer.
+    void applyLayout(const VertexLayout &layout, size_t baseOffset = 0);
+}
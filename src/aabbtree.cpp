@@ -0,0 +1,390 @@
+#include "aabbtree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace collision {
+    namespace _internal {
+        inline Cube merge(const Cube &a, const Cube &b) {
+            Cube box;
+            box.positionMin = {std::min(a.positionMin.x, b.positionMin.x), std::min(a.positionMin.y, b.positionMin.y),
+                               std::min(a.positionMin.z, b.positionMin.z)};
+            box.positionMax = {std::max(a.positionMax.x, b.positionMax.x), std::max(a.positionMax.y, b.positionMax.y),
+                               std::max(a.positionMax.z, b.positionMax.z)};
+            return box;
+        }
+
+        inline bool contains(const Cube &outer, const Cube &inner) {
+            return outer.positionMin.x <= inner.positionMin.x && outer.positionMin.y <= inner.positionMin.y &&
+                   outer.positionMin.z <= inner.positionMin.z && outer.positionMax.x >= inner.positionMax.x &&
+                   outer.positionMax.y >= inner.positionMax.y && outer.positionMax.z >= inner.positionMax.z;
+        }
+
+        // Half the surface area, which is all the cost comparisons need.
+        inline float area(const Cube &box) {
+            float x = box.positionMax.x - box.positionMin.x;
+            float y = box.positionMax.y - box.positionMin.y;
+            float z = box.positionMax.z - box.positionMin.z;
+            return x * y + y * z + z * x;
+        }
+
+        inline Cube fatten(const Cube &box, float margin) {
+            Cube fat;
+            fat.positionMin = {box.positionMin.x - margin, box.positionMin.y - margin, box.positionMin.z - margin};
+            fat.positionMax = {box.positionMax.x + margin, box.positionMax.y + margin, box.positionMax.z + margin};
+            return fat;
+        }
+    }
+
+    int32_t AabbTree::allocateNode() {
+        int32_t node;
+        if (freeList != NULL_NODE) {
+            node = freeList;
+            freeList = nodes[node].parent;
+        } else {
+            // The pool grows geometrically; nodes are never allocated one by
+            // one.
+            node = (int32_t) nodes.size();
+            nodes.push_back(Node());
+        }
+        nodes[node].parent = NULL_NODE;
+        nodes[node].child1 = NULL_NODE;
+        nodes[node].child2 = NULL_NODE;
+        nodes[node].height = 0;
+        nodes[node].userData = 0;
+        return node;
+    }
+
+    void AabbTree::freeNode(int32_t node) {
+        nodes[node].parent = freeList;
+        nodes[node].height = -1;
+        freeList = node;
+    }
+
+    int32_t AabbTree::insert(const Cube &bounds, uint32_t userData) {
+        int32_t leaf = allocateNode();
+        nodes[leaf].box = _internal::fatten(bounds, margin);
+        nodes[leaf].userData = userData;
+        insertLeaf(leaf);
+        leaves++;
+        return leaf;
+    }
+
+    void AabbTree::remove(int32_t proxy) {
+        removeLeaf(proxy);
+        freeNode(proxy);
+        leaves--;
+    }
+
+    bool AabbTree::move(int32_t proxy, const Cube &bounds) {
+        if (_internal::contains(nodes[proxy].box, bounds)) {
+            return false;
+        }
+        removeLeaf(proxy);
+        nodes[proxy].box = _internal::fatten(bounds, margin);
+        insertLeaf(proxy);
+        return true;
+    }
+
+    void AabbTree::insertLeaf(int32_t leaf) {
+        using namespace _internal;
+
+        if (root == NULL_NODE) {
+            root = leaf;
+            nodes[root].parent = NULL_NODE;
+            return;
+        }
+
+        // Walk down to the sibling whose merge with the leaf costs the least:
+        // the area of the new parent plus the growth of every ancestor.
+        // A copy: allocateNode() below may move the pool.
+        const Cube box = nodes[leaf].box;
+        int32_t index = root;
+        while (!nodes[index].isLeaf()) {
+            const Node &node = nodes[index];
+            float nodeArea = area(node.box);
+            float combinedArea = area(merge(node.box, box));
+            // Making a new parent for this node and the leaf
+            float cost = 2.0f * combinedArea;
+            // Pushing the leaf further down grows this node
+            float inheritance = 2.0f * (combinedArea - nodeArea);
+
+            float childCost[2];
+            int32_t children[2] = {node.child1, node.child2};
+            for (int c = 0; c < 2; c++) {
+                const Node &child = nodes[children[c]];
+                float grown = area(merge(child.box, box));
+                childCost[c] = child.isLeaf() ? grown + inheritance : grown - area(child.box) + inheritance;
+            }
+
+            if (cost < childCost[0] && cost < childCost[1]) {
+                break;
+            }
+            index = childCost[0] < childCost[1] ? children[0] : children[1];
+        }
+
+        int32_t sibling = index;
+        int32_t oldParent = nodes[sibling].parent;
+        int32_t newParent = allocateNode();
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].box = merge(box, nodes[sibling].box);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].child1 = sibling;
+        nodes[newParent].child2 = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+
+        if (oldParent == NULL_NODE) {
+            root = newParent;
+        } else if (nodes[oldParent].child1 == sibling) {
+            nodes[oldParent].child1 = newParent;
+        } else {
+            nodes[oldParent].child2 = newParent;
+        }
+
+        refit(nodes[leaf].parent);
+    }
+
+    void AabbTree::removeLeaf(int32_t leaf) {
+        if (leaf == root) {
+            root = NULL_NODE;
+            return;
+        }
+
+        int32_t parent = nodes[leaf].parent;
+        int32_t grandParent = nodes[parent].parent;
+        int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+        // The sibling takes the parent's place.
+        if (grandParent == NULL_NODE) {
+            root = sibling;
+            nodes[sibling].parent = NULL_NODE;
+            freeNode(parent);
+            return;
+        }
+        if (nodes[grandParent].child1 == parent) {
+            nodes[grandParent].child1 = sibling;
+        } else {
+            nodes[grandParent].child2 = sibling;
+        }
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+        refit(grandParent);
+    }
+
+    // Walks up from "node" fixing the boxes and heights, rotating where the
+    // tree became unbalanced.
+    void AabbTree::refit(int32_t node) {
+        while (node != NULL_NODE) {
+            node = balance(node);
+            Node &current = nodes[node];
+            const Node &child1 = nodes[current.child1];
+            const Node &child2 = nodes[current.child2];
+            current.height = 1 + std::max(child1.height, child2.height);
+            current.box = _internal::merge(child1.box, child2.box);
+            node = current.parent;
+        }
+    }
+
+    // When the children's heights differ by more than one, the taller child
+    // moves up into "a"'s place and "a" takes one of its children; the other
+    // grandchild (the taller one) stays with the taller child. Returns the
+    // node now at "a"'s place.
+    int32_t AabbTree::balance(int32_t a) {
+        Node &nodeA = nodes[a];
+        if (nodeA.isLeaf() || nodeA.height < 2) {
+            return a;
+        }
+
+        int32_t b = nodeA.child1;
+        int32_t c = nodeA.child2;
+        int32_t difference = nodes[c].height - nodes[b].height;
+        if (difference >= -1 && difference <= 1) {
+            return a;
+        }
+
+        // "up" is the taller child, "other" the one that stays under "a".
+        bool rotateC = difference > 1;
+        int32_t up = rotateC ? c : b;
+        Node &nodeUp = nodes[up];
+        int32_t f = nodeUp.child1;
+        int32_t g = nodeUp.child2;
+
+        // "up" replaces "a" under a's parent.
+        nodeUp.child1 = a;
+        nodeUp.parent = nodeA.parent;
+        nodeA.parent = up;
+        if (nodeUp.parent == NULL_NODE) {
+            root = up;
+        } else if (nodes[nodeUp.parent].child1 == a) {
+            nodes[nodeUp.parent].child1 = up;
+        } else {
+            nodes[nodeUp.parent].child2 = up;
+        }
+
+        // The taller grandchild stays with "up"; the shorter goes to "a", in
+        // the place "up" left.
+        int32_t keep = nodes[f].height > nodes[g].height ? f : g;
+        int32_t give = keep == f ? g : f;
+        nodeUp.child2 = keep;
+        if (rotateC) {
+            nodeA.child2 = give;
+        } else {
+            nodeA.child1 = give;
+        }
+        nodes[give].parent = a;
+
+        int32_t other = rotateC ? b : c;
+        nodeA.box = _internal::merge(nodes[other].box, nodes[give].box);
+        nodeA.height = 1 + std::max(nodes[other].height, nodes[give].height);
+        nodeUp.box = _internal::merge(nodeA.box, nodes[keep].box);
+        nodeUp.height = 1 + std::max(nodeA.height, nodes[keep].height);
+        return up;
+    }
+
+    float AabbTree::areaRatio() const {
+        if (root == NULL_NODE) {
+            return 0.0f;
+        }
+        float total = 0.0f;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (nodes[i].height > 0) {
+                total += _internal::area(nodes[i].box);
+            }
+        }
+        return total / _internal::area(nodes[root].box);
+    }
+
+    void benchmarkAabbTree() {
+        typedef std::chrono::steady_clock Clock;
+        const size_t COUNT = 5000;
+        const int FRAMES = 20;
+        // Per frame, out of COUNT boxes
+        const size_t CHURN = 100;
+        const int QUERIES = 200;
+        const int RAYS = 200;
+
+        std::mt19937 generator(43);
+        // About 40 units^3 per box, as in benchmarkBroadphase().
+        float side = std::cbrt(40.0f * COUNT);
+        std::uniform_real_distribution<float> position(0.0f, side);
+        std::uniform_real_distribution<float> size(0.5f, 2.0f);
+        std::uniform_real_distribution<float> speed(-0.1f, 0.1f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_int_distribution<size_t> pick(0, COUNT - 1);
+
+        struct Object {
+            Cube box;
+            Point velocity;
+            int32_t proxy;  // NULL_NODE while removed
+        };
+        std::vector<Object> objects(COUNT);
+        auto randomBox = [&](float extent) {
+            Point p = {position(generator), position(generator), position(generator)};
+            Cube box = {p, {p.x + extent, p.y + extent, p.z + extent}};
+            return box;
+        };
+
+        AabbTree tree;
+        for (size_t i = 0; i < COUNT; i++) {
+            objects[i].box = randomBox(size(generator));
+            objects[i].velocity = {speed(generator), speed(generator), speed(generator)};
+            objects[i].proxy = tree.insert(objects[i].box, (uint32_t) i);
+        }
+
+        double updateTime = 0.0, queryTime = 0.0, bruteQueryTime = 0.0, rayTime = 0.0, bruteRayTime = 0.0;
+        size_t moved = 0, queryHits = 0, rayHits = 0, mismatches = 0;
+        std::vector<uint32_t> found, expected;
+        for (int frame = 0; frame < FRAMES; frame++) {
+            // Move every box, then remove some and put back others.
+            Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < COUNT; i++) {
+                Object &object = objects[i];
+                const Point &v = object.velocity;
+                object.box.positionMin = {object.box.positionMin.x + v.x, object.box.positionMin.y + v.y, object.box.positionMin.z + v.z};
+                object.box.positionMax = {object.box.positionMax.x + v.x, object.box.positionMax.y + v.y, object.box.positionMax.z + v.z};
+                if (object.proxy != AabbTree::NULL_NODE && tree.move(object.proxy, object.box)) {
+                    moved++;
+                }
+            }
+            for (size_t c = 0; c < CHURN; c++) {
+                Object &object = objects[pick(generator)];
+                if (object.proxy != AabbTree::NULL_NODE) {
+                    tree.remove(object.proxy);
+                    object.proxy = AabbTree::NULL_NODE;
+                } else {
+                    object.proxy = tree.insert(object.box, (uint32_t) (&object - &objects[0]));
+                }
+            }
+            updateTime += std::chrono::duration<double>(Clock::now() - start).count();
+
+            // Results are compared as sorted sets of objects against every
+            // live fat box.
+            for (int q = 0; q < QUERIES; q++) {
+                Cube box = randomBox(4.0f * size(generator));
+                found.clear();
+                start = Clock::now();
+                tree.query(box, [&](int32_t proxy) {
+                    found.push_back(tree.userData(proxy));
+                    return true;
+                });
+                queryTime += std::chrono::duration<double>(Clock::now() - start).count();
+
+                expected.clear();
+                start = Clock::now();
+                for (size_t i = 0; i < COUNT; i++) {
+                    if (objects[i].proxy != AabbTree::NULL_NODE && _internal::overlaps(tree.fatBounds(objects[i].proxy), box)) {
+                        expected.push_back((uint32_t) i);
+                    }
+                }
+                bruteQueryTime += std::chrono::duration<double>(Clock::now() - start).count();
+
+                std::sort(found.begin(), found.end());
+                mismatches += found != expected;
+                queryHits += found.size();
+            }
+
+            for (int r = 0; r < RAYS; r++) {
+                Cube from = randomBox(0.0f);
+                Ray ray = {from.positionMin, {unit(generator), unit(generator), unit(generator)}};
+                const float inverse[3] = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+                const float tMax = side;
+                found.clear();
+                start = Clock::now();
+                tree.raycast(ray, tMax, [&](int32_t proxy, float limit) {
+                    found.push_back(tree.userData(proxy));
+                    return limit;
+                });
+                rayTime += std::chrono::duration<double>(Clock::now() - start).count();
+
+                expected.clear();
+                start = Clock::now();
+                for (size_t i = 0; i < COUNT; i++) {
+                    if (objects[i].proxy != AabbTree::NULL_NODE &&
+                        _internal::entryDistance(tree.fatBounds(objects[i].proxy), ray, inverse, tMax) != std::numeric_limits<float>::infinity()) {
+                        expected.push_back((uint32_t) i);
+                    }
+                }
+                bruteRayTime += std::chrono::duration<double>(Clock::now() - start).count();
+
+                std::sort(found.begin(), found.end());
+                mismatches += found != expected;
+                rayHits += found.size();
+            }
+        }
+
+        printf("%zu boxes, %d frames, %zu removed or inserted per frame\n", COUNT, FRAMES, CHURN);
+        printf("update:  %8.3f ms per frame, %zu reinserted by move()\n", updateTime / FRAMES * 1e3, moved / FRAMES);
+        printf("query:   %8.2f us tree, %8.2f us every box, %.1f hits\n", queryTime / (FRAMES * QUERIES) * 1e6,
+               bruteQueryTime / (FRAMES * QUERIES) * 1e6, (double) queryHits / (FRAMES * QUERIES));
+        printf("raycast: %8.2f us tree, %8.2f us every box, %.1f hits\n", rayTime / (FRAMES * RAYS) * 1e6,
+               bruteRayTime / (FRAMES * RAYS) * 1e6, (double) rayHits / (FRAMES * RAYS));
+        printf("%zu leaves, height %d, area ratio %.1f, %s\n", tree.leafCount(), tree.height(), tree.areaRatio(),
+               mismatches == 0 ? "results agree" : "RESULTS DIFFER");
+        if (mismatches > 0) {
+            printf("%zu of %d queries and rays differ\n", mismatches, FRAMES * (QUERIES + RAYS));
+        }
+    }
+}
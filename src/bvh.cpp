@@ -0,0 +1,308 @@
+#include "bvh.h"
+
+#include <cstring>
+
+#include "glm/vec4.hpp"
+#include "glm/gtc/matrix_inverse.hpp"
+
+namespace collision {
+    namespace _internal {
+        const int SAH_BINS = 12;
+        // Leaves above this size are split even when the heuristic says a
+        // leaf is cheaper.
+        const uint32_t FORCED_SPLIT_SIZE = 16;
+
+        inline float axisOf(const Point &p, int axis) {
+            return axis == 0 ? p.x : (axis == 1 ? p.y : p.z);
+        }
+
+        inline Cube emptyBox() {
+            const float inf = std::numeric_limits<float>::infinity();
+            Cube box = {{inf, inf, inf}, {-inf, -inf, -inf}};
+            return box;
+        }
+
+        inline void grow(Cube &box, const Cube &other) {
+            box.positionMin.x = std::min(box.positionMin.x, other.positionMin.x);
+            box.positionMin.y = std::min(box.positionMin.y, other.positionMin.y);
+            box.positionMin.z = std::min(box.positionMin.z, other.positionMin.z);
+            box.positionMax.x = std::max(box.positionMax.x, other.positionMax.x);
+            box.positionMax.y = std::max(box.positionMax.y, other.positionMax.y);
+            box.positionMax.z = std::max(box.positionMax.z, other.positionMax.z);
+        }
+
+        inline void grow(Cube &box, const Point &p) {
+            Cube point = {p, p};
+            grow(box, point);
+        }
+
+        inline float halfArea(const Cube &box) {
+            float x = box.positionMax.x - box.positionMin.x;
+            float y = box.positionMax.y - box.positionMin.y;
+            float z = box.positionMax.z - box.positionMin.z;
+            if (x < 0.0f || y < 0.0f || z < 0.0f) {
+                return 0.0f;
+            }
+            return x * y + y * z + z * x;
+        }
+
+        inline Point pointAt(const float *positions, uint32_t vertex) {
+            Point point = {positions[vertex * 3 + 0], positions[vertex * 3 + 1], positions[vertex * 3 + 2]};
+            return point;
+        }
+    }
+
+    void Bvh::build(const std::vector<Cube> &bounds, uint32_t leafSize) {
+        tree.clear();
+        order.resize(bounds.size());
+        if (bounds.empty()) {
+            return;
+        }
+
+        std::vector<Point> centroids(bounds.size());
+        for (size_t i = 0; i < bounds.size(); i++) {
+            order[i] = (uint32_t) i;
+            centroids[i].x = 0.5f * (bounds[i].positionMin.x + bounds[i].positionMax.x);
+            centroids[i].y = 0.5f * (bounds[i].positionMin.y + bounds[i].positionMax.y);
+            centroids[i].z = 0.5f * (bounds[i].positionMin.z + bounds[i].positionMax.z);
+        }
+
+        tree.reserve(bounds.size() * 2);
+        tree.push_back(Node());
+        subdivide(0, 0, (uint32_t) bounds.size(), leafSize, 0, bounds, centroids);
+    }
+
+    void Bvh::subdivide(uint32_t node, uint32_t first, uint32_t count, uint32_t leafSize, int depth,
+                        const std::vector<Cube> &bounds, const std::vector<Point> &centroids) {
+        using namespace _internal;
+
+        Cube box = emptyBox();
+        Cube centroidBox = emptyBox();
+        for (uint32_t i = first; i < first + count; i++) {
+            grow(box, bounds[order[i]]);
+            grow(centroidBox, centroids[order[i]]);
+        }
+        Node &current = tree[node];
+        current.boundsMin[0] = box.positionMin.x; current.boundsMin[1] = box.positionMin.y; current.boundsMin[2] = box.positionMin.z;
+        current.boundsMax[0] = box.positionMax.x; current.boundsMax[1] = box.positionMax.y; current.boundsMax[2] = box.positionMax.z;
+        current.leftOrFirst = first;
+        current.count = count;
+        if (count <= leafSize || depth >= MAX_DEPTH) {
+            return;
+        }
+
+        // Best split plane among the bin boundaries of every axis.
+        int bestAxis = -1;
+        int bestSplit = 0;
+        float bestCost = std::numeric_limits<float>::infinity();
+        for (int axis = 0; axis < 3; axis++) {
+            float low = axisOf(centroidBox.positionMin, axis);
+            float extent = axisOf(centroidBox.positionMax, axis) - low;
+            if (extent <= 0.0f) {
+                continue;
+            }
+            float scale = SAH_BINS / extent;
+
+            Cube binBoxes[SAH_BINS];
+            uint32_t binCounts[SAH_BINS] = {0};
+            for (int b = 0; b < SAH_BINS; b++) {
+                binBoxes[b] = emptyBox();
+            }
+            for (uint32_t i = first; i < first + count; i++) {
+                int b = std::min(SAH_BINS - 1, (int) ((axisOf(centroids[order[i]], axis) - low) * scale));
+                binCounts[b]++;
+                grow(binBoxes[b], bounds[order[i]]);
+            }
+
+            // Sweep from both sides to get the cost of every split.
+            float leftAreas[SAH_BINS - 1];
+            uint32_t leftCounts[SAH_BINS - 1];
+            Cube sweep = emptyBox();
+            uint32_t sweepCount = 0;
+            for (int b = 0; b < SAH_BINS - 1; b++) {
+                grow(sweep, binBoxes[b]);
+                sweepCount += binCounts[b];
+                leftAreas[b] = halfArea(sweep);
+                leftCounts[b] = sweepCount;
+            }
+            sweep = emptyBox();
+            sweepCount = 0;
+            for (int b = SAH_BINS - 1; b > 0; b--) {
+                grow(sweep, binBoxes[b]);
+                sweepCount += binCounts[b];
+                float cost = leftCounts[b - 1] * leftAreas[b - 1] + sweepCount * halfArea(sweep);
+                if (leftCounts[b - 1] > 0 && sweepCount > 0 && cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b;
+                }
+            }
+        }
+
+        float leafCost = count * halfArea(box);
+        if (bestAxis < 0 || (bestCost >= leafCost && count <= std::max(leafSize, FORCED_SPLIT_SIZE))) {
+            if (bestAxis < 0 && count > std::max(leafSize, FORCED_SPLIT_SIZE)) {
+                // Every centroid coincides: split the list in half.
+                bestAxis = 0;
+                bestSplit = -1;
+            } else {
+                return;
+            }
+        }
+
+        uint32_t middle;
+        if (bestSplit < 0) {
+            middle = first + count / 2;
+        } else {
+            float low = axisOf(centroidBox.positionMin, bestAxis);
+            float scale = SAH_BINS / (axisOf(centroidBox.positionMax, bestAxis) - low);
+            uint32_t *begin = &order[first];
+            uint32_t *end = begin + count;
+            uint32_t *split = std::partition(begin, end, [&](uint32_t primitive) {
+                return std::min(SAH_BINS - 1, (int) ((axisOf(centroids[primitive], bestAxis) - low) * scale)) < bestSplit;
+            });
+            middle = first + (uint32_t) (split - begin);
+        }
+
+        uint32_t left = (uint32_t) tree.size();
+        tree.push_back(Node());
+        tree.push_back(Node());
+        tree[node].leftOrFirst = left;
+        tree[node].count = 0;
+        subdivide(left, first, middle - first, leafSize, depth + 1, bounds, centroids);
+        subdivide(left + 1, middle, first + count - middle, leafSize, depth + 1, bounds, centroids);
+    }
+
+    void TriangleBvh::build(const float *positions, const uint32_t *indices, size_t triangleCount) {
+        using namespace _internal;
+
+        std::vector<Cube> bounds(triangleCount);
+        box = emptyBox();
+        for (size_t t = 0; t < triangleCount; t++) {
+            bounds[t] = emptyBox();
+            for (int k = 0; k < 3; k++) {
+                grow(bounds[t], pointAt(positions, indices[t * 3 + k]));
+            }
+            grow(box, bounds[t]);
+        }
+        bvh.build(bounds, TRIANGLE_BLOCK_SIZE);
+        count = triangleCount;
+
+        // Each leaf fills its blocks in slot order; zero edges make the
+        // padding lanes degenerate.
+        const std::vector<Bvh::Node> &nodes = bvh.nodes();
+        const std::vector<uint32_t> &order = bvh.primitives();
+        blocks.clear();
+        ids.clear();
+        leafBlocks.assign(nodes.size(), 0);
+        for (size_t node = 0; node < nodes.size(); node++) {
+            if (nodes[node].count == 0) {
+                continue;
+            }
+            leafBlocks[node] = (uint32_t) blocks.size();
+            size_t first = blocks.size();
+            blocks.resize(first + (nodes[node].count + TRIANGLE_BLOCK_SIZE - 1) / TRIANGLE_BLOCK_SIZE);
+            memset(&blocks[first], 0, (blocks.size() - first) * sizeof(TriangleBlock));
+            ids.resize(blocks.size() * TRIANGLE_BLOCK_SIZE, UINT32_MAX);
+
+            for (uint32_t i = 0; i < nodes[node].count; i++) {
+                uint32_t id = order[nodes[node].leftOrFirst + i];
+                TriangleBlock &block = blocks[first + i / TRIANGLE_BLOCK_SIZE];
+                int lane = i % TRIANGLE_BLOCK_SIZE;
+                const float *v0 = &positions[indices[id * 3 + 0] * 3];
+                const float *v1 = &positions[indices[id * 3 + 1] * 3];
+                const float *v2 = &positions[indices[id * 3 + 2] * 3];
+                for (int k = 0; k < 3; k++) {
+                    block.v0[k][lane] = v0[k];
+                    block.edge1[k][lane] = v1[k] - v0[k];
+                    block.edge2[k][lane] = v2[k] - v0[k];
+                }
+                ids[first * TRIANGLE_BLOCK_SIZE + i] = id;
+            }
+        }
+    }
+
+    bool TriangleBvh::raycast(const Ray &ray, float &tMax, uint32_t &triangle) const {
+        const std::vector<Bvh::Node> &nodes = bvh.nodes();
+        const RayTriangleKernel kernel = bestRayTriangleKernel();
+        bool hit = false;
+        bvh.traverseLeaves(ray, tMax, [&](uint32_t node, float limit) {
+            uint32_t first = leafBlocks[node];
+            uint32_t lane;
+            if (intersect(&blocks[first], (nodes[node].count + TRIANGLE_BLOCK_SIZE - 1) / TRIANGLE_BLOCK_SIZE,
+                          ray, limit, lane, kernel)) {
+                hit = true;
+                triangle = ids[first * TRIANGLE_BLOCK_SIZE + lane];
+            }
+            return limit;
+        });
+        return hit;
+    }
+
+    void SceneBvh::clear() {
+        objects.clear();
+        bvh = Bvh();
+    }
+
+    void SceneBvh::add(const TriangleBvh *mesh, const glm::mat4 &model, uint32_t id) {
+        Object object;
+        object.mesh = mesh;
+        object.worldToObject = glm::affineInverse(model);
+        object.id = id;
+
+        // World bounds of the 8 transformed corners of the object box.
+        const Cube &local = mesh->bounds();
+        object.bounds = _internal::emptyBox();
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec4 p = model * glm::vec4(corner & 1 ? local.positionMax.x : local.positionMin.x,
+                                            corner & 2 ? local.positionMax.y : local.positionMin.y,
+                                            corner & 4 ? local.positionMax.z : local.positionMin.z, 1.0f);
+            Point point = {p.x, p.y, p.z};
+            _internal::grow(object.bounds, point);
+        }
+        objects.push_back(object);
+    }
+
+    void SceneBvh::build() {
+        std::vector<Cube> bounds(objects.size());
+        for (size_t i = 0; i < objects.size(); i++) {
+            bounds[i] = objects[i].bounds;
+        }
+        bvh.build(bounds);
+    }
+
+    size_t SceneBvh::triangleCount() const {
+        size_t count = 0;
+        for (size_t i = 0; i < objects.size(); i++) {
+            count += objects[i].mesh->triangleCount();
+        }
+        return count;
+    }
+
+    bool SceneBvh::raycast(const Ray &ray, RaycastHit &hit) const {
+        float tMax = std::numeric_limits<float>::infinity();
+        bool found = false;
+        const std::vector<uint32_t> &order = bvh.primitives();
+        bvh.traverse(ray, tMax, [&](uint32_t slot, float limit) {
+            const Object &object = objects[order[slot]];
+            // The transform is affine, so t is the same in both spaces.
+            glm::vec4 origin = object.worldToObject * glm::vec4(ray.startPosition.x, ray.startPosition.y, ray.startPosition.z, 1.0f);
+            glm::vec4 direction = object.worldToObject * glm::vec4(ray.direction.x, ray.direction.y, ray.direction.z, 0.0f);
+            Ray local = {{origin.x, origin.y, origin.z}, {direction.x, direction.y, direction.z}};
+            uint32_t triangle;
+            if (object.mesh->raycast(local, limit, triangle)) {
+                found = true;
+                hit.t = limit;
+                hit.object = object.id;
+                hit.triangle = triangle;
+            }
+            return limit;
+        });
+        if (found) {
+            hit.position.x = ray.startPosition.x + hit.t * ray.direction.x;
+            hit.position.y = ray.startPosition.y + hit.t * ray.direction.y;
+            hit.position.z = ray.startPosition.z + hit.t * ray.direction.z;
+        }
+        return found;
+    }
+}
@@ -1,14 +1,55 @@
 #include "camera.h"
 
 #include "glm/gtc/type_ptr.hpp"
+#include "glm/matrix.hpp"
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
 #include <iostream>
 
 namespace game {
+    bool Camera::ViewInputs::operator==(const ViewInputs &other) const {
+        return isLookAt == other.isLookAt && followsBezier == other.followsBezier && distance == other.distance &&
+               theta == other.theta && phi == other.phi && position == other.position &&
+               lookAtPoint == other.lookAtPoint && upVector == other.upVector;
+    }
+
+    bool Camera::ProjectionInputs::operator==(const ProjectionInputs &other) const {
+        return usePerspectiveProjection == other.usePerspectiveProjection && distance == other.distance &&
+               field_of_view == other.field_of_view && screenRatio == other.screenRatio &&
+               nearPlane == other.nearPlane && farPlane == other.farPlane;
+    }
+
+    Camera::ViewInputs Camera::viewInputs() const {
+        ViewInputs inputs;
+        inputs.isLookAt = isLookAt;
+        inputs.followsBezier = 0.0f <= bezierTime && bezierTime <= 1.0f;
+        inputs.distance = distance;
+        inputs.theta = theta;
+        inputs.phi = phi;
+        inputs.position = position;
+        inputs.lookAtPoint = lookAtPoint;
+        inputs.upVector = upVector;
+        return inputs;
+    }
+
+    Camera::ProjectionInputs Camera::projectionInputs() const {
+        ProjectionInputs inputs;
+        inputs.usePerspectiveProjection = usePerspectiveProjection;
+        // Only the orthographic projection depends on the distance.
+        inputs.distance = usePerspectiveProjection ? 0.0f : distance;
+        inputs.field_of_view = field_of_view;
+        inputs.screenRatio = screenRatio;
+        inputs.nearPlane = nearPlane;
+        inputs.farPlane = farPlane;
+        return inputs;
+    }
+
     void Camera::computeMatrices(glm::mat4 &view, glm::mat4 &projection) {
+        bool viewDirty = cache.version == 0 || !(viewInputs() == cache.lastView);
+        bool projectionDirty = cache.version == 0 || !(projectionInputs() == cache.lastProjection);
+
         // View
-        {
+        if (viewDirty) {
             if (isLookAt) {
                 float r = distance;
                 if (!(0.0f <= bezierTime && bezierTime <= 1.0f)) {
@@ -25,21 +66,38 @@ namespace game {
                 viewVector = -glm::vec4(x, y, z, 0.0f);
             }
 
-            view = Matrix_Camera_View(position, viewVector, upVector);
+            cache.view = Matrix_Camera_View(position, viewVector, upVector);
+            cache.inverseView = glm::inverse(cache.view);
+            cache.viewVector = viewVector;
+            // Taken after the update: in look-at mode "position" is an
+            // output.
+            cache.lastView = viewInputs();
+        } else {
+            viewVector = cache.viewVector;
         }
 
         // Projection
-        {
+        if (projectionDirty) {
             if (usePerspectiveProjection) {
-                projection = Matrix_Perspective(field_of_view, screenRatio, nearPlane, farPlane);
+                cache.projection = Matrix_Perspective(field_of_view, screenRatio, nearPlane, farPlane);
             } else {
                 float t = 1.5f*distance/2.5f;
                 float b = -t;
                 float r = t*screenRatio;
                 float l = -r;
-                projection = Matrix_Orthographic(l, r, b, t, nearPlane, farPlane);
+                cache.projection = Matrix_Orthographic(l, r, b, t, nearPlane, farPlane);
             }
+            cache.inverseProjection = glm::inverse(cache.projection);
+            cache.lastProjection = projectionInputs();
+        }
+
+        if (viewDirty || projectionDirty) {
+            cache.viewProjection = cache.projection * cache.view;
+            cache.inverseViewProjection = cache.inverseView * cache.inverseProjection;
+            cache.version++;
         }
+        view = cache.view;
+        projection = cache.projection;
     }
 
     void Camera::onUpdate(float deltaTime) {
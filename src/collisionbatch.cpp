@@ -0,0 +1,429 @@
+#include "collisionbatch.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "simd.h"
+
+namespace collision {
+    namespace _internal {
+        inline void setBit(uint32_t *mask, size_t i, bool value) {
+            mask[i / 32] |= (uint32_t) value << (i % 32);
+        }
+
+        // Scalar versions of the tests, used for the elements that do not
+        // fill a whole SIMD register and where there is no SIMD at all.
+        inline bool sphereContains(const Sphere &sphere, float x, float y, float z) {
+            float dx = x - sphere.position.x;
+            float dy = y - sphere.position.y;
+            float dz = z - sphere.position.z;
+            return dx * dx + dy * dy + dz * dz <= sphere.r * sphere.r;
+        }
+
+        inline bool cubeContains(const Cube &cube, float x, float y, float z) {
+            return x >= cube.positionMin.x && x <= cube.positionMax.x &&
+                   y >= cube.positionMin.y && y <= cube.positionMax.y &&
+                   z >= cube.positionMin.z && z <= cube.positionMax.z;
+        }
+
+        inline bool cubesOverlap(const Cube &cube, const CubeArrays &cubes, size_t i) {
+            return cube.positionMin.x <= cubes.maxX[i] && cube.positionMax.x >= cubes.minX[i] &&
+                   cube.positionMin.y <= cubes.maxY[i] && cube.positionMax.y >= cubes.minY[i] &&
+                   cube.positionMin.z <= cubes.maxZ[i] && cube.positionMax.z >= cubes.minZ[i];
+        }
+
+        inline bool planeCrossesCube(const Plane &plane, const CubeArrays &cubes, size_t i) {
+            float hx = 0.5f * (cubes.maxX[i] - cubes.minX[i]);
+            float hy = 0.5f * (cubes.maxY[i] - cubes.minY[i]);
+            float hz = 0.5f * (cubes.maxZ[i] - cubes.minZ[i]);
+            float distance = plane.normal.x * (cubes.minX[i] + hx - plane.position.x) +
+                             plane.normal.y * (cubes.minY[i] + hy - plane.position.y) +
+                             plane.normal.z * (cubes.minZ[i] + hz - plane.position.z);
+            return distance * distance <= hx * hx + hy * hy + hz * hz;
+        }
+
+        inline bool cubeTouchesSphere(const Cube &cube, const SphereArrays &spheres, size_t i) {
+            // Distance from the center to the nearest point of the box
+            float dx = std::fmax(cube.positionMin.x - spheres.x[i], 0.0f) + std::fmax(spheres.x[i] - cube.positionMax.x, 0.0f);
+            float dy = std::fmax(cube.positionMin.y - spheres.y[i], 0.0f) + std::fmax(spheres.y[i] - cube.positionMax.y, 0.0f);
+            float dz = std::fmax(cube.positionMin.z - spheres.z[i], 0.0f) + std::fmax(spheres.z[i] - cube.positionMax.z, 0.0f);
+            return dx * dx + dy * dy + dz * dz <= spheres.r[i] * spheres.r[i];
+        }
+
+        inline bool spheresOverlap(const Sphere &sphere, const SphereArrays &spheres, size_t i) {
+            float dx = spheres.x[i] - sphere.position.x;
+            float dy = spheres.y[i] - sphere.position.y;
+            float dz = spheres.z[i] - sphere.position.z;
+            float radius = sphere.r + spheres.r[i];
+            return dx * dx + dy * dy + dz * dz <= radius * radius;
+        }
+
+        // Same results as minps and maxps: the second argument when either
+        // one is NaN, which drops the NaN of a ray lying on a slab's border.
+        inline float minOf(float a, float b) { return a < b ? a : b; }
+        inline float maxOf(float a, float b) { return a > b ? a : b; }
+
+        inline float slabEntry(const Ray &ray, const float *inverse, const CubeArrays &cubes, size_t i) {
+            const float origin[3] = {ray.startPosition.x, ray.startPosition.y, ray.startPosition.z};
+            const float boundsMin[3] = {cubes.minX[i], cubes.minY[i], cubes.minZ[i]};
+            const float boundsMax[3] = {cubes.maxX[i], cubes.maxY[i], cubes.maxZ[i]};
+            float tNear = 0.0f;
+            float tFar = std::numeric_limits<float>::infinity();
+            for (int k = 0; k < 3; k++) {
+                float t1 = (boundsMin[k] - origin[k]) * inverse[k];
+                float t2 = (boundsMax[k] - origin[k]) * inverse[k];
+                tNear = maxOf(minOf(t1, t2), tNear);
+                tFar = minOf(maxOf(t1, t2), tFar);
+            }
+            return tNear <= tFar ? tNear : -std::numeric_limits<float>::infinity();
+        }
+
+        // Same threshold as collide(Plane&, Ray&)
+        const float PARALLEL_EPSILON = 1e-5f;
+
+        inline float sweptPoint(const Plane &plane, float planeOffset, const PointArrays &points, const PointArrays &motion, size_t i) {
+            float approach = plane.normal.x * motion.x[i] + plane.normal.y * motion.y[i] + plane.normal.z * motion.z[i];
+            if (std::fabs(approach) < PARALLEL_EPSILON) {
+                return -std::numeric_limits<float>::infinity();
+            }
+            return (planeOffset - (plane.normal.x * points.x[i] + plane.normal.y * points.y[i] + plane.normal.z * points.z[i])) / approach;
+        }
+
+        // "inverseLength" is 1 / |plane.normal|, to measure the distances
+        // that are compared with the radius.
+        inline float sweptSphere(const Plane &plane, float planeOffset, float inverseLength, const SphereArrays &spheres,
+                                 const PointArrays &motion, size_t i) {
+            float approach = plane.normal.x * motion.x[i] + plane.normal.y * motion.y[i] + plane.normal.z * motion.z[i];
+            float distance = ((plane.normal.x * spheres.x[i] + plane.normal.y * spheres.y[i] + plane.normal.z * spheres.z[i]) - planeOffset) * inverseLength;
+            if (std::fabs(distance) <= spheres.r[i]) {
+                return 0.0f;
+            }
+            if (std::fabs(approach) < PARALLEL_EPSILON) {
+                return -std::numeric_limits<float>::infinity();
+            }
+            // The sphere touches the plane when its center is "r" away, on
+            // the side it starts on.
+            float contact = distance > 0.0f ? spheres.r[i] : -spheres.r[i];
+            return (contact - distance) / (approach * inverseLength);
+        }
+
+#ifdef SIMD_X86
+        // Each SSE kernel handles the first count & ~3 elements and returns
+        // how many it did.
+
+        TARGET_SSE
+        inline void storeBits(uint32_t *mask, size_t i, __m128 lanes) {
+            mask[i / 32] |= (uint32_t) _mm_movemask_ps(lanes) << (i % 32);
+        }
+
+        TARGET_SSE
+        size_t sphereContainsSse(const Sphere &sphere, const PointArrays &points, size_t count, uint32_t *mask) {
+            const __m128 cx = _mm_set1_ps(sphere.position.x);
+            const __m128 cy = _mm_set1_ps(sphere.position.y);
+            const __m128 cz = _mm_set1_ps(sphere.position.z);
+            const __m128 radius2 = _mm_set1_ps(sphere.r * sphere.r);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 dx = _mm_sub_ps(_mm_loadu_ps(points.x + i), cx);
+                __m128 dy = _mm_sub_ps(_mm_loadu_ps(points.y + i), cy);
+                __m128 dz = _mm_sub_ps(_mm_loadu_ps(points.z + i), cz);
+                __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                storeBits(mask, i, _mm_cmple_ps(distance2, radius2));
+            }
+            return i;
+        }
+
+        TARGET_SSE
+        size_t cubeContainsSse(const Cube &cube, const PointArrays &points, size_t count, uint32_t *mask) {
+            const __m128 minX = _mm_set1_ps(cube.positionMin.x), maxX = _mm_set1_ps(cube.positionMax.x);
+            const __m128 minY = _mm_set1_ps(cube.positionMin.y), maxY = _mm_set1_ps(cube.positionMax.y);
+            const __m128 minZ = _mm_set1_ps(cube.positionMin.z), maxZ = _mm_set1_ps(cube.positionMax.z);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 x = _mm_loadu_ps(points.x + i);
+                __m128 y = _mm_loadu_ps(points.y + i);
+                __m128 z = _mm_loadu_ps(points.z + i);
+                __m128 inside = _mm_and_ps(_mm_cmpge_ps(x, minX), _mm_cmple_ps(x, maxX));
+                inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(y, minY), _mm_cmple_ps(y, maxY)));
+                inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(z, minZ), _mm_cmple_ps(z, maxZ)));
+                storeBits(mask, i, inside);
+            }
+            return i;
+        }
+
+        TARGET_SSE
+        size_t cubesOverlapSse(const Cube &cube, const CubeArrays &cubes, size_t count, uint32_t *mask) {
+            const __m128 minX = _mm_set1_ps(cube.positionMin.x), maxX = _mm_set1_ps(cube.positionMax.x);
+            const __m128 minY = _mm_set1_ps(cube.positionMin.y), maxY = _mm_set1_ps(cube.positionMax.y);
+            const __m128 minZ = _mm_set1_ps(cube.positionMin.z), maxZ = _mm_set1_ps(cube.positionMax.z);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 overlap = _mm_and_ps(_mm_cmple_ps(minX, _mm_loadu_ps(cubes.maxX + i)),
+                                            _mm_cmpge_ps(maxX, _mm_loadu_ps(cubes.minX + i)));
+                overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(minY, _mm_loadu_ps(cubes.maxY + i)),
+                                                         _mm_cmpge_ps(maxY, _mm_loadu_ps(cubes.minY + i))));
+                overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(minZ, _mm_loadu_ps(cubes.maxZ + i)),
+                                                         _mm_cmpge_ps(maxZ, _mm_loadu_ps(cubes.minZ + i))));
+                storeBits(mask, i, overlap);
+            }
+            return i;
+        }
+
+        TARGET_SSE
+        size_t planeCrossesCubeSse(const Plane &plane, const CubeArrays &cubes, size_t count, uint32_t *mask) {
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 nx = _mm_set1_ps(plane.normal.x);
+            const __m128 ny = _mm_set1_ps(plane.normal.y);
+            const __m128 nz = _mm_set1_ps(plane.normal.z);
+            const __m128 px = _mm_set1_ps(plane.position.x);
+            const __m128 py = _mm_set1_ps(plane.position.y);
+            const __m128 pz = _mm_set1_ps(plane.position.z);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 minX = _mm_loadu_ps(cubes.minX + i);
+                __m128 minY = _mm_loadu_ps(cubes.minY + i);
+                __m128 minZ = _mm_loadu_ps(cubes.minZ + i);
+                __m128 hx = _mm_mul_ps(half, _mm_sub_ps(_mm_loadu_ps(cubes.maxX + i), minX));
+                __m128 hy = _mm_mul_ps(half, _mm_sub_ps(_mm_loadu_ps(cubes.maxY + i), minY));
+                __m128 hz = _mm_mul_ps(half, _mm_sub_ps(_mm_loadu_ps(cubes.maxZ + i), minZ));
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_sub_ps(_mm_add_ps(minX, hx), px)),
+                                                        _mm_mul_ps(ny, _mm_sub_ps(_mm_add_ps(minY, hy), py))),
+                                             _mm_mul_ps(nz, _mm_sub_ps(_mm_add_ps(minZ, hz), pz)));
+                __m128 halfDiagonal2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hx, hx), _mm_mul_ps(hy, hy)), _mm_mul_ps(hz, hz));
+                storeBits(mask, i, _mm_cmple_ps(_mm_mul_ps(distance, distance), halfDiagonal2));
+            }
+            return i;
+        }
+
+        TARGET_SSE
+        size_t cubeTouchesSphereSse(const Cube &cube, const SphereArrays &spheres, size_t count, uint32_t *mask) {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 minX = _mm_set1_ps(cube.positionMin.x), maxX = _mm_set1_ps(cube.positionMax.x);
+            const __m128 minY = _mm_set1_ps(cube.positionMin.y), maxY = _mm_set1_ps(cube.positionMax.y);
+            const __m128 minZ = _mm_set1_ps(cube.positionMin.z), maxZ = _mm_set1_ps(cube.positionMax.z);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 x = _mm_loadu_ps(spheres.x + i);
+                __m128 y = _mm_loadu_ps(spheres.y + i);
+                __m128 z = _mm_loadu_ps(spheres.z + i);
+                __m128 r = _mm_loadu_ps(spheres.r + i);
+                __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minX, x), zero), _mm_max_ps(_mm_sub_ps(x, maxX), zero));
+                __m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minY, y), zero), _mm_max_ps(_mm_sub_ps(y, maxY), zero));
+                __m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minZ, z), zero), _mm_max_ps(_mm_sub_ps(z, maxZ), zero));
+                __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                storeBits(mask, i, _mm_cmple_ps(distance2, _mm_mul_ps(r, r)));
+            }
+            return i;
+        }
+
+        TARGET_SSE
+        size_t spheresOverlapSse(const Sphere &sphere, const SphereArrays &spheres, size_t count, uint32_t *mask) {
+            const __m128 cx = _mm_set1_ps(sphere.position.x);
+            const __m128 cy = _mm_set1_ps(sphere.position.y);
+            const __m128 cz = _mm_set1_ps(sphere.position.z);
+            const __m128 r = _mm_set1_ps(sphere.r);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 dx = _mm_sub_ps(_mm_loadu_ps(spheres.x + i), cx);
+                __m128 dy = _mm_sub_ps(_mm_loadu_ps(spheres.y + i), cy);
+                __m128 dz = _mm_sub_ps(_mm_loadu_ps(spheres.z + i), cz);
+                __m128 radius = _mm_add_ps(r, _mm_loadu_ps(spheres.r + i));
+                __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                storeBits(mask, i, _mm_cmple_ps(distance2, _mm_mul_ps(radius, radius)));
+            }
+            return i;
+        }
+
+        TARGET_SSE
+        size_t slabEntrySse(const Ray &ray, const float *inverse, const CubeArrays &cubes, size_t count, float *distances) {
+            const __m128 ox = _mm_set1_ps(ray.startPosition.x);
+            const __m128 oy = _mm_set1_ps(ray.startPosition.y);
+            const __m128 oz = _mm_set1_ps(ray.startPosition.z);
+            const __m128 ix = _mm_set1_ps(inverse[0]);
+            const __m128 iy = _mm_set1_ps(inverse[1]);
+            const __m128 iz = _mm_set1_ps(inverse[2]);
+            const __m128 infinity = _mm_set1_ps(std::numeric_limits<float>::infinity());
+            const __m128 miss = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(cubes.minX + i), ox), ix);
+                __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(cubes.maxX + i), ox), ix);
+                __m128 tNear = _mm_max_ps(_mm_min_ps(t1, t2), _mm_setzero_ps());
+                __m128 tFar = _mm_min_ps(_mm_max_ps(t1, t2), infinity);
+
+                t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(cubes.minY + i), oy), iy);
+                t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(cubes.maxY + i), oy), iy);
+                tNear = _mm_max_ps(_mm_min_ps(t1, t2), tNear);
+                tFar = _mm_min_ps(_mm_max_ps(t1, t2), tFar);
+
+                t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(cubes.minZ + i), oz), iz);
+                t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(cubes.maxZ + i), oz), iz);
+                tNear = _mm_max_ps(_mm_min_ps(t1, t2), tNear);
+                tFar = _mm_min_ps(_mm_max_ps(t1, t2), tFar);
+
+                __m128 hit = _mm_cmple_ps(tNear, tFar);
+                _mm_storeu_ps(distances + i, _mm_or_ps(_mm_and_ps(hit, tNear), _mm_andnot_ps(hit, miss)));
+            }
+            return i;
+        }
+
+        TARGET_SSE
+        size_t sweptPointSse(const Plane &plane, float planeOffset, const PointArrays &points, const PointArrays &motion,
+                             size_t count, float *times) {
+            const __m128 nx = _mm_set1_ps(plane.normal.x);
+            const __m128 ny = _mm_set1_ps(plane.normal.y);
+            const __m128 nz = _mm_set1_ps(plane.normal.z);
+            const __m128 offset = _mm_set1_ps(planeOffset);
+            const __m128 epsilon = _mm_set1_ps(PARALLEL_EPSILON);
+            const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+            const __m128 parallel = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 approach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(motion.x + i)), _mm_mul_ps(ny, _mm_loadu_ps(motion.y + i))),
+                                             _mm_mul_ps(nz, _mm_loadu_ps(motion.z + i)));
+                __m128 height = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(points.x + i)), _mm_mul_ps(ny, _mm_loadu_ps(points.y + i))),
+                                           _mm_mul_ps(nz, _mm_loadu_ps(points.z + i)));
+                __m128 t = _mm_div_ps(_mm_sub_ps(offset, height), approach);
+                __m128 moving = _mm_cmpge_ps(_mm_and_ps(approach, absMask), epsilon);
+                _mm_storeu_ps(times + i, _mm_or_ps(_mm_and_ps(moving, t), _mm_andnot_ps(moving, parallel)));
+            }
+            return i;
+        }
+
+        TARGET_SSE
+        size_t sweptSphereSse(const Plane &plane, float planeOffset, float inverseLength, const SphereArrays &spheres,
+                              const PointArrays &motion, size_t count, float *times) {
+            const __m128 nx = _mm_set1_ps(plane.normal.x);
+            const __m128 ny = _mm_set1_ps(plane.normal.y);
+            const __m128 nz = _mm_set1_ps(plane.normal.z);
+            const __m128 offset = _mm_set1_ps(planeOffset);
+            const __m128 scale = _mm_set1_ps(inverseLength);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 epsilon = _mm_set1_ps(PARALLEL_EPSILON);
+            const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+            const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int) 0x80000000u));
+            const __m128 parallel = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 r = _mm_loadu_ps(spheres.r + i);
+                __m128 approach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(motion.x + i)), _mm_mul_ps(ny, _mm_loadu_ps(motion.y + i))),
+                                             _mm_mul_ps(nz, _mm_loadu_ps(motion.z + i)));
+                __m128 height = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(spheres.x + i)), _mm_mul_ps(ny, _mm_loadu_ps(spheres.y + i))),
+                                           _mm_mul_ps(nz, _mm_loadu_ps(spheres.z + i)));
+                __m128 distance = _mm_mul_ps(_mm_sub_ps(height, offset), scale);
+                // r with the sign of the side the sphere starts on
+                __m128 above = _mm_cmpgt_ps(distance, zero);
+                __m128 contact = _mm_or_ps(_mm_and_ps(above, r), _mm_andnot_ps(above, _mm_xor_ps(r, signMask)));
+                __m128 t = _mm_div_ps(_mm_sub_ps(contact, distance), _mm_mul_ps(approach, scale));
+
+                __m128 moving = _mm_cmpge_ps(_mm_and_ps(approach, absMask), epsilon);
+                __m128 result = _mm_or_ps(_mm_and_ps(moving, t), _mm_andnot_ps(moving, parallel));
+                __m128 touching = _mm_cmple_ps(_mm_and_ps(distance, absMask), r);
+                _mm_storeu_ps(times + i, _mm_andnot_ps(touching, result));
+            }
+            return i;
+        }
+#endif
+    }
+
+    void check(const Sphere &sphere, const PointArrays &points, size_t count, uint32_t *mask) {
+        memset(mask, 0, maskWords(count) * sizeof(uint32_t));
+        size_t i = 0;
+#ifdef SIMD_X86
+        i = _internal::sphereContainsSse(sphere, points, count, mask);
+#endif
+        for (; i < count; i++) {
+            _internal::setBit(mask, i, _internal::sphereContains(sphere, points.x[i], points.y[i], points.z[i]));
+        }
+    }
+
+    void check(const Cube &cube, const PointArrays &points, size_t count, uint32_t *mask) {
+        memset(mask, 0, maskWords(count) * sizeof(uint32_t));
+        size_t i = 0;
+#ifdef SIMD_X86
+        i = _internal::cubeContainsSse(cube, points, count, mask);
+#endif
+        for (; i < count; i++) {
+            _internal::setBit(mask, i, _internal::cubeContains(cube, points.x[i], points.y[i], points.z[i]));
+        }
+    }
+
+    void check(const Cube &cube, const CubeArrays &cubes, size_t count, uint32_t *mask) {
+        memset(mask, 0, maskWords(count) * sizeof(uint32_t));
+        size_t i = 0;
+#ifdef SIMD_X86
+        i = _internal::cubesOverlapSse(cube, cubes, count, mask);
+#endif
+        for (; i < count; i++) {
+            _internal::setBit(mask, i, _internal::cubesOverlap(cube, cubes, i));
+        }
+    }
+
+    void check(const Plane &plane, const CubeArrays &cubes, size_t count, uint32_t *mask) {
+        memset(mask, 0, maskWords(count) * sizeof(uint32_t));
+        size_t i = 0;
+#ifdef SIMD_X86
+        i = _internal::planeCrossesCubeSse(plane, cubes, count, mask);
+#endif
+        for (; i < count; i++) {
+            _internal::setBit(mask, i, _internal::planeCrossesCube(plane, cubes, i));
+        }
+    }
+
+    void check(const Cube &cube, const SphereArrays &spheres, size_t count, uint32_t *mask) {
+        memset(mask, 0, maskWords(count) * sizeof(uint32_t));
+        size_t i = 0;
+#ifdef SIMD_X86
+        i = _internal::cubeTouchesSphereSse(cube, spheres, count, mask);
+#endif
+        for (; i < count; i++) {
+            _internal::setBit(mask, i, _internal::cubeTouchesSphere(cube, spheres, i));
+        }
+    }
+
+    void check(const Sphere &sphere, const SphereArrays &spheres, size_t count, uint32_t *mask) {
+        memset(mask, 0, maskWords(count) * sizeof(uint32_t));
+        size_t i = 0;
+#ifdef SIMD_X86
+        i = _internal::spheresOverlapSse(sphere, spheres, count, mask);
+#endif
+        for (; i < count; i++) {
+            _internal::setBit(mask, i, _internal::spheresOverlap(sphere, spheres, i));
+        }
+    }
+
+    void collide(const Ray &ray, const CubeArrays &cubes, size_t count, float *distances) {
+        const float inverse[3] = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+        size_t i = 0;
+#ifdef SIMD_X86
+        i = _internal::slabEntrySse(ray, inverse, cubes, count, distances);
+#endif
+        for (; i < count; i++) {
+            distances[i] = _internal::slabEntry(ray, inverse, cubes, i);
+        }
+    }
+
+    void collide(const Plane &plane, const PointArrays &points, const PointArrays &motion, size_t count, float *times) {
+        float planeOffset = plane.normal.x * plane.position.x + plane.normal.y * plane.position.y + plane.normal.z * plane.position.z;
+        size_t i = 0;
+#ifdef SIMD_X86
+        i = _internal::sweptPointSse(plane, planeOffset, points, motion, count, times);
+#endif
+        for (; i < count; i++) {
+            times[i] = _internal::sweptPoint(plane, planeOffset, points, motion, i);
+        }
+    }
+
+    void collide(const Plane &plane, const SphereArrays &spheres, const PointArrays &motion, size_t count, float *times) {
+        float planeOffset = plane.normal.x * plane.position.x + plane.normal.y * plane.position.y + plane.normal.z * plane.position.z;
+        float inverseLength = 1.0f / std::sqrt(plane.normal.x * plane.normal.x + plane.normal.y * plane.normal.y + plane.normal.z * plane.normal.z);
+        size_t i = 0;
+#ifdef SIMD_X86
+        i = _internal::sweptSphereSse(plane, planeOffset, inverseLength, spheres, motion, count, times);
+#endif
+        for (; i < count; i++) {
+            times[i] = _internal::sweptSphere(plane, planeOffset, inverseLength, spheres, motion, i);
+        }
+    }
+}
@@ -70,4 +70,35 @@ namespace collision {
 
         return t;
     }
+
+    float collide(const Triangle &triangle, const Ray &ray) {
+        const float DETERMINANT_EPSILON = 1e-9f;
+        const float miss = -std::numeric_limits<float>::infinity();
+
+        Point e1 = {triangle.b.x - triangle.a.x, triangle.b.y - triangle.a.y, triangle.b.z - triangle.a.z};
+        Point e2 = {triangle.c.x - triangle.a.x, triangle.c.y - triangle.a.y, triangle.c.z - triangle.a.z};
+        const Point &d = ray.direction;
+
+        Point p = {d.y * e2.z - d.z * e2.y, d.z * e2.x - d.x * e2.z, d.x * e2.y - d.y * e2.x};
+        float determinant = e1.x * p.x + e1.y * p.y + e1.z * p.z;
+        // The ray is parallel to the triangle's plane
+        if (fabs(determinant) < DETERMINANT_EPSILON) {
+            return miss;
+        }
+        float inverse = 1.0f / determinant;
+
+        Point s = {ray.startPosition.x - triangle.a.x, ray.startPosition.y - triangle.a.y, ray.startPosition.z - triangle.a.z};
+        float u = (s.x * p.x + s.y * p.y + s.z * p.z) * inverse;
+        if (u < 0.0f || u > 1.0f) {
+            return miss;
+        }
+
+        Point q = {s.y * e1.z - s.z * e1.y, s.z * e1.x - s.x * e1.z, s.x * e1.y - s.y * e1.x};
+        float v = (d.x * q.x + d.y * q.y + d.z * q.z) * inverse;
+        if (v < 0.0f || u + v > 1.0f) {
+            return miss;
+        }
+
+        return (e2.x * q.x + e2.y * q.y + e2.z * q.z) * inverse;
+    }
 }
@@ -0,0 +1,526 @@
+#include "distancefield.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include "glm/vec3.hpp"
+#include "glm/geometric.hpp"
+
+#include "bvh.h"
+#include "meshcache.h"
+#include "objloader.h"
+#include "parallel.h"
+#include "platform.h"
+#include "simd.h"
+
+namespace collision {
+    namespace _internal {
+        const char DISTANCE_FIELD_MAGIC[4] = {'F', 'S', 'D', 'F'};
+        // Cells of the grid around the mesh's bounds
+        const uint32_t PADDING_CELLS = 3;
+
+        inline glm::vec3 vec3Of(const Point &p) {
+            return glm::vec3(p.x, p.y, p.z);
+        }
+
+        // Closest point on a triangle, from Ericson's "Real-Time Collision
+        // Detection", 5.1.5: find the Voronoi region of "p" first.
+        float distanceSquared(const Triangle &triangle, const glm::vec3 &p) {
+            glm::vec3 a = vec3Of(triangle.a), b = vec3Of(triangle.b), c = vec3Of(triangle.c);
+            glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+            glm::vec3 closest;
+
+            float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+            glm::vec3 bp = p - b;
+            float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+            glm::vec3 cp = p - c;
+            float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+            float va = d3 * d6 - d5 * d4;
+            float vb = d5 * d2 - d1 * d6;
+            float vc = d1 * d4 - d3 * d2;
+
+            if (d1 <= 0.0f && d2 <= 0.0f) {
+                closest = a;
+            } else if (d3 >= 0.0f && d4 <= d3) {
+                closest = b;
+            } else if (d6 >= 0.0f && d5 <= d6) {
+                closest = c;
+            } else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+                closest = a + ab * (d1 / (d1 - d3));
+            } else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+                closest = a + ac * (d2 / (d2 - d6));
+            } else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+                closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+            } else {
+                float denominator = 1.0f / (va + vb + vc);
+                closest = a + ab * (vb * denominator) + ac * (vc * denominator);
+            }
+            glm::vec3 offset = p - closest;
+            return glm::dot(offset, offset);
+        }
+
+        inline float boxDistanceSquared(const Bvh::Node &node, const glm::vec3 &p) {
+            float total = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                float d = std::max(std::max(node.boundsMin[k] - p[k], p[k] - node.boundsMax[k]), 0.0f);
+                total += d * d;
+            }
+            return total;
+        }
+
+        // Squared distance from "p" to the nearest triangle, if it is below
+        // "best"; "best" otherwise.
+        float nearestDistanceSquared(const Bvh &bvh, const std::vector<Triangle> &triangles, const glm::vec3 &p, float best) {
+            const std::vector<Bvh::Node> &nodes = bvh.nodes();
+            if (nodes.empty()) {
+                return best;
+            }
+            // One pending far child per level plus the near one on top (see
+            // Bvh::MAX_DEPTH).
+            const int STACK_SIZE = Bvh::MAX_DEPTH + 1;
+            uint32_t stack[STACK_SIZE];
+            int size = 0;
+            stack[size++] = 0;
+            while (size > 0) {
+                const Bvh::Node &node = nodes[stack[--size]];
+                if (boxDistanceSquared(node, p) >= best) {
+                    continue;
+                }
+                if (node.count > 0) {
+                    for (uint32_t i = 0; i < node.count; i++) {
+                        best = std::min(best, distanceSquared(triangles[node.leftOrFirst + i], p));
+                    }
+                    continue;
+                }
+                uint32_t near = node.leftOrFirst;
+                uint32_t far = near + 1;
+                float nearDistance = boxDistanceSquared(nodes[near], p);
+                float farDistance = boxDistanceSquared(nodes[far], p);
+                if (farDistance < nearDistance) {
+                    std::swap(near, far);
+                    std::swap(nearDistance, farDistance);
+                }
+                if (farDistance < best) {
+                    stack[size++] = far;
+                }
+                if (nearDistance < best) {
+                    stack[size++] = near;
+                }
+            }
+            return best;
+        }
+
+        inline float lerp(float a, float b, float t) {
+            return a + t * (b - a);
+        }
+
+#ifdef SIMD_X86
+        TARGET_SSE
+        inline __m128 lerp(__m128 a, __m128 b, __m128 t) {
+            return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+        }
+#endif
+    }
+
+    void DistanceField::bake(const float *positions, const uint32_t *indices, size_t triangleCount,
+                             uint32_t resolution, unsigned threads) {
+        using namespace _internal;
+        this->resolution = resolution;
+
+        // Triangles in BVH order, so leaves read contiguous memory.
+        std::vector<Cube> bounds(triangleCount);
+        std::vector<Triangle> source(triangleCount);
+        float low[3] = {std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity()};
+        float high[3] = {-low[0], -low[1], -low[2]};
+        for (size_t t = 0; t < triangleCount; t++) {
+            Point corners[3];
+            for (int k = 0; k < 3; k++) {
+                const float *p = &positions[indices[t * 3 + k] * 3];
+                corners[k] = {p[0], p[1], p[2]};
+                low[0] = std::min(low[0], p[0]); high[0] = std::max(high[0], p[0]);
+                low[1] = std::min(low[1], p[1]); high[1] = std::max(high[1], p[1]);
+                low[2] = std::min(low[2], p[2]); high[2] = std::max(high[2], p[2]);
+            }
+            source[t] = {corners[0], corners[1], corners[2]};
+            bounds[t].positionMin = {std::min(std::min(corners[0].x, corners[1].x), corners[2].x),
+                                     std::min(std::min(corners[0].y, corners[1].y), corners[2].y),
+                                     std::min(std::min(corners[0].z, corners[1].z), corners[2].z)};
+            bounds[t].positionMax = {std::max(std::max(corners[0].x, corners[1].x), corners[2].x),
+                                     std::max(std::max(corners[0].y, corners[1].y), corners[2].y),
+                                     std::max(std::max(corners[0].z, corners[1].z), corners[2].z)};
+        }
+        if (triangleCount == 0) {
+            values.clear();
+            memset(dimensions, 0, sizeof(dimensions));
+            return;
+        }
+        Bvh bvh;
+        bvh.build(bounds);
+        std::vector<Triangle> triangles(triangleCount);
+        for (size_t slot = 0; slot < triangleCount; slot++) {
+            triangles[slot] = source[bvh.primitives()[slot]];
+        }
+
+        float extent = std::max(std::max(high[0] - low[0], high[1] - low[1]), high[2] - low[2]);
+        cell = extent > 0.0f ? extent / resolution : 1.0f;
+        for (int k = 0; k < 3; k++) {
+            corner[k] = low[k] - PADDING_CELLS * cell;
+            dimensions[k] = (uint32_t) std::ceil((high[k] - low[k]) / cell) + 1 + 2 * PADDING_CELLS;
+        }
+        const size_t rowSize = dimensions[0];
+        const size_t sliceSize = rowSize * dimensions[1];
+        values.assign(sliceSize * dimensions[2], 0.0f);
+
+        // Unsigned distances, one z slice per job. The distance changes by at
+        // most one cell between neighbours, which bounds each search with
+        // the previous sample's result.
+        parallel::forChunks(dimensions[2], threads, [&](size_t, size_t begin, size_t end) {
+            for (size_t z = begin; z < end; z++) {
+                for (size_t y = 0; y < dimensions[1]; y++) {
+                    float previous = -1.0f;
+                    for (size_t x = 0; x < dimensions[0]; x++) {
+                        glm::vec3 p(corner[0] + x * cell, corner[1] + y * cell, corner[2] + z * cell);
+                        float bound = std::numeric_limits<float>::infinity();
+                        if (previous >= 0.0f) {
+                            bound = (previous + cell) * 1.001f;
+                            bound *= bound;
+                        }
+                        previous = std::sqrt(nearestDistanceSquared(bvh, triangles, p, bound));
+                        values[z * sliceSize + y * rowSize + x] = previous;
+                    }
+                }
+            }
+        });
+
+        // Signs: a ray along each axis through every row of samples, from
+        // outside the grid. A sample is inside when the ray crossed the
+        // surface an odd number of times before reaching it.
+        std::vector<uint8_t> votes(values.size(), 0);
+        const size_t strides[3] = {1, rowSize, sliceSize};
+        for (int axis = 0; axis < 3; axis++) {
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+            parallel::forChunks((size_t) dimensions[u] * dimensions[v], threads, [&](size_t, size_t begin, size_t end) {
+                std::vector<float> crossings;
+                for (size_t row = begin; row < end; row++) {
+                    size_t iu = row % dimensions[u];
+                    size_t iv = row / dimensions[u];
+                    float origin[3], direction[3] = {0.0f, 0.0f, 0.0f};
+                    origin[axis] = corner[axis] - cell;
+                    origin[u] = corner[u] + iu * cell;
+                    origin[v] = corner[v] + iv * cell;
+                    direction[axis] = 1.0f;
+                    Ray ray = {{origin[0], origin[1], origin[2]}, {direction[0], direction[1], direction[2]}};
+
+                    crossings.clear();
+                    float tMax = std::numeric_limits<float>::infinity();
+                    bvh.traverse(ray, tMax, [&](uint32_t slot, float limit) {
+                        float t = collide(triangles[slot], ray);
+                        if (t >= 0.0f) {
+                            crossings.push_back(t);
+                        }
+                        return limit;
+                    });
+                    std::sort(crossings.begin(), crossings.end());
+
+                    size_t crossed = 0;
+                    size_t index = iu * strides[u] + iv * strides[v];
+                    for (size_t i = 0; i < dimensions[axis]; i++, index += strides[axis]) {
+                        float distance = (i + 1) * cell;
+                        while (crossed < crossings.size() && crossings[crossed] < distance) {
+                            crossed++;
+                        }
+                        votes[index] += crossed & 1;
+                    }
+                }
+            });
+        }
+        for (size_t i = 0; i < values.size(); i++) {
+            if (votes[i] >= 2) {
+                values[i] = -values[i];
+            }
+        }
+    }
+
+    bool DistanceField::save(const std::string &path, uint64_t sourceHash) const {
+        DistanceFieldHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, _internal::DISTANCE_FIELD_MAGIC, 4);
+        header.version = DISTANCE_FIELD_VERSION;
+        header.sourceHash = sourceHash;
+        header.resolution = resolution;
+        memcpy(header.size, dimensions, sizeof(header.size));
+        memcpy(header.origin, corner, sizeof(header.origin));
+        header.cellSize = cell;
+
+        std::vector<char> contents(sizeof(header) + values.size() * sizeof(float));
+        memcpy(contents.data(), &header, sizeof(header));
+        memcpy(contents.data() + sizeof(header), values.data(), values.size() * sizeof(float));
+        return platform::writeFile(path, contents.data(), contents.size());
+    }
+
+    bool DistanceField::load(const std::string &path, uint64_t sourceHash, uint32_t resolution) {
+        platform::MappedFile file;
+        if (!file.open(path) || file.size() < sizeof(DistanceFieldHeader)) {
+            return false;
+        }
+        DistanceFieldHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        size_t count = (size_t) header.size[0] * header.size[1] * header.size[2];
+        if (memcmp(header.magic, _internal::DISTANCE_FIELD_MAGIC, 4) != 0 || header.version != DISTANCE_FIELD_VERSION ||
+            header.sourceHash != sourceHash || header.resolution != resolution ||
+            header.size[0] < 2 || header.size[1] < 2 || header.size[2] < 2 ||
+            file.size() != sizeof(header) + count * sizeof(float)) {
+            return false;
+        }
+
+        this->resolution = header.resolution;
+        memcpy(dimensions, header.size, sizeof(dimensions));
+        memcpy(corner, header.origin, sizeof(corner));
+        cell = header.cellSize;
+        values.resize(count);
+        memcpy(values.data(), file.data() + sizeof(header), count * sizeof(float));
+        return true;
+    }
+
+    float DistanceField::sample(const Point &point, Point *gradient) const {
+        if (empty()) {
+            if (gradient != nullptr) {
+                *gradient = {0.0f, 0.0f, 0.0f};
+            }
+            return std::numeric_limits<float>::infinity();
+        }
+        const float p[3] = {point.x, point.y, point.z};
+        const float inverseCell = 1.0f / cell;
+        float outside = 0.0f;
+        float f[3];
+        size_t base[3];
+        for (int k = 0; k < 3; k++) {
+            float high = corner[k] + (dimensions[k] - 1) * cell;
+            float clamped = std::min(std::max(p[k], corner[k]), high);
+            float d = p[k] - clamped;
+            outside += d * d;
+            float g = (clamped - corner[k]) * inverseCell;
+            float i = std::min((float) (int) g, (float) (dimensions[k] - 2));
+            f[k] = g - i;
+            base[k] = (size_t) i;
+        }
+
+        const size_t rowSize = dimensions[0];
+        const size_t sliceSize = rowSize * dimensions[1];
+        const float *c = &values[base[2] * sliceSize + base[1] * rowSize + base[0]];
+        float c000 = c[0], c100 = c[1], c010 = c[rowSize], c110 = c[rowSize + 1];
+        float c001 = c[sliceSize], c101 = c[sliceSize + 1], c011 = c[sliceSize + rowSize], c111 = c[sliceSize + rowSize + 1];
+
+        using _internal::lerp;
+        float y0 = lerp(lerp(c000, c100, f[0]), lerp(c010, c110, f[0]), f[1]);
+        float y1 = lerp(lerp(c001, c101, f[0]), lerp(c011, c111, f[0]), f[1]);
+        float distance = lerp(y0, y1, f[2]) + std::sqrt(outside);
+
+        if (gradient != nullptr) {
+            gradient->x = lerp(lerp(c100 - c000, c110 - c010, f[1]), lerp(c101 - c001, c111 - c011, f[1]), f[2]) * inverseCell;
+            gradient->y = lerp(lerp(c010 - c000, c110 - c100, f[0]), lerp(c011 - c001, c111 - c101, f[0]), f[2]) * inverseCell;
+            gradient->z = lerp(lerp(c001 - c000, c101 - c100, f[0]), lerp(c011 - c010, c111 - c110, f[0]), f[1]) * inverseCell;
+        }
+        return distance;
+    }
+
+    namespace _internal {
+#ifdef SIMD_X86
+        // The SSE version of DistanceField::sample(): the same operations
+        // in the same order, 4 points at a time. Only the corner loads are
+        // scalar. Returns how many points it did.
+        TARGET_SSE
+        size_t sampleSse(const float *values, const uint32_t *dimensions, const float *corner, float cell,
+                         const PointArrays &points, size_t count, float *distances,
+                         float *gradientX, float *gradientY, float *gradientZ) {
+            const size_t rowSize = dimensions[0];
+            const size_t sliceSize = rowSize * dimensions[1];
+            const __m128 inverseCell = _mm_set1_ps(1.0f / cell);
+            const float *coordinates[3] = {points.x, points.y, points.z};
+            bool gradients = gradientX != nullptr && gradientY != nullptr && gradientZ != nullptr;
+
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 outside = _mm_setzero_ps();
+                __m128 f[3];
+                int base[3][4];
+                for (int k = 0; k < 3; k++) {
+                    __m128 p = _mm_loadu_ps(coordinates[k] + i);
+                    __m128 low = _mm_set1_ps(corner[k]);
+                    __m128 high = _mm_set1_ps(corner[k] + (dimensions[k] - 1) * cell);
+                    __m128 clamped = _mm_min_ps(_mm_max_ps(p, low), high);
+                    __m128 d = _mm_sub_ps(p, clamped);
+                    outside = _mm_add_ps(outside, _mm_mul_ps(d, d));
+                    __m128 g = _mm_mul_ps(_mm_sub_ps(clamped, low), inverseCell);
+                    __m128 cellIndex = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(g)), _mm_set1_ps((float) (dimensions[k] - 2)));
+                    f[k] = _mm_sub_ps(g, cellIndex);
+                    _mm_storeu_si128((__m128i *) base[k], _mm_cvttps_epi32(cellIndex));
+                }
+
+                float corners[8][4];
+                for (int lane = 0; lane < 4; lane++) {
+                    const float *c = &values[base[2][lane] * sliceSize + base[1][lane] * rowSize + base[0][lane]];
+                    corners[0][lane] = c[0];
+                    corners[1][lane] = c[1];
+                    corners[2][lane] = c[rowSize];
+                    corners[3][lane] = c[rowSize + 1];
+                    corners[4][lane] = c[sliceSize];
+                    corners[5][lane] = c[sliceSize + 1];
+                    corners[6][lane] = c[sliceSize + rowSize];
+                    corners[7][lane] = c[sliceSize + rowSize + 1];
+                }
+                __m128 c000 = _mm_loadu_ps(corners[0]), c100 = _mm_loadu_ps(corners[1]);
+                __m128 c010 = _mm_loadu_ps(corners[2]), c110 = _mm_loadu_ps(corners[3]);
+                __m128 c001 = _mm_loadu_ps(corners[4]), c101 = _mm_loadu_ps(corners[5]);
+                __m128 c011 = _mm_loadu_ps(corners[6]), c111 = _mm_loadu_ps(corners[7]);
+
+                __m128 y0 = lerp(lerp(c000, c100, f[0]), lerp(c010, c110, f[0]), f[1]);
+                __m128 y1 = lerp(lerp(c001, c101, f[0]), lerp(c011, c111, f[0]), f[1]);
+                _mm_storeu_ps(distances + i, _mm_add_ps(lerp(y0, y1, f[2]), _mm_sqrt_ps(outside)));
+
+                if (gradients) {
+                    __m128 gx = lerp(lerp(_mm_sub_ps(c100, c000), _mm_sub_ps(c110, c010), f[1]),
+                                     lerp(_mm_sub_ps(c101, c001), _mm_sub_ps(c111, c011), f[1]), f[2]);
+                    __m128 gy = lerp(lerp(_mm_sub_ps(c010, c000), _mm_sub_ps(c110, c100), f[0]),
+                                     lerp(_mm_sub_ps(c011, c001), _mm_sub_ps(c111, c101), f[0]), f[2]);
+                    __m128 gz = lerp(lerp(_mm_sub_ps(c001, c000), _mm_sub_ps(c101, c100), f[0]),
+                                     lerp(_mm_sub_ps(c011, c010), _mm_sub_ps(c111, c110), f[0]), f[1]);
+                    _mm_storeu_ps(gradientX + i, _mm_mul_ps(gx, inverseCell));
+                    _mm_storeu_ps(gradientY + i, _mm_mul_ps(gy, inverseCell));
+                    _mm_storeu_ps(gradientZ + i, _mm_mul_ps(gz, inverseCell));
+                }
+            }
+            return i;
+        }
+#endif
+    }
+
+    void DistanceField::sample(const PointArrays &points, size_t count, float *distances,
+                               float *gradientX, float *gradientY, float *gradientZ) const {
+        size_t i = 0;
+#ifdef SIMD_X86
+        // The SIMD path reads the grid unchecked; sample() handles an empty
+        // field.
+        if (!empty()) {
+            i = _internal::sampleSse(values.data(), dimensions, corner, cell, points, count, distances, gradientX, gradientY, gradientZ);
+        }
+#endif
+        bool gradients = gradientX != nullptr && gradientY != nullptr && gradientZ != nullptr;
+        for (; i < count; i++) {
+            Point point = {points.x[i], points.y[i], points.z[i]};
+            Point gradient;
+            distances[i] = sample(point, gradients ? &gradient : nullptr);
+            if (gradients) {
+                gradientX[i] = gradient.x;
+                gradientY[i] = gradient.y;
+                gradientZ[i] = gradient.z;
+            }
+        }
+    }
+
+    std::string distanceFieldPathOf(const std::string &sourcePath, const std::string &cacheDirectory) {
+        std::string path = mesh::cachePathOf(sourcePath, cacheDirectory);
+        return path.substr(0, path.find_last_of('.')) + ".sdf";
+    }
+
+    bool loadOrBakeDistanceField(const std::string &sourcePath, const std::string &cacheDirectory,
+                                 uint32_t resolution, DistanceField &field) {
+        uint64_t sourceHash = mesh::hashFile(sourcePath);
+        std::string cachePath = distanceFieldPathOf(sourcePath, cacheDirectory);
+        if (field.load(cachePath, sourceHash, resolution)) {
+            return true;
+        }
+
+        mesh::MeshData mesh;
+        if (!mesh::loadObj(sourcePath, mesh)) {
+            return false;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        field.bake(mesh.positions.data(), mesh.indices.data(), mesh.triangleCount(), resolution);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("Baked \"%s\" distance field: %ux%ux%u in %.2f s (%u threads)\n", sourcePath.c_str(),
+               field.size()[0], field.size()[1], field.size()[2], elapsed, parallel::threadCount());
+
+        platform::makeDirectory(cacheDirectory);
+        if (!field.save(cachePath, sourceHash)) {
+            fprintf(stderr, "ERROR: Cannot write distance field cache \"%s\".\n", cachePath.c_str());
+        }
+        return true;
+    }
+
+    void benchmarkDistanceField(const std::string &path, uint32_t resolution) {
+        typedef std::chrono::steady_clock Clock;
+        const size_t SAMPLES = 1 << 20;
+
+        mesh::MeshData mesh;
+        if (!mesh::loadObj(path, mesh)) {
+            return;
+        }
+
+        DistanceField fields[2];
+        unsigned threadCounts[2] = {1, parallel::threadCount()};
+        double bakeTimes[2];
+        for (int i = 0; i < 2; i++) {
+            Clock::time_point start = Clock::now();
+            fields[i].bake(mesh.positions.data(), mesh.indices.data(), mesh.triangleCount(), resolution, threadCounts[i]);
+            bakeTimes[i] = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        const uint32_t *size = fields[0].size();
+        size_t inside = 0, differences = 0;
+        for (size_t z = 0; z < size[2]; z++) {
+            for (size_t y = 0; y < size[1]; y++) {
+                for (size_t x = 0; x < size[0]; x++) {
+                    Point p = {fields[0].origin()[0] + x * fields[0].cellSize(), fields[0].origin()[1] + y * fields[0].cellSize(),
+                               fields[0].origin()[2] + z * fields[0].cellSize()};
+                    float d = fields[0].sample(p);
+                    inside += d < 0.0f;
+                    differences += d != fields[1].sample(p);
+                }
+            }
+        }
+
+        std::string name = path.substr(path.find_last_of("/\\") + 1);
+        printf("%s: %zu triangles, %ux%ux%u samples, %.1f%% inside\n", name.c_str(), mesh.triangleCount(),
+               size[0], size[1], size[2], 100.0 * inside / ((double) size[0] * size[1] * size[2]));
+        printf("bake: %.2f s on 1 thread, %.2f s on %u threads (%.1fx), %zu samples differ\n",
+               bakeTimes[0], bakeTimes[1], threadCounts[1], bakeTimes[0] / bakeTimes[1], differences);
+
+        // Random points over the grid and a little past it.
+        std::mt19937 generator(7);
+        std::vector<float> coordinates[3];
+        for (int k = 0; k < 3; k++) {
+            float low = fields[0].origin()[k] - fields[0].cellSize();
+            float high = fields[0].origin()[k] + (size[k] + 1) * fields[0].cellSize();
+            std::uniform_real_distribution<float> coordinate(low, high);
+            coordinates[k].resize(SAMPLES);
+            for (size_t i = 0; i < SAMPLES; i++) {
+                coordinates[k][i] = coordinate(generator);
+            }
+        }
+        PointArrays points = {coordinates[0].data(), coordinates[1].data(), coordinates[2].data()};
+        std::vector<float> distances(SAMPLES), gradientX(SAMPLES), gradientY(SAMPLES), gradientZ(SAMPLES);
+
+        Clock::time_point start = Clock::now();
+        fields[1].sample(points, SAMPLES, distances.data(), gradientX.data(), gradientY.data(), gradientZ.data());
+        double batchTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+        size_t mismatches = 0;
+        start = Clock::now();
+        for (size_t i = 0; i < SAMPLES; i++) {
+            Point p = {coordinates[0][i], coordinates[1][i], coordinates[2][i]};
+            Point gradient;
+            float d = fields[1].sample(p, &gradient);
+            mismatches += d != distances[i] || gradient.x != gradientX[i] || gradient.y != gradientY[i] || gradient.z != gradientZ[i];
+        }
+        double scalarTime = std::chrono::duration<double>(Clock::now() - start).count();
+        printf("sample with gradient: %.1f ns scalar, %.1f ns batched, %zu mismatches\n",
+               scalarTime / SAMPLES * 1e9, batchTime / SAMPLES * 1e9, mismatches);
+    }
+}
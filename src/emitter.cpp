@@ -1,5 +1,6 @@
 #include "emitter.h"
 #include "matrices.h"
+#include "glstate.h"
 #include <iostream>
 #include <stdint.h>
 
@@ -90,7 +91,21 @@ namespace Emitter {
         }
     }
 
-    void ParticleEmitter::onRender(Renderer &renderer) {
+    void ParticleEmitter::onRender(game::RenderQueue &queue, game::StreamBuffer &stream, mesh::GeometryArena &arena,
+                                   const game::DrawPacket &prototype) {
+        size_t live = (this->particleEnd + this->particles.size() - this->particleStart) % this->particles.size();
+        if (live == 0) {
+            return;
+        }
+
+        GLintptr offset;
+        glm::mat4 *instances = (glm::mat4 *) stream.allocate(live * sizeof(glm::mat4), sizeof(glm::vec4), offset);
+        if (!instances) {
+            return;
+        }
+
+        GLsizei count = 0;
+        glm::vec4 center(0.0f);
         for (unsigned long int i = this->particleStart; i != this->particleEnd; i = (i+1) % this->particles.size()) {
             Particle &particle = this->particles[i];
 
@@ -135,11 +150,43 @@ namespace Emitter {
             model *= rz;
             model *= scale;
 
-            // Send transformation matrix to the GPU
-            glUniformMatrix4fv(renderer.model, 1, GL_FALSE, glm::value_ptr(model));
+            instances[count++] = model;
+            center += glm::vec4(x, y, z, 1.0f);
+        }
+        stream.commit();
+        if (count == 0) {
+            return;
+        }
 
-            // Draw object
-            this->proprieties.object.draw();
+        // The allocation moves every frame, so the instance attributes are
+        // pointed at it again (and the arena buffers rebound, as they may
+        // have grown).
+        if (this->vao == 0) {
+            glGenVertexArrays(1, &this->vao);
+        }
+        game::glState.bindVertexArray(this->vao);
+        if (!arena.bindBuffers(prototype.vao)) {
+            game::glState.bindVertexArray(0);
+            return;
+        }
+        game::glState.bindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+        for (GLuint column = 0; column < 4; column++) {
+            GLuint location = mesh::LOCATION_INSTANCE_MODEL + column;
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *) (offset + column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(location, 1);
+            glEnableVertexAttribArray(location);
         }
+        game::glState.bindVertexArray(0);
+
+        // One draw for the whole emitter, ordered by the particles' center
+        game::DrawPacket packet = prototype;
+        packet.vao = this->vao;
+        packet.mode = this->proprieties.object.renderingMode;
+        packet.count = this->proprieties.object.vertexCount;
+        packet.first = (uintptr_t) this->proprieties.object.vertexes;
+        packet.indexed = true;
+        packet.instances = count;
+        packet.model = Matrix_Identity();
+        queue.submit(packet, game::LAYER_OPAQUE, center / (float) count);
     }
 }
@@ -0,0 +1,254 @@
+#include "frustum.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "matrices.h"
+
+namespace collision {
+    namespace _internal {
+        inline glm::vec4 rowOf(const glm::mat4 &m, int row) {
+            return glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+        }
+
+        inline glm::vec4 normalizePlane(const glm::vec4 &plane) {
+            return plane / std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        }
+
+        // Signed distance of the box's center to "plane" and the box's
+        // extent along the plane's normal.
+        inline void project(const glm::vec4 &plane, const float *boundsMin, const float *boundsMax,
+                            float &distance, float &radius) {
+            distance = plane.w;
+            radius = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                float center = 0.5f * (boundsMin[k] + boundsMax[k]);
+                float extent = 0.5f * (boundsMax[k] - boundsMin[k]);
+                distance += plane[k] * center;
+                radius += std::fabs(plane[k]) * extent;
+            }
+        }
+    }
+
+    Frustum Frustum::fromMatrix(const glm::mat4 &viewProjection) {
+        using namespace _internal;
+        // A clip space point is visible when -w <= x, y, z <= w; with w, x,
+        // y and z the dot products of the rows with the world point.
+        glm::vec4 x = rowOf(viewProjection, 0);
+        glm::vec4 y = rowOf(viewProjection, 1);
+        glm::vec4 z = rowOf(viewProjection, 2);
+        glm::vec4 w = rowOf(viewProjection, 3);
+
+        Frustum frustum;
+        frustum.planes[PLANE_LEFT] = normalizePlane(w + x);
+        frustum.planes[PLANE_RIGHT] = normalizePlane(w - x);
+        frustum.planes[PLANE_BOTTOM] = normalizePlane(w + y);
+        frustum.planes[PLANE_TOP] = normalizePlane(w - y);
+        frustum.planes[PLANE_NEAR] = normalizePlane(w + z);
+        frustum.planes[PLANE_FAR] = normalizePlane(w - z);
+        return frustum;
+    }
+
+    bool Frustum::intersects(const Cube &box) const {
+        const float boundsMin[3] = {box.positionMin.x, box.positionMin.y, box.positionMin.z};
+        const float boundsMax[3] = {box.positionMax.x, box.positionMax.y, box.positionMax.z};
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            float distance, radius;
+            _internal::project(planes[i], boundsMin, boundsMax, distance, radius);
+            if (distance < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool FrustumCuller::classify(const float *boundsMin, const float *boundsMax, const Frustum &frustum,
+                                 uint8_t &mask, uint8_t &lastPlane) {
+        for (int i = 0; i < Frustum::PLANE_COUNT; i++) {
+            int plane = (lastPlane + i) % Frustum::PLANE_COUNT;
+            uint8_t bit = (uint8_t) (1u << plane);
+            if ((mask & bit) == 0) {
+                continue;
+            }
+            stats.planeTests++;
+            float distance, radius;
+            _internal::project(frustum.planes[plane], boundsMin, boundsMax, distance, radius);
+            if (distance < -radius) {
+                if (plane == lastPlane) {
+                    stats.coherentRejections++;
+                }
+                lastPlane = (uint8_t) plane;
+                return false;
+            }
+            if (distance >= radius) {
+                mask &= (uint8_t) ~bit;
+            }
+        }
+        return true;
+    }
+
+    void FrustumCuller::cull(const SceneBvh &scene, const Frustum &frustum, std::vector<uint32_t> &visible) {
+        const std::vector<Bvh::Node> &nodes = scene.hierarchy().nodes();
+        const std::vector<uint32_t> &order = scene.hierarchy().primitives();
+        stats = CullStatistics();
+        visible.clear();
+
+        // A rebuilt hierarchy keeps the old hints when its size did not
+        // change; they only decide which plane is tested first.
+        if (nodePlanes.size() != nodes.size()) {
+            nodePlanes.assign(nodes.size(), 0);
+        }
+        if (objectPlanes.size() != scene.objectCount()) {
+            objectPlanes.assign(scene.objectCount(), 0);
+        }
+        if (nodes.empty()) {
+            return;
+        }
+
+        struct Entry {
+            uint32_t node;
+            uint8_t mask;
+        };
+        const uint8_t ALL_PLANES = (uint8_t) ((1u << Frustum::PLANE_COUNT) - 1);
+        // Both children are pushed together, so the stack holds at most one
+        // pending child per level plus the top one (see Bvh::MAX_DEPTH).
+        const int STACK_SIZE = Bvh::MAX_DEPTH + 1;
+        Entry stack[STACK_SIZE];
+        int size = 0;
+        stack[size].node = 0;
+        stack[size++].mask = ALL_PLANES;
+
+        while (size > 0) {
+            Entry entry = stack[--size];
+            const Bvh::Node &node = nodes[entry.node];
+            uint8_t mask = entry.mask;
+            stats.nodesVisited++;
+            if (mask != 0) {
+                if (!classify(node.boundsMin, node.boundsMax, frustum, mask, nodePlanes[entry.node])) {
+                    continue;
+                }
+                if (mask == 0) {
+                    stats.acceptedSubtrees++;
+                }
+            }
+
+            if (node.count == 0) {
+                stack[size].node = node.leftOrFirst + 1;
+                stack[size++].mask = mask;
+                stack[size].node = node.leftOrFirst;
+                stack[size++].mask = mask;
+                continue;
+            }
+
+            // Leaves hold a few objects: each one is tested against the
+            // planes the leaf straddles.
+            for (uint32_t i = 0; i < node.count; i++) {
+                uint32_t object = order[node.leftOrFirst + i];
+                uint8_t objectMask = mask;
+                if (objectMask != 0) {
+                    const Cube &box = scene.objectBounds(object);
+                    const float boundsMin[3] = {box.positionMin.x, box.positionMin.y, box.positionMin.z};
+                    const float boundsMax[3] = {box.positionMax.x, box.positionMax.y, box.positionMax.z};
+                    if (!classify(boundsMin, boundsMax, frustum, objectMask, objectPlanes[object])) {
+                        continue;
+                    }
+                }
+                visible.push_back(scene.objectId(object));
+            }
+        }
+
+        stats.visible = visible.size();
+        stats.culled = scene.objectCount() - visible.size();
+    }
+
+    void benchmarkFrustumCulling() {
+        typedef std::chrono::steady_clock Clock;
+        const size_t COUNT = 10000;
+        const int FRAMES = 200;
+        const float SIDE = 400.0f;
+
+        // Every object instances the same unit cube.
+        const float positions[] = {
+            0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0,
+            0, 0, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1,
+        };
+        const uint32_t indices[] = {
+            0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6,
+            0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7,
+            0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5,
+        };
+        TriangleBvh cube;
+        cube.build(positions, indices, 12);
+
+        std::mt19937 generator(3);
+        std::uniform_real_distribution<float> position(-0.5f * SIDE, 0.5f * SIDE);
+        std::uniform_real_distribution<float> size(0.5f, 4.0f);
+        SceneBvh scene;
+        for (size_t i = 0; i < COUNT; i++) {
+            float s = size(generator);
+            scene.add(&cube, Matrix_Translate(position(generator), position(generator), position(generator)) * Matrix_Scale(s, s, s), (uint32_t) i);
+        }
+        scene.build();
+
+        FrustumCuller culler;
+        std::vector<uint32_t> visible, expected;
+        double cullTime = 0.0, bruteTime = 0.0;
+        size_t visibleCount = 0, nodeCount = 0, planeTests = 0, brutePlaneTests = 0, coherent = 0, accepted = 0;
+        bool agree = true;
+        for (int frame = 0; frame < FRAMES; frame++) {
+            // Orbits the center of the boxes, from inside the cloud.
+            float angle = 0.01f * frame;
+            glm::vec4 eye(100.0f * std::cos(angle), 20.0f, 100.0f * std::sin(angle), 1.0f);
+            glm::mat4 view = Matrix_Camera_View(eye, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) - eye, glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+            glm::mat4 projection = Matrix_Perspective(3.141592f / 3.0f, 16.0f / 9.0f, -0.1f, -300.0f);
+            Frustum frustum = Frustum::fromMatrix(projection * view);
+
+            Clock::time_point start = Clock::now();
+            culler.cull(scene, frustum, visible);
+            cullTime += std::chrono::duration<double>(Clock::now() - start).count();
+            const CullStatistics &stats = culler.statistics();
+            visibleCount += stats.visible;
+            nodeCount += stats.nodesVisited;
+            planeTests += stats.planeTests;
+            coherent += stats.coherentRejections;
+            accepted += stats.acceptedSubtrees;
+
+            start = Clock::now();
+            expected.clear();
+            for (uint32_t i = 0; i < scene.objectCount(); i++) {
+                if (frustum.intersects(scene.objectBounds(i))) {
+                    expected.push_back(scene.objectId(i));
+                }
+            }
+            bruteTime += std::chrono::duration<double>(Clock::now() - start).count();
+
+            // The brute force test stops at the first plane that rejects
+            // the box, as intersects() does.
+            for (uint32_t i = 0; i < scene.objectCount(); i++) {
+                const Cube &box = scene.objectBounds(i);
+                for (int p = 0; p < Frustum::PLANE_COUNT; p++) {
+                    brutePlaneTests++;
+                    const float boundsMin[3] = {box.positionMin.x, box.positionMin.y, box.positionMin.z};
+                    const float boundsMax[3] = {box.positionMax.x, box.positionMax.y, box.positionMax.z};
+                    float distance, radius;
+                    _internal::project(frustum.planes[p], boundsMin, boundsMax, distance, radius);
+                    if (distance < -radius) {
+                        break;
+                    }
+                }
+            }
+
+            std::sort(visible.begin(), visible.end());
+            agree = agree && visible == expected;
+        }
+
+        printf("%zu boxes, %d frames: %zu visible per frame\n", COUNT, FRAMES, visibleCount / FRAMES);
+        printf("hierarchical: %.3f ms, %zu nodes, %zu plane tests, %zu coherent rejections, %zu subtrees accepted per frame\n",
+               cullTime / FRAMES * 1e3, nodeCount / FRAMES, planeTests / FRAMES, coherent / FRAMES, accepted / FRAMES);
+        printf("every box:    %.3f ms, %zu plane tests per frame\n", bruteTime / FRAMES * 1e3, brutePlaneTests / FRAMES);
+        printf("speedup %.1fx, results %s\n", bruteTime / cullTime, agree ? "agree" : "DIFFER");
+    }
+}
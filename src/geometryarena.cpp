@@ -0,0 +1,306 @@
+#include "geometryarena.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "glstate.h"
+
+namespace mesh {
+    void RangeAllocator::init(uint32_t capacity) {
+        byOffset.clear();
+        bySize.clear();
+        total = 0;
+        allocated = 0;
+        grow(capacity);
+    }
+
+    void RangeAllocator::grow(uint32_t newCapacity) {
+        if (newCapacity <= total) {
+            return;
+        }
+        uint32_t offset = total;
+        total = newCapacity;
+        // Released as if it had been allocated, so it merges with a free
+        // block at the old end.
+        allocated += newCapacity - offset;
+        free(offset, newCapacity - offset);
+    }
+
+    void RangeAllocator::insertFree(uint32_t offset, uint32_t size) {
+        byOffset[offset] = size;
+        bySize.insert(std::make_pair(size, offset));
+    }
+
+    void RangeAllocator::eraseFree(std::map<uint32_t, uint32_t>::iterator block) {
+        std::pair<std::multimap<uint32_t, uint32_t>::iterator, std::multimap<uint32_t, uint32_t>::iterator> range =
+                bySize.equal_range(block->second);
+        for (std::multimap<uint32_t, uint32_t>::iterator i = range.first; i != range.second; ++i) {
+            if (i->second == block->first) {
+                bySize.erase(i);
+                break;
+            }
+        }
+        byOffset.erase(block);
+    }
+
+    bool RangeAllocator::allocate(uint32_t size, uint32_t &offset) {
+        if (size == 0) {
+            offset = 0;
+            return true;
+        }
+        std::multimap<uint32_t, uint32_t>::iterator fit = bySize.lower_bound(size);
+        if (fit == bySize.end()) {
+            return false;
+        }
+        uint32_t blockOffset = fit->second;
+        uint32_t blockSize = fit->first;
+        bySize.erase(fit);
+        byOffset.erase(blockOffset);
+        if (blockSize > size) {
+            insertFree(blockOffset + size, blockSize - size);
+        }
+        offset = blockOffset;
+        allocated += size;
+        return true;
+    }
+
+    void RangeAllocator::free(uint32_t offset, uint32_t size) {
+        if (size == 0) {
+            return;
+        }
+        allocated -= size;
+
+        // Merge with the free block that ends where this one starts and
+        // with the one that starts where it ends.
+        std::map<uint32_t, uint32_t>::iterator next = byOffset.lower_bound(offset);
+        if (next != byOffset.begin()) {
+            std::map<uint32_t, uint32_t>::iterator previous = next;
+            --previous;
+            if (previous->first + previous->second == offset) {
+                offset = previous->first;
+                size += previous->second;
+                eraseFree(previous);
+            }
+        }
+        if (next != byOffset.end() && offset + size == next->first) {
+            size += next->second;
+            eraseFree(next);
+        }
+        insertFree(offset, size);
+    }
+
+    void GeometryArena::init(uint32_t initialVertices, uint32_t initialIndices) {
+        destroy();
+        this->initialVertices = initialVertices;
+        glGenBuffers(1, &indexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr) initialIndices * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        indices.init(initialIndices);
+    }
+
+    void GeometryArena::destroy() {
+        for (size_t i = 0; i < pools.size(); i++) {
+            game::glState.forgetVertexArray(pools[i]->vao);
+            game::glState.forgetBuffer(pools[i]->vertexBuffer);
+            glDeleteVertexArrays(1, &pools[i]->vao);
+            glDeleteBuffers(1, &pools[i]->vertexBuffer);
+            delete pools[i];
+        }
+        pools.clear();
+        if (indexBuffer != 0) {
+            game::glState.forgetBuffer(indexBuffer);
+            glDeleteBuffers(1, &indexBuffer);
+            indexBuffer = 0;
+        }
+    }
+
+    bool GeometryArena::bindBuffers(GLuint vao) {
+        for (size_t i = 0; i < pools.size(); i++) {
+            if (pools[i]->vao == vao) {
+                game::glState.bindBuffer(GL_ARRAY_BUFFER, pools[i]->vertexBuffer);
+                applyLayout(pools[i]->layout);
+                game::glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    GeometryArena::Pool *GeometryArena::poolOf(const VertexLayout &layout) {
+        for (size_t i = 0; i < pools.size(); i++) {
+            if (memcmp(&pools[i]->layout, &layout, sizeof(layout)) == 0) {
+                return pools[i];
+            }
+        }
+
+        Pool *pool = new Pool();
+        pool->layout = layout;
+        glGenBuffers(1, &pool->vertexBuffer);
+        glGenVertexArrays(1, &pool->vao);
+        game::glState.bindVertexArray(pool->vao);
+        game::glState.bindBuffer(GL_ARRAY_BUFFER, pool->vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) initialVertices * layout.stride, nullptr, GL_STATIC_DRAW);
+        applyLayout(layout);
+        game::glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        game::glState.bindVertexArray(0);
+        pool->vertices.init(initialVertices);
+        pools.push_back(pool);
+        return pool;
+    }
+
+    void GeometryArena::growVertices(Pool &pool, uint32_t needed) {
+        uint32_t capacity = pool.vertices.capacity();
+        uint32_t newCapacity = capacity * 2 > capacity + needed ? capacity * 2 : capacity + needed;
+
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr) newCapacity * pool.layout.stride, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, pool.vertexBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr) capacity * pool.layout.stride);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        game::glState.forgetBuffer(pool.vertexBuffer);
+        glDeleteBuffers(1, &pool.vertexBuffer);
+        pool.vertexBuffer = buffer;
+
+        game::glState.bindVertexArray(pool.vao);
+        game::glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+        applyLayout(pool.layout);
+        game::glState.bindVertexArray(0);
+        pool.vertices.grow(newCapacity);
+    }
+
+    void GeometryArena::growIndices(uint32_t needed) {
+        uint32_t capacity = indices.capacity();
+        uint32_t newCapacity = capacity * 2 > capacity + needed ? capacity * 2 : capacity + needed;
+
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr) newCapacity * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, indexBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr) capacity * sizeof(uint32_t));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        game::glState.forgetBuffer(indexBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+        indexBuffer = buffer;
+
+        // The element buffer is VAO state: every pool points at the new one.
+        for (size_t i = 0; i < pools.size(); i++) {
+            game::glState.bindVertexArray(pools[i]->vao);
+            game::glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+        }
+        game::glState.bindVertexArray(0);
+        indices.grow(newCapacity);
+    }
+
+    bool GeometryArena::allocate(const VertexLayout &layout, uint32_t vertexCount, uint32_t indexCount, GpuMesh &mesh) {
+        Pool *pool = poolOf(layout);
+
+        uint32_t firstVertex;
+        if (!pool->vertices.allocate(vertexCount, firstVertex)) {
+            growVertices(*pool, vertexCount);
+            if (!pool->vertices.allocate(vertexCount, firstVertex)) {
+                return false;
+            }
+        }
+        uint32_t firstIndex;
+        if (!indices.allocate(indexCount, firstIndex)) {
+            growIndices(indexCount);
+            if (!indices.allocate(indexCount, firstIndex)) {
+                pool->vertices.free(firstVertex, vertexCount);
+                return false;
+            }
+        }
+
+        mesh.vao = pool->vao;
+        mesh.vertexBuffer = 0;
+        mesh.indexBuffer = 0;
+        mesh.baseVertex = (GLint) firstVertex;
+        mesh.firstIndex = firstIndex;
+        mesh.vertexCount = vertexCount;
+        mesh.indexTotal = indexCount;
+        mesh.layout = layout;
+        mesh.inArena = true;
+        return true;
+    }
+
+    void GeometryArena::release(GpuMesh &mesh) {
+        if (!mesh.inArena) {
+            return;
+        }
+        poolOf(mesh.layout)->vertices.free((uint32_t) mesh.baseVertex, mesh.vertexCount);
+        indices.free(mesh.firstIndex, mesh.indexTotal);
+        mesh.vao = 0;
+        mesh.inArena = false;
+    }
+
+    void GeometryArena::write(const GpuMesh &mesh, const void *vertices, const void *indexData) {
+        Pool *pool = poolOf(mesh.layout);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool->vertexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr) mesh.baseVertex * mesh.layout.stride,
+                        (GLsizeiptr) mesh.vertexCount * mesh.layout.stride, vertices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr) mesh.firstIndex * sizeof(uint32_t),
+                        (GLsizeiptr) mesh.indexTotal * sizeof(uint32_t), indexData);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    bool GeometryArena::upload(const MeshFile &file, GpuMesh &mesh) {
+        const MeshFileHeader &header = file.info();
+        // Fills everything but the buffers from the header.
+        GpuMesh described;
+        described.indexCount = (GLsizei) header.lods[0].indexCount;
+        described.lodCount = header.lodCount;
+        memcpy(described.lods, header.lods, sizeof(described.lods));
+        memcpy(described.boundsMin, header.boundsMin, sizeof(described.boundsMin));
+        memcpy(described.boundsMax, header.boundsMax, sizeof(described.boundsMax));
+        memcpy(described.positionScale, header.positionScale, sizeof(described.positionScale));
+        memcpy(described.positionOffset, header.positionOffset, sizeof(described.positionOffset));
+        if (!allocate(header.layout, header.vertexCount, header.indexCount, described)) {
+            return false;
+        }
+        write(described, file.vertexData(), file.indexData());
+        mesh = described;
+        return true;
+    }
+
+    bool GeometryArena::adopt(GpuMesh &mesh) {
+        GpuMesh staged = mesh;
+        if (!allocate(staged.layout, staged.vertexCount, staged.indexTotal, mesh)) {
+            return false;
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, staged.vertexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, poolOf(mesh.layout)->vertexBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, (GLintptr) mesh.baseVertex * mesh.layout.stride,
+                            (GLsizeiptr) mesh.vertexCount * mesh.layout.stride);
+        glBindBuffer(GL_COPY_READ_BUFFER, staged.indexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, (GLintptr) mesh.firstIndex * sizeof(uint32_t),
+                            (GLsizeiptr) mesh.indexTotal * sizeof(uint32_t));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        game::glState.forgetBuffer(staged.vertexBuffer);
+        game::glState.forgetBuffer(staged.indexBuffer);
+        glDeleteBuffers(1, &staged.vertexBuffer);
+        glDeleteBuffers(1, &staged.indexBuffer);
+        return true;
+    }
+
+    void GeometryArena::printStatistics() const {
+        printf("Geometry arena: %zu vertex format(s), indices %u/%u used (%zu free block(s))\n",
+               pools.size(), indices.used(), indices.capacity(), indices.freeBlocks());
+        for (size_t i = 0; i < pools.size(); i++) {
+            const Pool &pool = *pools[i];
+            printf("  stride %u: vertices %u/%u used (%zu free block(s))\n", pool.layout.stride,
+                   pool.vertices.used(), pool.vertices.capacity(), pool.vertices.freeBlocks());
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#include "glext.h"
+
+#include <cstring>
+
+namespace glext {
+    bool programBinary = false;
+    GetProgramBinaryProc GetProgramBinary = nullptr;
+    ProgramBinaryProc ProgramBinary = nullptr;
+    ProgramParameteriProc ProgramParameteri = nullptr;
+    bool parallelShaderCompile = false;
+    MaxShaderCompilerThreadsProc MaxShaderCompilerThreads = nullptr;
+    bool bufferStorage = false;
+    BufferStorageProc BufferStorage = nullptr;
+
+    bool hasExtension(const char *name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char *extension = (const char *) glGetStringi(GL_EXTENSIONS, i);
+            if (extension != nullptr && strcmp(extension, name) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool hasVersion(int major, int minor) {
+        GLint contextMajor = 0, contextMinor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+        glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+        return contextMajor > major || (contextMajor == major && contextMinor >= minor);
+    }
+
+    void load(GLADloadproc loader) {
+        if (hasVersion(4, 1) || hasExtension("GL_ARB_get_program_binary")) {
+            GetProgramBinary = (GetProgramBinaryProc) loader("glGetProgramBinary");
+            ProgramBinary = (ProgramBinaryProc) loader("glProgramBinary");
+            ProgramParameteri = (ProgramParameteriProc) loader("glProgramParameteri");
+
+            // Some drivers expose the extension without any binary format,
+            // in which case glGetProgramBinary always fails.
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            programBinary = GetProgramBinary && ProgramBinary && ProgramParameteri && formats > 0;
+        }
+
+        if (hasExtension("GL_KHR_parallel_shader_compile")) {
+            MaxShaderCompilerThreads = (MaxShaderCompilerThreadsProc) loader("glMaxShaderCompilerThreadsKHR");
+        } else if (hasExtension("GL_ARB_parallel_shader_compile")) {
+            MaxShaderCompilerThreads = (MaxShaderCompilerThreadsProc) loader("glMaxShaderCompilerThreadsARB");
+        }
+        parallelShaderCompile = MaxShaderCompilerThreads != nullptr;
+        if (parallelShaderCompile) {
+            // 0xFFFFFFFF lets the driver pick the number of threads.
+            MaxShaderCompilerThreads(0xFFFFFFFFu);
+        }
+
+        if (hasVersion(4, 4) || hasExtension("GL_ARB_buffer_storage")) {
+            BufferStorage = (BufferStorageProc) loader("glBufferStorage");
+        }
+        bufferStorage = BufferStorage != nullptr;
+    }
+}
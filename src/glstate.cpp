@@ -0,0 +1,184 @@
+#include "glstate.h"
+
+#include <cstdio>
+
+namespace game {
+    namespace _internal {
+        // Values that never match a real GL value, so the first call always
+        // reaches the driver.
+        const GLuint UNKNOWN_NAME = 0xFFFFFFFFu;
+        const GLenum UNKNOWN_ENUM = 0xFFFFFFFFu;
+        const int UNKNOWN_FLAG = -1;
+
+        const char *KIND_NAMES[GLState::KIND_COUNT] = {
+                "program", "vertex array", "buffer", "texture", "depth", "blend", "cull", "polygon mode", "line width"
+        };
+    }
+
+    GLState glState;
+
+    GLState::GLState() {
+        invalidate();
+    }
+
+    void GLState::invalidate() {
+        currentProgram = _internal::UNKNOWN_NAME;
+        currentVertexArray = _internal::UNKNOWN_NAME;
+        currentArrayBuffer = _internal::UNKNOWN_NAME;
+        currentElementBuffer = _internal::UNKNOWN_NAME;
+        activeUnit = -1;
+        for (int i = 0; i < TEXTURE_UNITS; i++) {
+            currentTextures[i] = _internal::UNKNOWN_NAME;
+        }
+        depthTest = _internal::UNKNOWN_FLAG;
+        currentDepthFunc = _internal::UNKNOWN_ENUM;
+        currentDepthMask = _internal::UNKNOWN_FLAG;
+        blend = _internal::UNKNOWN_FLAG;
+        blendSrc = _internal::UNKNOWN_ENUM;
+        blendDst = _internal::UNKNOWN_ENUM;
+        cullFace = _internal::UNKNOWN_FLAG;
+        currentPolygonMode = _internal::UNKNOWN_ENUM;
+        currentLineWidth = -1.0f;
+    }
+
+    void GLState::useProgram(GLuint program) {
+        if (changed(PROGRAM, program != currentProgram)) {
+            glUseProgram(program);
+            currentProgram = program;
+        }
+    }
+
+    void GLState::bindVertexArray(GLuint vao) {
+        if (changed(VERTEX_ARRAY, vao != currentVertexArray)) {
+            glBindVertexArray(vao);
+            currentVertexArray = vao;
+            // The element buffer binding is part of the VAO state.
+            currentElementBuffer = _internal::UNKNOWN_NAME;
+        }
+    }
+
+    void GLState::bindBuffer(GLenum target, GLuint buffer) {
+        GLuint *current = nullptr;
+        if (target == GL_ARRAY_BUFFER) {
+            current = &currentArrayBuffer;
+        } else if (target == GL_ELEMENT_ARRAY_BUFFER) {
+            current = &currentElementBuffer;
+        }
+
+        if (current == nullptr) {
+            counters[BUFFER].issued += 1;
+            glBindBuffer(target, buffer);
+        } else if (changed(BUFFER, buffer != *current)) {
+            glBindBuffer(target, buffer);
+            *current = buffer;
+        }
+    }
+
+    void GLState::bindTexture(int unit, GLenum target, GLuint texture) {
+        // Only GL_TEXTURE_2D is used, so one binding per unit is enough.
+        if (!changed(TEXTURE, texture != currentTextures[unit])) {
+            return;
+        }
+        if (unit != activeUnit) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            activeUnit = unit;
+        }
+        glBindTexture(target, texture);
+        currentTextures[unit] = texture;
+    }
+
+    void GLState::setDepthTest(bool enabled) {
+        if (changed(DEPTH, (int) enabled != depthTest)) {
+            if (enabled) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
+            depthTest = enabled;
+        }
+    }
+
+    void GLState::depthFunc(GLenum func) {
+        if (changed(DEPTH, func != currentDepthFunc)) {
+            glDepthFunc(func);
+            currentDepthFunc = func;
+        }
+    }
+
+    void GLState::depthMask(bool write) {
+        if (changed(DEPTH, (int) write != currentDepthMask)) {
+            glDepthMask(write ? GL_TRUE : GL_FALSE);
+            currentDepthMask = write;
+        }
+    }
+
+    void GLState::setBlend(bool enabled) {
+        if (changed(BLEND, (int) enabled != blend)) {
+            if (enabled) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+            blend = enabled;
+        }
+    }
+
+    void GLState::blendFunc(GLenum src, GLenum dst) {
+        if (changed(BLEND, src != blendSrc || dst != blendDst)) {
+            glBlendFunc(src, dst);
+            blendSrc = src;
+            blendDst = dst;
+        }
+    }
+
+    void GLState::setCullFace(bool enabled) {
+        if (changed(CULL, (int) enabled != cullFace)) {
+            if (enabled) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+            cullFace = enabled;
+        }
+    }
+
+    void GLState::polygonMode(GLenum mode) {
+        if (changed(POLYGON_MODE, mode != currentPolygonMode)) {
+            glPolygonMode(GL_FRONT_AND_BACK, mode);
+            currentPolygonMode = mode;
+        }
+    }
+
+    void GLState::lineWidth(float width) {
+        if (changed(LINE_WIDTH, width != currentLineWidth)) {
+            glLineWidth(width);
+            currentLineWidth = width;
+        }
+    }
+
+    void GLState::forgetProgram(GLuint program) {
+        if (currentProgram == program) currentProgram = _internal::UNKNOWN_NAME;
+    }
+
+    void GLState::forgetVertexArray(GLuint vao) {
+        if (currentVertexArray == vao) {
+            currentVertexArray = _internal::UNKNOWN_NAME;
+            currentElementBuffer = _internal::UNKNOWN_NAME;
+        }
+    }
+
+    void GLState::forgetBuffer(GLuint buffer) {
+        if (currentArrayBuffer == buffer) currentArrayBuffer = _internal::UNKNOWN_NAME;
+        if (currentElementBuffer == buffer) currentElementBuffer = _internal::UNKNOWN_NAME;
+    }
+
+    GLState::Counter GLState::total() const {
+        Counter sum;
+        for (int i = 0; i < KIND_COUNT; i++) {
+            sum.issued += counters[i].issued;
+            sum.skipped += counters[i].skipped;
+        }
+        return sum;
+    }
+
+    void GLState::resetStatistics() {
+        for (int i = 0; i < KIND_COUNT; i++) {
+            counters[i] = Counter();
+        }
+    }
+
+    void GLState::printStatistics() const {
+        printf("GL state calls (issued / skipped):\n");
+        for (int i = 0; i < KIND_COUNT; i++) {
+            printf("  %-13s %8lu / %8lu\n", _internal::KIND_NAMES[i], counters[i].issued, counters[i].skipped);
+        }
+    }
+}
@@ -0,0 +1,374 @@
+#include "headless.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+#include "platform.h"
+
+namespace platform {
+    namespace _internal {
+        // The few EGL and OSMesa declarations we need: their headers are not
+        // vendored and may be missing on the build host.
+        typedef int32_t EGLint;
+        typedef unsigned int EGLBoolean;
+        typedef unsigned int EGLenum;
+        typedef void *EGLDisplay;
+        typedef void *EGLConfig;
+        typedef void *EGLContext;
+        typedef void *EGLSurface;
+
+        const EGLint EGL_NONE = 0x3038;
+        const EGLint EGL_EXTENSIONS = 0x3055;
+        const EGLint EGL_RENDERABLE_TYPE = 0x3040;
+        const EGLint EGL_OPENGL_BIT = 0x0008;
+        const EGLenum EGL_OPENGL_API = 0x30A2;
+        const EGLint EGL_CONTEXT_MAJOR_VERSION = 0x3098;
+        const EGLint EGL_CONTEXT_MINOR_VERSION = 0x30FB;
+        const EGLint EGL_CONTEXT_OPENGL_PROFILE_MASK = 0x30FD;
+        const EGLint EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT = 0x0001;
+        const EGLenum EGL_PLATFORM_SURFACELESS_MESA = 0x31DD;
+
+        typedef void *(*EglGetProcAddressProc)(const char *name);
+        typedef EGLDisplay (*EglGetPlatformDisplayProc)(EGLenum platform, void *nativeDisplay, const EGLint *attributes);
+        typedef EGLDisplay (*EglGetDisplayProc)(void *nativeDisplay);
+        typedef EGLBoolean (*EglInitializeProc)(EGLDisplay display, EGLint *major, EGLint *minor);
+        typedef EGLBoolean (*EglTerminateProc)(EGLDisplay display);
+        typedef const char *(*EglQueryStringProc)(EGLDisplay display, EGLint name);
+        typedef EGLBoolean (*EglBindApiProc)(EGLenum api);
+        typedef EGLBoolean (*EglChooseConfigProc)(EGLDisplay display, const EGLint *attributes, EGLConfig *configs,
+                                                  EGLint size, EGLint *count);
+        typedef EGLContext (*EglCreateContextProc)(EGLDisplay display, EGLConfig config, EGLContext share,
+                                                   const EGLint *attributes);
+        typedef EGLBoolean (*EglDestroyContextProc)(EGLDisplay display, EGLContext context);
+        typedef EGLBoolean (*EglMakeCurrentProc)(EGLDisplay display, EGLSurface draw, EGLSurface read, EGLContext context);
+
+        const int OSMESA_DEPTH_BITS = 0x30;
+        const int OSMESA_STENCIL_BITS = 0x31;
+        const int OSMESA_ACCUM_BITS = 0x32;
+        const int OSMESA_PROFILE = 0x33;
+        const int OSMESA_CORE_PROFILE = 0x34;
+        const int OSMESA_CONTEXT_MAJOR_VERSION = 0x36;
+        const int OSMESA_CONTEXT_MINOR_VERSION = 0x37;
+        const int OSMESA_FORMAT = 0x22;
+
+        typedef void *(*OsMesaCreateContextAttribsProc)(const int *attributes, void *share);
+        typedef void (*OsMesaDestroyContextProc)(void *context);
+        typedef GLboolean (*OsMesaMakeCurrentProc)(void *context, void *buffer, GLenum type, GLsizei width, GLsizei height);
+        typedef void *(*OsMesaGetProcAddressProc)(const char *name);
+
+        // Loader of the context made current by create()
+        void *(*procAddressLoader)(const char *name) = nullptr;
+
+        void *openLibrary(const char *const *names) {
+#ifdef _WIN32
+            (void) names;
+            return nullptr;
+#else
+            for (int i = 0; names[i] != nullptr; i++) {
+                void *library = dlopen(names[i], RTLD_NOW | RTLD_LOCAL);
+                if (library != nullptr) {
+                    return library;
+                }
+            }
+            return nullptr;
+#endif
+        }
+
+        void *symbol(void *library, const char *name) {
+#ifdef _WIN32
+            (void) library;
+            (void) name;
+            return nullptr;
+#else
+            return dlsym(library, name);
+#endif
+        }
+
+        void closeLibrary(void *library) {
+#ifndef _WIN32
+            if (library != nullptr) {
+                dlclose(library);
+            }
+#else
+            (void) library;
+#endif
+        }
+
+        bool hasToken(const char *list, const char *token) {
+            size_t length = strlen(token);
+            for (const char *at = list; list != nullptr && (at = strstr(at, token)) != nullptr; at += length) {
+                bool starts = at == list || at[-1] == ' ';
+                bool ends = at[length] == ' ' || at[length] == '\0';
+                if (starts && ends) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    void *HeadlessContext::getProcAddress(const char *name) {
+        return _internal::procAddressLoader != nullptr ? _internal::procAddressLoader(name) : nullptr;
+    }
+
+    bool HeadlessContext::createEgl() {
+        using namespace _internal;
+        const char *const names[] = {"libEGL.so.1", "libEGL.so", nullptr};
+        library = openLibrary(names);
+        if (library == nullptr) {
+            return false;
+        }
+
+        EglGetProcAddressProc eglGetProcAddress = (EglGetProcAddressProc) symbol(library, "eglGetProcAddress");
+        EglGetDisplayProc eglGetDisplay = (EglGetDisplayProc) symbol(library, "eglGetDisplay");
+        EglInitializeProc eglInitialize = (EglInitializeProc) symbol(library, "eglInitialize");
+        EglQueryStringProc eglQueryString = (EglQueryStringProc) symbol(library, "eglQueryString");
+        EglBindApiProc eglBindAPI = (EglBindApiProc) symbol(library, "eglBindAPI");
+        EglChooseConfigProc eglChooseConfig = (EglChooseConfigProc) symbol(library, "eglChooseConfig");
+        EglCreateContextProc eglCreateContext = (EglCreateContextProc) symbol(library, "eglCreateContext");
+        EglMakeCurrentProc eglMakeCurrent = (EglMakeCurrentProc) symbol(library, "eglMakeCurrent");
+        if (!eglGetProcAddress || !eglGetDisplay || !eglInitialize || !eglQueryString || !eglBindAPI ||
+            !eglChooseConfig || !eglCreateContext || !eglMakeCurrent) {
+            fprintf(stderr, "WARNING: libEGL lacks core entry points.\n");
+            return false;
+        }
+
+        // The surfaceless platform needs no display server; the default
+        // display is the fallback (it may still find one).
+        const char *clientExtensions = eglQueryString(nullptr, EGL_EXTENSIONS);
+        EglGetPlatformDisplayProc eglGetPlatformDisplay = (EglGetPlatformDisplayProc) eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (eglGetPlatformDisplay != nullptr && hasToken(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+            display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+        }
+        if (display == nullptr) {
+            display = eglGetDisplay(nullptr);
+        }
+        EGLint major = 0, minor = 0;
+        if (display == nullptr || !eglInitialize(display, &major, &minor)) {
+            fprintf(stderr, "WARNING: No EGL display.\n");
+            display = nullptr;
+            return false;
+        }
+
+        const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (!hasToken(extensions, "EGL_KHR_surfaceless_context") || !eglBindAPI(EGL_OPENGL_API)) {
+            fprintf(stderr, "WARNING: EGL %d.%d cannot make desktop GL current without a surface.\n", major, minor);
+            return false;
+        }
+
+        // With EGL_KHR_no_config_context the config may be null.
+        const EGLint configAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLConfig config = nullptr;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            config = nullptr;
+        }
+
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE,
+        };
+        context = eglCreateContext(display, config, nullptr, contextAttributes);
+        if (context == nullptr || !eglMakeCurrent(display, nullptr, nullptr, context)) {
+            fprintf(stderr, "WARNING: Could not create an OpenGL 3.3 core context with EGL.\n");
+            return false;
+        }
+
+        procAddressLoader = eglGetProcAddress;
+        backend = "EGL";
+        return true;
+    }
+
+    bool HeadlessContext::createOsMesa(int width, int height) {
+        using namespace _internal;
+        const char *const names[] = {"libOSMesa.so.8", "libOSMesa.so.6", "libOSMesa.so", nullptr};
+        library = openLibrary(names);
+        if (library == nullptr) {
+            return false;
+        }
+
+        OsMesaCreateContextAttribsProc createContext = (OsMesaCreateContextAttribsProc) symbol(library, "OSMesaCreateContextAttribs");
+        OsMesaMakeCurrentProc makeCurrent = (OsMesaMakeCurrentProc) symbol(library, "OSMesaMakeCurrent");
+        OsMesaGetProcAddressProc getProcAddress = (OsMesaGetProcAddressProc) symbol(library, "OSMesaGetProcAddress");
+        if (!createContext || !makeCurrent || !getProcAddress) {
+            fprintf(stderr, "WARNING: libOSMesa is too old for core profile contexts.\n");
+            return false;
+        }
+
+        const int attributes[] = {
+            OSMESA_FORMAT, GL_RGBA,
+            OSMESA_DEPTH_BITS, 0,
+            OSMESA_STENCIL_BITS, 0,
+            OSMESA_ACCUM_BITS, 0,
+            OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+            OSMESA_CONTEXT_MAJOR_VERSION, 3,
+            OSMESA_CONTEXT_MINOR_VERSION, 3,
+            0,
+        };
+        context = createContext(attributes, nullptr);
+        osMesaBuffer.resize((size_t) width * height * 4);
+        if (context == nullptr || !makeCurrent(context, osMesaBuffer.data(), GL_UNSIGNED_BYTE, width, height)) {
+            fprintf(stderr, "WARNING: Could not create an OpenGL 3.3 core context with OSMesa.\n");
+            return false;
+        }
+
+        procAddressLoader = getProcAddress;
+        backend = "OSMesa";
+        return true;
+    }
+
+    bool HeadlessContext::create(int width, int height) {
+        destroy();
+        if (!createEgl()) {
+            destroy();
+            if (!createOsMesa(width, height)) {
+                destroy();
+                fprintf(stderr, "ERROR: No headless OpenGL context (tried EGL and OSMesa).\n");
+                return false;
+            }
+        }
+
+        if (!gladLoadGLLoader((GLADloadproc) getProcAddress)) {
+            fprintf(stderr, "ERROR: gladLoadGLLoader() failed on the headless context.\n");
+            destroy();
+            return false;
+        }
+
+        frameWidth = width;
+        frameHeight = height;
+        glGenRenderbuffers(1, &colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            fprintf(stderr, "ERROR: Headless framebuffer is incomplete.\n");
+            destroy();
+            return false;
+        }
+        glViewport(0, 0, width, height);
+        return true;
+    }
+
+    void HeadlessContext::destroy() {
+        using namespace _internal;
+        if (context != nullptr && procAddressLoader != nullptr) {
+            if (fbo != 0) {
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glDeleteFramebuffers(1, &fbo);
+                glDeleteRenderbuffers(1, &colorBuffer);
+                glDeleteRenderbuffers(1, &depthBuffer);
+            }
+        }
+        fbo = colorBuffer = depthBuffer = 0;
+
+        // Also called after a failed create(): the library tells which API
+        // the context belongs to.
+        OsMesaDestroyContextProc osMesaDestroyContext =
+            library != nullptr ? (OsMesaDestroyContextProc) symbol(library, "OSMesaDestroyContext") : nullptr;
+        if (osMesaDestroyContext != nullptr) {
+            if (context != nullptr) {
+                osMesaDestroyContext(context);
+            }
+        } else if (library != nullptr) {
+            EglMakeCurrentProc eglMakeCurrent = (EglMakeCurrentProc) symbol(library, "eglMakeCurrent");
+            EglDestroyContextProc eglDestroyContext = (EglDestroyContextProc) symbol(library, "eglDestroyContext");
+            EglTerminateProc eglTerminate = (EglTerminateProc) symbol(library, "eglTerminate");
+            if (display != nullptr && eglMakeCurrent != nullptr) {
+                eglMakeCurrent(display, nullptr, nullptr, nullptr);
+            }
+            if (context != nullptr && eglDestroyContext != nullptr) {
+                eglDestroyContext(display, context);
+            }
+            if (display != nullptr && eglTerminate != nullptr) {
+                eglTerminate(display);
+            }
+        }
+        closeLibrary(library);
+
+        procAddressLoader = nullptr;
+        backend = nullptr;
+        library = nullptr;
+        display = nullptr;
+        context = nullptr;
+        osMesaBuffer.clear();
+        frameWidth = frameHeight = 0;
+    }
+
+    bool HeadlessContext::writeFrame(const std::string &path) {
+        if (fbo == 0) {
+            return false;
+        }
+        std::vector<unsigned char> pixels((size_t) frameWidth * frameHeight * 3);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, frameWidth, frameHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+        // glReadPixels() starts at the bottom row, PPM at the top one.
+        char header[64];
+        int headerSize = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", frameWidth, frameHeight);
+        std::vector<unsigned char> contents(header, header + headerSize);
+        contents.reserve(headerSize + pixels.size());
+        size_t row = (size_t) frameWidth * 3;
+        for (int y = frameHeight - 1; y >= 0; y--) {
+            contents.insert(contents.end(), pixels.begin() + y * row, pixels.begin() + (y + 1) * row);
+        }
+        return writeFile(path, contents.data(), contents.size());
+    }
+
+    void FrameTimings::beginFrame() {
+        start = std::chrono::steady_clock::now();
+    }
+
+    void FrameTimings::endFrame() {
+        std::chrono::steady_clock::time_point issued = std::chrono::steady_clock::now();
+        glFinish();
+        std::chrono::steady_clock::time_point finished = std::chrono::steady_clock::now();
+        cpu.push_back(std::chrono::duration<double>(issued - start).count() * 1e3);
+        total.push_back(std::chrono::duration<double>(finished - start).count() * 1e3);
+    }
+
+    void FrameTimings::print() const {
+        if (total.empty()) {
+            return;
+        }
+        const std::vector<double> *series[2] = {&cpu, &total};
+        const char *names[2] = {"cpu  ", "total"};
+        printf("%zu frames\n", total.size());
+        for (int s = 0; s < 2; s++) {
+            std::vector<double> sorted = *series[s];
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0.0;
+            for (size_t i = 0; i < sorted.size(); i++) {
+                sum += sorted[i];
+            }
+            printf("%s: mean %.3f ms, median %.3f ms, p99 %.3f ms, max %.3f ms\n", names[s], sum / sorted.size(),
+                   sorted[sorted.size() / 2], sorted[(sorted.size() * 99 + 99) / 100 - 1], sorted.back());
+        }
+    }
+
+    bool FrameTimings::write(const std::string &path) const {
+        std::string contents = "frame,cpu_ms,total_ms\n";
+        for (size_t i = 0; i < total.size(); i++) {
+            char line[64];
+            snprintf(line, sizeof(line), "%zu,%.4f,%.4f\n", i, cpu[i], total[i]);
+            contents += line;
+        }
+        return writeFile(path, contents.data(), contents.size());
+    }
+}
@@ -1,824 +1,1332 @@
-#include <cmath>
-#include <cstdio>
-#include <cstdlib>
-
-// Headers abaixo são específicos de C++
-#include <iostream>
-#include <map>
-#include <ostream>
-#include <stack>
-#include <string>
-#include <limits>
-#include <fstream>
-#include <sstream>
-#include <vector>
-
-// Headers das bibliotecas OpenGL
-#include "glad/glad.h"  // Criação de contexto OpenGL 3.3
-#include "GLFW/glfw3.h" // Criação de janelas do sistema operacional
-
-// Headers da biblioteca GLM: criação de matrizes e vetores.
-#include "glm/mat4x4.hpp"
-#include "glm/vec4.hpp"
-#include "glm/gtc/type_ptr.hpp"
-
-// Headers locais, definidos na pasta "include/"
-#include "renderer.h"
-#include "utils.h"
-#include "matrices.h"
-
-#include "random.h"
-
-#include "collisions.h"
-#include "emitter.h"
-#include "camera.h"
-
-#define print_vec4(v) "(" << v.x << ", " << v.y << ", " << v.z << ", " << v.w << ")"
-#define debug_var(var) std::cout << #var " = " << var << std::endl;
-
-#include "emitter.h"
-Emitter::ParticleEmitter *e1;
-Emitter::ParticleEmitter *e2;
-
-void sphericalFirework(glm::vec4 position, Emitter::ParticleEmitter *stock, Emitter::ParticleEmitter *explosion) {
-#define PI 3.141592
-#define SIDES 7
-#define VSIDES 7
-
-    float height = 10.0f;
-
-    for (int k = 0; k < 10; k++) {
-        float size = (10.0f - k) / 20.0f;
-        stock->emitIn(position.x, position.y, position.z, 0, ((height-position.y) - (stock->proprieties.ya * stock->proprieties.duration)) / stock->proprieties.duration, 0, size, k / 10.0f);
-    }
-
-    float speed = 1.0f;
-    float r = speed;
-    for (float i = 0.0f; i < 2.0f * PI; i += (2.0f * PI) / SIDES) {
-        for (float j = -PI / 2.0f; j < PI * 2.0f; j += PI / VSIDES) {
-            float xs = r * cos(i) * sin(j);
-            float ys = r * sin(i) + 1.0f;
-            float zs = r * cos(i) * cos(j);
-            float x = position.x;
-            float y = position.y+height;
-            float z = position.z;
-
-            for (int k = 0; k < 10; k++) {
-                float size = (10.0f - k) / 20.0f;
-                explosion->emitIn(x, y, z, xs, ys, zs, size, (stock->proprieties.duration-1.9f) + (k / 10.0f));
-            }
-        }
-    }
-}
-
-void spawnParticleAt(glm::vec4 position);
-
-void onClickFloor(int button, int action, int mods, float x, float z) {
-    glm::vec4 point = {x, 0.0f, z, 1.0f};
-    sphericalFirework(point, e2, e1);
-}
-
-void showReticle(GLFWwindow* window);
-
-GLint model_uniform;           // Variável da matriz "model"
-GLint view_uniform;            // Variável da matriz "view" em shader_vertex.glsl
-GLint projection_uniform;      // Variável da matriz "projection" em shader_vertex.glsl
-GLint render_as_black_uniform; // Variável booleana em shader_vertex.glsl
-
-// Declaração de várias funções utilizadas em main().  Essas estão definidas
-// logo após a definição de main() neste arquivo.
-void DrawCube(GLint render_as_black_uniform);                                // Desenha um cubo
-GLuint BuildTriangles();                                                     // Constrói triângulos para renderização
-void LoadShadersFromFiles();                                                 // Carrega os shaders de vértice e fragmento, criando um programa de GPU
-GLuint loadVertexShader(const char *filename);                               // Carrega um vertex shader
-GLuint loadFragmentShader(const char *filename);                             // Carrega um fragment shader
-void LoadShader(const char *filename, GLuint shader_id);                     // Função utilizada pelas duas acima
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Cria um programa de GPU
-
-void TextRendering_Init();
-float TextRendering_LineHeight(GLFWwindow *window);
-float TextRendering_CharWidth(GLFWwindow *window);
-void TextRendering_PrintString(GLFWwindow *window, const std::string &str, float x, float y, float scale = 1.0f);
-
-// Funções abaixo renderizam como texto na janela OpenGL algumas matrizes e
-// outras informações do programa. Definidas após main().
-void TextRendering_ShowModelViewProjection(GLFWwindow *window, glm::mat4 projection, glm::mat4 view, glm::mat4 model, glm::vec4 p_model);
-void TextRendering_ShowProjection(GLFWwindow *window);
-void TextRendering_ShowFramesPerSecond(GLFWwindow *window);
-
-// Funções callback para comunicação com o sistema operacional e interação do
-// usuário. Veja mais comentários nas definições das mesmas, abaixo.
-void FramebufferSizeCallback(GLFWwindow *window, int width, int height);
-void ErrorCallback(int error, const char *description);
-void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mode);
-void MouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
-void CursorPosCallback(GLFWwindow *window, double xpos, double ypos);
-void ScrollCallback(GLFWwindow *window, double xoffset, double yoffset);
-
-// Definimos uma estrutura que armazenará dados necessários para renderizar
-// cada objeto da cena virtual.
-struct SceneObject
-{
-    const char *name;
-    void *first_index;
-    int num_indices;
-    GLenum rendering_mode;
-};
-
-// Abaixo definimos variáveis globais utilizadas em várias funções do código.
-
-// A cena virtual é uma lista de objetos nomeados, guardados em um dicionário
-// (map).  Veja dentro da função BuildTriangles() como que são incluídos
-// objetos dentro da variável g_VirtualScene, e veja na função main() como
-// estes são acessados.
-std::map<const char *, SceneObject> g_VirtualScene;
-
-game::Camera camera;
-
-// Variável que controla se o texto informativo será mostrado na tela.
-bool g_ShowInfoText = true;
-
-// Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
-GLuint g_GpuProgramID = 0;
-
-GLFWwindow *setup()
-{
-    int success = glfwInit();
-    if (!success)
-    {
-        fprintf(stderr, "ERROR: glfwInit() failed.\n");
-        std::exit(EXIT_FAILURE);
-    }
-
-    glfwSetErrorCallback(ErrorCallback);
-
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    GLFWwindow *window;
-    window = glfwCreateWindow(800, 800, "INF01047 - 297033 - Rafael Lacerda Busatta", NULL, NULL);
-    if (!window)
-    {
-        glfwTerminate();
-        fprintf(stderr, "ERROR: glfwCreateWindow() failed.\n");
-        std::exit(EXIT_FAILURE);
-    }
-
-    glfwSetKeyCallback(window, KeyCallback);
-    glfwSetMouseButtonCallback(window, MouseButtonCallback);
-    glfwSetCursorPosCallback(window, CursorPosCallback);
-    glfwSetScrollCallback(window, ScrollCallback);
-    glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
-    glfwSetWindowSize(window, 800, 800);
-
-    glfwMakeContextCurrent(window);
-
-    return window;
-}
-
-void displaySystemInfo()
-{
-    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
-
-    const GLubyte *vendor = glGetString(GL_VENDOR);
-    const GLubyte *renderer = glGetString(GL_RENDERER);
-    const GLubyte *glversion = glGetString(GL_VERSION);
-    const GLubyte *glslversion = glGetString(GL_SHADING_LANGUAGE_VERSION);
-
-    printf("GPU: %s, %s, OpenGL %s, GLSL %s\n", vendor, renderer, glversion, glslversion);
-}
-
-int main() {
-    camera.usePerspectiveProjection = true;
-    camera.phi = 0.0f;
-    camera.theta = 0.0f;
-    camera.distance = 50.0f;
-    camera.field_of_view = 3.141592f / 3.0f;
-    camera.nearPlane = -0.1f;
-    camera.farPlane = -100000.0f;
-
-    GLFWwindow *window = setup();
-    displaySystemInfo();
-    LoadShadersFromFiles();
-
-    GLuint vertex_array_object_id = BuildTriangles();
-
-    TextRendering_Init();
-
-    model_uniform = glGetUniformLocation(g_GpuProgramID, "model");                     // Variável da matriz "model"
-    view_uniform = glGetUniformLocation(g_GpuProgramID, "view");                       // Variável da matriz "view" em shader_vertex.glsl
-    projection_uniform = glGetUniformLocation(g_GpuProgramID, "projection");           // Variável da matriz "projection" em shader_vertex.glsl
-    render_as_black_uniform = glGetUniformLocation(g_GpuProgramID, "render_as_black"); // Variável booleana em shader_vertex.glsl
-
-    // Habilitamos o Z-buffer. Veja slides 104-116 do documento Aula_09_Projecoes.pdf.
-    glEnable(GL_DEPTH_TEST);
-
-    // Habilitamos o Backface Culling. Veja slides 23-34 do documento Aula_13_Clipping_and_Culling.pdf e slides 112-123 do documento Aula_14_Laboratorio_3_Revisao.pdf.
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-
-    float previousTime = glfwGetTime();
-    Random::Init();
-
-    Emitter::ParticleProprieties emitterProprieties;
-    emitterProprieties.xa = 0.0f;
-    emitterProprieties.ya = -1.0f;
-    emitterProprieties.za = 0.0f;
-    emitterProprieties.rotationSpeedX = 0.0f;
-    emitterProprieties.rotationSpeedY = 0.0f;
-    emitterProprieties.rotationSpeedZ = 0.0f;
-    emitterProprieties.initialSize = 1.0f;
-    emitterProprieties.finalSize = 0.0f;
-    emitterProprieties.duration = 4.0f;
-    RenderObject ro((void *)g_VirtualScene["cube_faces"].first_index, g_VirtualScene["cube_faces"].num_indices, g_VirtualScene["cube_faces"].rendering_mode);
-    emitterProprieties.object = ro;
-
-    e1 = new Emitter::ParticleEmitter(10000, emitterProprieties);
-
-    emitterProprieties.finalSize = 0.5f;
-    e2 = new Emitter::ParticleEmitter(10000, emitterProprieties);
-
-    while (!glfwWindowShouldClose(window))
-    {
-        double currentTime = glfwGetTime();
-        float dt = currentTime - previousTime;
-        previousTime = currentTime;
-
-        // Clear screen
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Usar shader
-        glUseProgram(g_GpuProgramID);
-
-        // Usar objeto (cubo)
-        glBindVertexArray(vertex_array_object_id);
-
-        // Criar um Renderer
-        Renderer renderer(g_GpuProgramID);
-
-        camera.onUpdate(dt);
-
-        glm::mat4 view;
-        glm::mat4 projection;
-        camera.computeMatrices(view, projection);
-        glUniformMatrix4fv(view_uniform, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projection_uniform, 1, GL_FALSE, glm::value_ptr(projection));
-
-        e1->onUpdate(dt);
-        e2->onUpdate(dt);
-
-        e1->onRender(renderer);
-        e2->onRender(renderer);
-
-        // Overlay text
-        {
-            glm::mat4 model = Matrix_Identity();
-            glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-            glLineWidth(10.0f);
-            glUniform1i(render_as_black_uniform, false);
-            glDrawElements(
-                    g_VirtualScene["axes"].rendering_mode,
-                    g_VirtualScene["axes"].num_indices,
-                    GL_UNSIGNED_INT,
-                    (void*)g_VirtualScene["axes"].first_index
-            );
-
-            if (!camera.isLookAt) {
-                showReticle(window);
-            }
-          
-            glBindVertexArray(0);
-            TextRendering_ShowProjection(window);
-            TextRendering_ShowFramesPerSecond(window);
-        }
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
-
-    glfwTerminate();
-    return 0;
-}
-
-void DrawCube(GLint render_as_black_uniform)
-{
-    glUniform1i(render_as_black_uniform, false);
-    // Cube
-    {
-        glDrawElements(
-                g_VirtualScene["cube_faces"].rendering_mode, // Veja slides 182-188 do documento Aula_04_Modelagem_Geometrica_3D.pdf
-                g_VirtualScene["cube_faces"].num_indices,    //
-                GL_UNSIGNED_INT,
-                (void *)g_VirtualScene["cube_faces"].first_index);
-    }
-    return;
-    // Axes
-    {
-        glLineWidth(4.0f);
-        glDrawElements(
-                g_VirtualScene["axes"].rendering_mode,
-                g_VirtualScene["axes"].num_indices,
-                GL_UNSIGNED_INT,
-                (void *)g_VirtualScene["axes"].first_index);
-    }
-    // Edges
-    {
-        glUniform1i(render_as_black_uniform, true);
-        glDrawElements(
-                g_VirtualScene["cube_edges"].rendering_mode,
-                g_VirtualScene["cube_edges"].num_indices,
-                GL_UNSIGNED_INT,
-                (void *)g_VirtualScene["cube_edges"].first_index);
-    }
-}
-
-GLuint BuildTriangles()
-{
-    GLfloat model_coefficients[] = {
-        // Vértices de um cubo
-        //    X      Y     Z     W
-        -0.5f, 0.0f, 0.5f, 1.0f,   // posição do vértice 0
-        -0.5f, -1.0f, 0.5f, 1.0f,  // posição do vértice 1
-        0.5f, -1.0f, 0.5f, 1.0f,   // posição do vértice 2
-        0.5f, 0.0f, 0.5f, 1.0f,    // posição do vértice 3
-        -0.5f, 0.0f, -0.5f, 1.0f,  // posição do vértice 4
-        -0.5f, -1.0f, -0.5f, 1.0f, // posição do vértice 5
-        0.5f, -1.0f, -0.5f, 1.0f,  // posição do vértice 6
-        0.5f, 0.0f, -0.5f, 1.0f,   // posição do vértice 7
-                                   // Vértices para desenhar o eixo X
-                                   //    X      Y     Z     W
-        0.0f, 0.0f, 0.0f, 1.0f,    // posição do vértice 8
-        1.0f, 0.0f, 0.0f, 1.0f,    // posição do vértice 9
-                                   // Vértices para desenhar o eixo Y
-                                   //    X      Y     Z     W
-        0.0f, 0.0f, 0.0f, 1.0f,    // posição do vértice 10
-        0.0f, 1.0f, 0.0f, 1.0f,    // posição do vértice 11
-                                   // Vértices para desenhar o eixo Z
-                                   //    X      Y     Z     W
-        0.0f, 0.0f, 0.0f, 1.0f,    // posição do vértice 12
-        0.0f, 0.0f, 1.0f, 1.0f,    // posição do vértice 13
-    };
-    // Setup (just so things get to exist)
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
-    // Transfer data
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(model_coefficients), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(model_coefficients), model_coefficients);
-    // Setup shader stuff
-    GLuint location = 0;            // "(location = 0)" em "shader_vertex.glsl"
-    GLint number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    GLfloat color_coefficients[] = {
-            // Cores dos vértices do cubo
-            //  R     G     B     A
-            1.0f, 0.5f, 0.0f, 1.0f, // cor do vértice 0
-            1.0f, 0.5f, 0.0f, 1.0f, // cor do vértice 1
-            0.0f, 0.5f, 1.0f, 1.0f, // cor do vértice 2
-            0.0f, 0.5f, 1.0f, 1.0f, // cor do vértice 3
-            1.0f, 0.5f, 0.0f, 1.0f, // cor do vértice 4
-            1.0f, 0.5f, 0.0f, 1.0f, // cor do vértice 5
-            0.0f, 0.5f, 1.0f, 1.0f, // cor do vértice 6
-            0.0f, 0.5f, 1.0f, 1.0f, // cor do vértice 7
-            // Cores para desenhar o eixo X
-            1.0f, 0.0f, 0.0f, 1.0f, // cor do vértice 8
-            1.0f, 0.0f, 0.0f, 1.0f, // cor do vértice 9
-            // Cores para desenhar o eixo Y
-            0.0f, 1.0f, 0.0f, 1.0f, // cor do vértice 10
-            0.0f, 1.0f, 0.0f, 1.0f, // cor do vértice 11
-            // Cores para desenhar o eixo Z
-            0.0f, 0.0f, 1.0f, 1.0f, // cor do vértice 12
-            0.0f, 0.0f, 1.0f, 1.0f, // cor do vértice 13
-    };
-    GLuint VBO_color_coefficients_id;
-    glGenBuffers(1, &VBO_color_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_color_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(color_coefficients), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(color_coefficients), color_coefficients);
-    location = 1;             // "(location = 1)" em "shader_vertex.glsl"
-    number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    GLuint indices[] = {
-        // Definimos os índices dos vértices que definem as FACES de um cubo
-        // através de 12 triângulos que serão desenhados com o modo de renderização
-        // GL_TRIANGLES.
-        0, 1, 2, // triângulo 1
-        7, 6, 5, // triângulo 2
-        3, 2, 6, // triângulo 3
-        4, 0, 3, // triângulo 4
-        4, 5, 1, // triângulo 5
-        1, 5, 6, // triângulo 6
-        0, 2, 3, // triângulo 7
-        7, 5, 4, // triângulo 8
-        3, 6, 7, // triângulo 9
-        4, 3, 7, // triângulo 10
-        4, 1, 0, // triângulo 11
-        1, 6, 2, // triângulo 12
-                 // Definimos os índices dos vértices que definem as ARESTAS de um cubo
-                 // através de 12 linhas que serão desenhadas com o modo de renderização
-                 // GL_LINES.
-        0, 1,    // linha 1
-        1, 2,    // linha 2
-        2, 3,    // linha 3
-        3, 0,    // linha 4
-        0, 4,    // linha 5
-        4, 7,    // linha 6
-        7, 6,    // linha 7
-        6, 2,    // linha 8
-        6, 5,    // linha 9
-        5, 4,    // linha 10
-        5, 1,    // linha 11
-        7, 3,    // linha 12
-                 // Definimos os índices dos vértices que definem as linhas dos eixos X, Y,
-                 // Z, que serão desenhados com o modo GL_LINES.
-        8, 9,    // linha 1
-        10, 11,  // linha 2
-        12, 13   // linha 3
-    };
-    SceneObject cube_faces;
-    cube_faces.name = "Cubo (faces coloridas)";
-    cube_faces.first_index = (void *)0;       // Primeiro índice está em indices[0]
-    cube_faces.num_indices = 36;              // Último índice está em indices[35]; total de 36 índices.
-    cube_faces.rendering_mode = GL_TRIANGLES; // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
-    g_VirtualScene["cube_faces"] = cube_faces;
-    SceneObject cube_edges;
-    cube_edges.name = "Cubo (arestas pretas)";
-    cube_edges.first_index = (void *)(36 * sizeof(GLuint)); // Primeiro índice está em indices[36]
-    cube_edges.num_indices = 24;                            // Último índice está em indices[59]; total de 24 índices.
-    cube_edges.rendering_mode = GL_LINES;                   // Índices correspondem ao tipo de rasterização GL_LINES.
-    // Adicionamos o objeto criado acima na nossa cena virtual (g_VirtualScene).
-    g_VirtualScene["cube_edges"] = cube_edges;
-    // Criamos um terceiro objeto virtual (SceneObject) que se refere aos eixos XYZ.
-    SceneObject axes;
-    axes.name = "Eixos XYZ";
-    axes.first_index = (void *)(60 * sizeof(GLuint)); // Primeiro índice está em indices[60]
-    axes.num_indices = 6;                             // Último índice está em indices[65]; total de 6 índices.
-    axes.rendering_mode = GL_LINES;                   // Índices correspondem ao tipo de rasterização GL_LINES.
-    g_VirtualScene["axes"] = axes;
-    // Criamos um buffer OpenGL para armazenar os índices acima
-    GLuint indices_id;
-    glGenBuffers(1, &indices_id);
-    // "Ligamos" o buffer. Note que o tipo agora é GL_ELEMENT_ARRAY_BUFFER.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    // Alocamos memória para o buffer.
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), NULL, GL_STATIC_DRAW);
-    // Copiamos os valores do array indices[] para dentro do buffer.
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(indices), indices);
-    // NÃO faça a chamada abaixo! Diferente de um VBO (GL_ARRAY_BUFFER), um
-    // array de índices (GL_ELEMENT_ARRAY_BUFFER) não pode ser "desligado",
-    // caso contrário o VAO irá perder a informação sobre os índices.
-    //
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // XXX Errado!
-    //
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
-    // Retornamos o ID do VAO. Isso é tudo que será necessário para renderizar
-    // os triângulos definidos acima. Veja a chamada glDrawElements() em main().
-    return vertex_array_object_id;
-}
-
-GLuint loadVertexShader(const char *filename)
-{
-    GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-    LoadShader(filename, vertex_shader_id);
-    return vertex_shader_id;
-}
-
-GLuint loadFragmentShader(const char *filename)
-{
-    GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    LoadShader(filename, fragment_shader_id);
-    return fragment_shader_id;
-}
-
-void LoadShader(const char *filename, GLuint shader_id)
-{
-    // Le o arquivo do shader
-    std::ifstream file;
-    try
-    {
-        file.exceptions(std::ifstream::failbit);
-        file.open(filename);
-    }
-    catch (std::exception &e)
-    {
-        fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
-    }
-    std::stringstream shader;
-    shader << file.rdbuf();
-    std::string str = shader.str();
-    const GLchar *shader_string = str.c_str();
-    const GLint shader_string_length = static_cast<GLint>(str.length());
-    // Compila o shader
-    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
-    glCompileShader(shader_id);
-    // Verifica se compilou
-    GLint compiled_ok;
-    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
-    GLint log_length = 0;
-    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
-    GLchar *log = new GLchar[log_length];
-    glGetShaderInfoLog(shader_id, log_length, &log_length, log);
-    if (log_length != 0)
-    {
-        std::string output;
-        // Loca o erro
-        if (!compiled_ok)
-        {
-            output += "ERROR: OpenGL compilation of \"";
-            output += filename;
-            output += "\" failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-        else
-        {
-            output += "WARNING: OpenGL compilation of \"";
-            output += filename;
-            output += "\".\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-        fprintf(stderr, "%s", output.c_str());
-    }
-    delete[] log;
-}
-
-void LoadShadersFromFiles()
-{
-    GLuint vertex_shader_id = loadVertexShader("../assets/shader_vertex.glsl");
-    GLuint fragment_shader_id = loadFragmentShader("../assets/shader_fragment.glsl");
-    if (g_GpuProgramID != 0)
-        glDeleteProgram(g_GpuProgramID);
-    g_GpuProgramID = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
-}
-
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
-{
-    // Create program
-    GLuint program_id = glCreateProgram();
-    // Link shaders
-    glAttachShader(program_id, vertex_shader_id);
-    glAttachShader(program_id, fragment_shader_id);
-    glLinkProgram(program_id);
-    // Check ok
-    GLint linked_ok = GL_FALSE;
-    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
-    if (linked_ok == GL_FALSE)
-    {
-        // Log error
-        GLint log_length = 0;
-        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &log_length);
-        GLchar *log = new GLchar[log_length];
-        glGetProgramInfoLog(program_id, log_length, &log_length, log);
-        std::string output;
-        output += "ERROR: OpenGL linking of program failed.\n";
-        output += "== Start of link log\n";
-        output += log;
-        output += "\n== End of link log\n";
-        delete[] log;
-        fprintf(stderr, "%s", output.c_str());
-    }
-    return program_id;
-}
-
-void FramebufferSizeCallback(GLFWwindow *window, int width, int height)
-{
-    glViewport(0, 0, width, height);
-    camera.screenRatio = ((float)width) / ((float)height);
-    camera.width = (float)width;
-    camera.height = (float)height;
-}
-
-bool g_LeftMouseButtonPressed = false;
-bool g_RightMouseButtonPressed = false;
-bool g_MiddleMouseButtonPressed = false;
-double g_LastCursorPosX, g_LastCursorPosY;
-
-void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
-    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
-        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
-        g_LeftMouseButtonPressed = true;
-
-    } else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE) {
-        g_LeftMouseButtonPressed = false;
-    }
-    else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
-    {
-        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
-        g_RightMouseButtonPressed = true;
-
-        // Intersect view with floor
-        collision::Plane floor = {{0, 0 ,0}, {0, 1, 0}};
-        collision::Ray ray = {
-                {camera.position.x, camera.position.y, camera.position.z},
-                {camera.viewVector.x, camera.viewVector.y, camera.viewVector.z}
-        };
-        float time = collision::collide(floor, ray);
-        collision::Point p = ray.at(time);
-        onClickFloor(button, action, mods, p.x, p.z);
-    } else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE) {
-        g_RightMouseButtonPressed = false;
-    }
-    else if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_PRESS)
-    {
-        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
-        g_MiddleMouseButtonPressed = true;
-    }
-    else if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_RELEASE)
-    {
-        g_MiddleMouseButtonPressed = false;
-    }
-}
-
-void CursorPosCallback(GLFWwindow *window, double xpos, double ypos)
-{
-    float dx = xpos - g_LastCursorPosX;
-    float dy = ypos - g_LastCursorPosY;
-    if (g_LeftMouseButtonPressed)
-    {
-        // Atualizamos parâmetros da câmera com os deslocamentos
-        camera.theta -= 0.002f*dx;
-        camera.phi   += 0.002f*dy;
-        // Em coordenadas esféricas, o ângulo phi deve ficar entre -pi/2 e +pi/2.
-        float phimax = 3.141592f / 2;
-        float phimin = -phimax;
-        if (camera.phi > phimax)
-            camera.phi = phimax;
-        if (camera.phi < phimin)
-            camera.phi = phimin;
-        // Atualizamos as variáveis globais para armazenar a posição atual do
-        // cursor como sendo a última posição conhecida do cursor.
-        g_LastCursorPosX = xpos;
-        g_LastCursorPosY = ypos;
-    }
-    if (g_RightMouseButtonPressed)
-    {
-        // Deslocamento do cursor do mouse em x e y de coordenadas de tela!
-    }
-    if (g_MiddleMouseButtonPressed)
-    {
-    }
-}
-
-void ScrollCallback(GLFWwindow *window, double xoffset, double yoffset)
-{
-    camera.distance -= 1.0f * yoffset;
-    const float verySmallNumber = std::numeric_limits<float>::epsilon();
-    if (camera.distance < verySmallNumber)
-    {
-        camera.distance = verySmallNumber;
-    }
-}
-
-RenderObject renderObjectOf(const char *object_id) {
-    return {
-            (void*)g_VirtualScene[object_id].first_index,
-            g_VirtualScene[object_id].num_indices,
-            g_VirtualScene[object_id].rendering_mode
-    };
-}
-
-
-void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mod)
-{
-    for (int i = 0; i < 10; ++i)
-        if (key == GLFW_KEY_0 + i && action == GLFW_PRESS && mod == GLFW_MOD_SHIFT)
-            std::exit(100 + i);
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, GL_TRUE);
-    } else if (key == GLFW_KEY_P && action == GLFW_PRESS) {
-        camera.usePerspectiveProjection = true;
-    }
-    else if (key == GLFW_KEY_O && action == GLFW_PRESS)
-    {
-        camera.usePerspectiveProjection = false;
-    }
-    else if (key == GLFW_KEY_H && action == GLFW_PRESS)
-    {
-        g_ShowInfoText = !g_ShowInfoText;
-    } else if (key == GLFW_KEY_F && action == GLFW_PRESS) {
-        sphericalFirework(glm::vec4(0, 0, 0, 1), e2, e1);
-    } else if (key == GLFW_KEY_A && action == GLFW_PRESS) {
-        camera.movement.decX = true;
-    } else if (key == GLFW_KEY_A && action == GLFW_RELEASE) {
-        camera.movement.decX = false;
-    } else if (key == GLFW_KEY_D && action == GLFW_PRESS) {
-        camera.movement.incX = true;
-    } else if (key == GLFW_KEY_D && action == GLFW_RELEASE) {
-        camera.movement.incX = false;
-    } else if (key == GLFW_KEY_S && action == GLFW_PRESS) {
-        camera.movement.decY = true;
-    } else if (key == GLFW_KEY_S && action == GLFW_RELEASE) {
-        camera.movement.decY = false;
-    } else if (key == GLFW_KEY_W && action == GLFW_PRESS) {
-        camera.movement.incY = true;
-    } else if (key == GLFW_KEY_W && action == GLFW_RELEASE) {
-        camera.movement.incY = false;
-    } else if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
-        camera.movement.incZ = true;
-    } else if (key == GLFW_KEY_SPACE && action == GLFW_RELEASE) {
-        camera.movement.incZ = false;
-    } else if (key == GLFW_KEY_LEFT_SHIFT && action == GLFW_PRESS) {
-        camera.movement.decZ = true;
-    } else if (key == GLFW_KEY_LEFT_SHIFT && action == GLFW_RELEASE) {
-        camera.movement.decZ = false;
-    } else if (key == GLFW_KEY_Q && action == GLFW_PRESS) {
-        camera.isLookAt ^= true;
-    } else if (key == GLFW_KEY_B && action == GLFW_PRESS) {
-        camera.bezierTime = 0.0f;
-        camera.bezierDuration = 4.0f;
-        camera.bezierCurve.p0 = glm::vec4(10.0f, 50.0f, 10.0f, 1.0f);
-        camera.bezierCurve.p1 = glm::vec4(0.0f, 0.0f, 20.0f, 1.0f);
-        camera.bezierCurve.p2 = glm::vec4(00.0f, -20.0f, -30.0f, 1.0f);
-        camera.bezierCurve.p3 = glm::vec4(-50.0f, 10.0f, -0.0f, 1.0f);
-    }
-}
-
-void ErrorCallback(int error, const char *description)
-{
-    fprintf(stderr, "ERROR: GLFW: %s\n", description);
-}
-
-// Escrevemos na tela qual matriz de projeção está sendo utilizada.
-void TextRendering_ShowProjection(GLFWwindow *window)
-{
-    if (!g_ShowInfoText)
-        return;
-
-    float lineheight = TextRendering_LineHeight(window);
-    float charwidth = TextRendering_CharWidth(window);
-
-    if (camera.usePerspectiveProjection)
-        TextRendering_PrintString(window, "Perspective", 1.0f - 13 * charwidth, -1.0f + 2 * lineheight / 10, 1.0f);
-    else
-        TextRendering_PrintString(window, "Orthographic", 1.0f - 13 * charwidth, -1.0f + 2 * lineheight / 10, 1.0f);
-}
-
-// Escrevemos na tela o número de quadros renderizados por segundo (frames per
-// second).
-void showReticle(GLFWwindow* window)
-{
-    static char  buffer[] = "+";
-
-    float lineheight = TextRendering_LineHeight(window);
-    float charwidth = TextRendering_CharWidth(window);
-
-    TextRendering_PrintString(window, buffer, -0.5f*charwidth, -0.5*lineheight, 1.0f);
-}
-
-void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
-{
-    if (!g_ShowInfoText)
-        return;
-
-    // Variáveis estáticas (static) mantém seus valores entre chamadas
-    // subsequentes da função!
-    static float old_seconds = (float)glfwGetTime();
-    static int ellapsed_frames = 0;
-    static char buffer[20] = "?? fps";
-    static int numchars = 7;
-
-    ellapsed_frames += 1;
-
-    // Recuperamos o número de segundos que passou desde a execução do programa
-    float seconds = (float)glfwGetTime();
-
-    // Número de segundos desde o último cálculo do fps
-    float ellapsed_seconds = seconds - old_seconds;
-
-    if (ellapsed_seconds > 1.0f)
-    {
-        numchars = snprintf(buffer, 20, "%.2f fps", ellapsed_frames / ellapsed_seconds);
-
-        old_seconds = seconds;
-        ellapsed_frames = 0;
-    }
-
-    float lineheight = TextRendering_LineHeight(window);
-    float charwidth = TextRendering_CharWidth(window);
-
-    TextRendering_PrintString(window, buffer, 1.0f - (numchars + 1) * charwidth, 1.0f - lineheight, 1.0f);
-}
-
-// set makeprg=cd\ ..\ &&\ make\ run\ >/dev/null
-// vim: set spell spelllang=pt_br :
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Headers abaixo são específicos de C++
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <ostream>
+#include <stack>
+#include <string>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// Headers das bibliotecas OpenGL
+#include "glad/glad.h"  // Criação de contexto OpenGL 3.3
+#include "GLFW/glfw3.h" // Criação de janelas do sistema operacional
+
+// Headers da biblioteca GLM: criação de matrizes e vetores.
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+// Headers locais, definidos na pasta "include/"
+#include "renderer.h"
+#include "utils.h"
+#include "matrices.h"
+#include "glext.h"
+#include "programcache.h"
+#include "streambuffer.h"
+#include "glstate.h"
+#include "renderqueue.h"
+#include "objloader.h"
+#include "meshcache.h"
+#include "meshlod.h"
+#include "meshstreamer.h"
+#include "geometryarena.h"
+#include "sceneregistry.h"
+#include "bvh.h"
+#include "raytriangle.h"
+#include "sweepandprune.h"
+#include "aabbtree.h"
+#include "distancefield.h"
+#include "frustum.h"
+#include "occlusion.h"
+#include "softrenderer.h"
+#include "headless.h"
+#include "platform.h"
+#include "parallel.h"
+#include "hash.h"
+
+#include "random.h"
+
+#include "collisions.h"
+#include "emitter.h"
+#include "camera.h"
+
+#define print_vec4(v) "(" << v.x << ", " << v.y << ", " << v.z << ", " << v.w << ")"
+#define debug_var(var) std::cout << #var " = " << var << std::endl;
+
+#include "emitter.h"
+Emitter::ParticleEmitter *e1;
+Emitter::ParticleEmitter *e2;
+
+void sphericalFirework(glm::vec4 position, Emitter::ParticleEmitter *stock, Emitter::ParticleEmitter *explosion) {
+#define PI 3.141592
+#define SIDES 7
+#define VSIDES 7
+
+    float height = 10.0f;
+
+    for (int k = 0; k < 10; k++) {
+        float size = (10.0f - k) / 20.0f;
+        stock->emitIn(position.x, position.y, position.z, 0, ((height-position.y) - (stock->proprieties.ya * stock->proprieties.duration)) / stock->proprieties.duration, 0, size, k / 10.0f);
+    }
+
+    float speed = 1.0f;
+    float r = speed;
+    for (float i = 0.0f; i < 2.0f * PI; i += (2.0f * PI) / SIDES) {
+        for (float j = -PI / 2.0f; j < PI * 2.0f; j += PI / VSIDES) {
+            float xs = r * cos(i) * sin(j);
+            float ys = r * sin(i) + 1.0f;
+            float zs = r * cos(i) * cos(j);
+            float x = position.x;
+            float y = position.y+height;
+            float z = position.z;
+
+            for (int k = 0; k < 10; k++) {
+                float size = (10.0f - k) / 20.0f;
+                explosion->emitIn(x, y, z, xs, ys, zs, size, (stock->proprieties.duration-1.9f) + (k / 10.0f));
+            }
+        }
+    }
+}
+
+void spawnParticleAt(glm::vec4 position);
+
+void onClickFloor(int button, int action, int mods, float x, float z) {
+    glm::vec4 point = {x, 0.0f, z, 1.0f};
+    sphericalFirework(point, e2, e1);
+}
+
+void showReticle(GLFWwindow* window);
+
+GLint model_uniform;           // Variável da matriz "model"
+GLint view_uniform;            // Variável da matriz "view" em shader_vertex.glsl
+GLint projection_uniform;      // Variável da matriz "projection" em shader_vertex.glsl
+GLint render_as_black_uniform; // Variável booleana em shader_vertex.glsl
+
+// Declaração de várias funções utilizadas em main().  Essas estão definidas
+// logo após a definição de main() neste arquivo.
+void DrawCube(GLint render_as_black_uniform);                                // Desenha um cubo
+RenderObject renderObjectOf(game::SceneHandle handle);                       // Faixa de índices de um objeto da cena
+GLuint BuildTriangles();                                                     // Constrói triângulos para renderização
+void AddCubeAxesObjects(uintptr_t first, GLint base_vertex);                 // Registra cubo e eixos em g_VirtualScene, com índices a partir do byte "first"
+game::PendingProgram LoadShadersFromFiles();                                 // Carrega os shaders de vértice e fragmento, criando um programa de GPU
+std::string ReadShaderSource(const char *filename);                          // Lê o código fonte de um shader
+
+void TextRendering_Init();
+bool TextRendering_ProgramReady(); // Recolhe o programa de texto quando o driver terminar de compilá-lo
+float TextRendering_LineHeight(GLFWwindow *window);
+float TextRendering_CharWidth(GLFWwindow *window);
+void TextRendering_PrintString(GLFWwindow *window, const std::string &str, float x, float y, float scale = 1.0f);
+
+// Funções abaixo renderizam como texto na janela OpenGL algumas matrizes e
+// outras informações do programa. Definidas após main().
+void TextRendering_ShowModelViewProjection(GLFWwindow *window, glm::mat4 projection, glm::mat4 view, glm::mat4 model, glm::vec4 p_model);
+void TextRendering_ShowProjection(GLFWwindow *window);
+void TextRendering_ShowFramesPerSecond(GLFWwindow *window);
+void TextRendering_ShowStateCalls(GLFWwindow *window);
+void TextRendering_ShowCulling(GLFWwindow *window);
+
+// Funções callback para comunicação com o sistema operacional e interação do
+// usuário. Veja mais comentários nas definições das mesmas, abaixo.
+void FramebufferSizeCallback(GLFWwindow *window, int width, int height);
+void ErrorCallback(int error, const char *description);
+void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mode);
+void MouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
+void CursorPosCallback(GLFWwindow *window, double xpos, double ypos);
+void ScrollCallback(GLFWwindow *window, double xoffset, double yoffset);
+
+// Abaixo definimos variáveis globais utilizadas em várias funções do código.
+
+// A cena virtual é uma lista de objetos nomeados, guardados de forma contígua
+// em um game::SceneRegistry. Veja dentro da função BuildTriangles() como que
+// são incluídos objetos dentro da variável g_VirtualScene. Os nomes são
+// resolvidos uma única vez, ao carregar; o laço de renderização usa apenas
+// os handles abaixo.
+game::SceneRegistry g_VirtualScene;
+game::SceneHandle g_CubeFacesObject;
+game::SceneHandle g_CubeEdgesObject;
+game::SceneHandle g_AxesObject;
+
+game::Camera camera;
+
+// Variável que controla se o texto informativo será mostrado na tela.
+bool g_ShowInfoText = true;
+
+// Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
+GLuint g_GpuProgramID = 0;
+
+// Cache em disco dos programas de GPU já compilados. Veja LoadShadersFromFiles().
+game::ProgramCache g_ProgramCache;
+
+// Buffer circular para dados reescritos a cada quadro (texto, partículas, ...).
+game::StreamBuffer g_StreamBuffer;
+
+// Fila de desenho do quadro: todos os sistemas enviam seus desenhos para ela,
+// que os ordena e executa em um único lugar.
+game::RenderQueue g_RenderQueue;
+
+// Modelos estáticos carregados de "data/" (via cache binário em "cache/meshes")
+// em segundo plano: cada um aparece na cena quando seu upload termina.
+struct MeshInstance
+{
+    const char *source;
+    int ticket;        // Pedido em g_MeshStreamer
+    double requested;  // Instante do pedido, para medir o tempo de carga
+    glm::mat4 model;
+    glm::mat4 decode;  // Decodifica as posições quantizadas (ver mesh::GpuMesh)
+    mesh::GpuMesh gpu;
+    float scale;  // Maior escala de "model", para projetar o erro dos LODs
+    int lod;      // Nível de detalhe escolhido no quadro anterior
+    std::shared_ptr<collision::TriangleBvh> bvh;  // Triângulos do LOD 0, para seleção com o mouse
+    std::shared_ptr<collision::OccluderMesh> occluder;  // Maiores triângulos do LOD 0, para o teste de oclusão
+    collision::Cube bounds;  // Caixa em espaço do mundo
+};
+std::vector<MeshInstance> g_SceneMeshes;
+mesh::MeshStreamer g_MeshStreamer;
+
+// BVH dos modelos carregados (ids são índices de g_SceneMeshes), refeita
+// sempre que um modelo termina de carregar; cada reconstrução incrementa
+// g_SceneVersion.
+collision::SceneBvh g_SceneBvh;
+unsigned long g_SceneVersion = 0;
+
+// Recorte pelo frustum da câmera sobre a hierarquia de g_SceneBvh e teste de
+// oclusão: só os modelos em g_VisibleMeshes (índices de g_SceneMeshes) vão
+// para a fila.
+collision::FrustumCuller g_FrustumCuller;
+std::vector<uint32_t> g_VisibleMeshes;
+// Versões da câmera e da cena usadas pelo último recorte: com a câmera
+// parada, o recorte não é refeito.
+unsigned long g_CulledCameraVersion = 0;
+unsigned long g_CulledSceneVersion = 0;
+
+// Teste de oclusão na CPU: os modelos dentro do frustum desenham suas versões
+// simplificadas neste buffer e só vão para a fila os que não ficam atrás delas.
+collision::OcclusionBuffer g_OcclusionBuffer;
+
+// Toda a geometria estática (cubo, eixos e modelos) compartilha os buffers
+// desta arena: um VAO por formato de vértice.
+mesh::GeometryArena g_GeometryArena;
+void LoadSceneMeshes(GLFWwindow *window);
+void UpdateSceneMeshes();
+MeshInstance PlaceSceneMesh(size_t index);  // Modelo de g_MeshPlacements[index], ainda sem geometria
+void AttachSceneMesh(MeshInstance &instance, const mesh::GpuMesh &gpu, const std::shared_ptr<collision::TriangleBvh> &bvh,
+                     const std::shared_ptr<collision::OccluderMesh> &occluder);
+void RebuildSceneBvh();  // Refaz g_SceneBvh e as caixas dos modelos
+
+// Um desenho da cena e a posição usada para ordená-lo na fila
+struct ScenePacket
+{
+    game::DrawPacket packet;
+    glm::vec4 position;
+};
+
+// Recorta a cena pela câmera (se ela ou a cena mudaram) e monta os desenhos
+// dos modelos visíveis, no nível de detalhe escolhido, e dos eixos a partir
+// de "scene_packet". A janela, o modo sem janela e o renderizador de
+// software desenham exatamente estes pacotes.
+void BuildScenePackets(const game::DrawPacket &scene_packet, std::vector<ScenePacket> &packets);
+
+// Desenha a cena inicial (os pacotes de BuildScenePackets(): modelos do
+// cache, recortados e no nível de detalhe escolhido, e eixos) com o
+// renderizador de software, sem GPU, e grava a imagem em "output". Com "golden", compara o
+// resultado com essa imagem. Retorna o código de saída do programa.
+int RenderSoftware(const char *output, const char *golden);
+
+GLFWwindow *setup()
+{
+    int success = glfwInit();
+    if (!success)
+    {
+        fprintf(stderr, "ERROR: glfwInit() failed.\n");
+        std::exit(EXIT_FAILURE);
+    }
+
+    glfwSetErrorCallback(ErrorCallback);
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow *window;
+    window = glfwCreateWindow(800, 800, "INF01047 - 297033 - Rafael Lacerda Busatta", NULL, NULL);
+    if (!window)
+    {
+        glfwTerminate();
+        fprintf(stderr, "ERROR: glfwCreateWindow() failed.\n");
+        std::exit(EXIT_FAILURE);
+    }
+
+    glfwSetKeyCallback(window, KeyCallback);
+    glfwSetMouseButtonCallback(window, MouseButtonCallback);
+    glfwSetCursorPosCallback(window, CursorPosCallback);
+    glfwSetScrollCallback(window, ScrollCallback);
+    glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
+    glfwSetWindowSize(window, 800, 800);
+
+    glfwMakeContextCurrent(window);
+
+    return window;
+}
+
+void displaySystemInfo(GLADloadproc loader)
+{
+    gladLoadGLLoader(loader);
+    glext::load(loader);
+
+    const GLubyte *vendor = glGetString(GL_VENDOR);
+    const GLubyte *renderer = glGetString(GL_RENDERER);
+    const GLubyte *glversion = glGetString(GL_VERSION);
+    const GLubyte *glslversion = glGetString(GL_SHADING_LANGUAGE_VERSION);
+
+    printf("GPU: %s, %s, OpenGL %s, GLSL %s\n", vendor, renderer, glversion, glslversion);
+}
+
+int main(int argc, char *argv[]) {
+    // Modos de linha de comando que não abrem janela
+    const char *soft_render_output = NULL;
+    const char *soft_render_golden = NULL;
+    // Modo sem janela: "--headless <quadros> [diretório]" desenha a cena com
+    // a câmera em órbita em um contexto OpenGL sem tela e mede cada quadro.
+    // Com um diretório, grava nele os quadros e os tempos.
+    int headless_frames = 0;
+    const char *headless_output = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc)
+        {
+            headless_frames = std::max(atoi(argv[++i]), 1);
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                headless_output = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--soft-render") == 0 && i + 1 < argc)
+        {
+            soft_render_output = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                soft_render_golden = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--bench-obj") == 0)
+        {
+            mesh::benchmarkObjLoaders("../data");
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench-raytri") == 0)
+        {
+            collision::benchmarkRayTriangle("../data/bunny.obj");
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench-broadphase") == 0)
+        {
+            collision::benchmarkBroadphase();
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench-aabbtree") == 0)
+        {
+            collision::benchmarkAabbTree();
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench-culling") == 0)
+        {
+            collision::benchmarkFrustumCulling();
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench-occlusion") == 0)
+        {
+            collision::benchmarkOcclusion();
+            return 0;
+        }
+        if (strcmp(argv[i], "--bench-sdf") == 0)
+        {
+            collision::benchmarkDistanceField("../data/bunny.obj", 64);
+            return 0;
+        }
+        if (strcmp(argv[i], "--bake-sdf") == 0)
+        {
+            collision::DistanceField field;
+            collision::loadOrBakeDistanceField("../data/tower.obj", "../cache/meshes", 64, field);
+            collision::loadOrBakeDistanceField("../data/bunny.obj", "../cache/meshes", 64, field);
+            return 0;
+        }
+        if (strcmp(argv[i], "--cook-meshes") == 0)
+        {
+            mesh::cookDirectory("../data", "../cache/meshes");
+            return 0;
+        }
+    }
+
+    camera.usePerspectiveProjection = true;
+    camera.phi = 0.0f;
+    camera.theta = 0.0f;
+    camera.distance = 50.0f;
+    camera.field_of_view = 3.141592f / 3.0f;
+    camera.nearPlane = -0.1f;
+    camera.farPlane = -100000.0f;
+
+    if (soft_render_output)
+        return RenderSoftware(soft_render_output, soft_render_golden);
+
+    // Sem janela, "window" é NULL: o contexto é o de "headless" e a imagem
+    // vai para um framebuffer object.
+    GLFWwindow *window = NULL;
+    platform::HeadlessContext headless;
+    if (headless_frames > 0)
+    {
+        if (!headless.create(800, 800))
+            return EXIT_FAILURE;
+        printf("Headless context: %s\n", headless.api());
+        displaySystemInfo((GLADloadproc)platform::HeadlessContext::getProcAddress);
+    }
+    else
+    {
+        window = setup();
+        displaySystemInfo((GLADloadproc)glfwGetProcAddress);
+    }
+    g_ProgramCache.init("../cache/programs");
+
+    // Os shaders são compilados pelo driver enquanto os buffers e a fonte são
+    // enviados para a GPU; o programa só é aguardado quando for necessário.
+    game::PendingProgram gpu_program = LoadShadersFromFiles();
+
+    g_GeometryArena.init();
+    GLuint vertex_array_object_id = BuildTriangles();
+    LoadSceneMeshes(window);
+
+    // Texto e as matrizes das partículas (até 2 x 10000 por quadro)
+    g_StreamBuffer.init(4 * 1024 * 1024);
+    TextRendering_Init();
+
+    g_GpuProgramID = g_ProgramCache.finish(gpu_program);
+    g_ProgramCache.printStatistics();
+
+    model_uniform = glGetUniformLocation(g_GpuProgramID, "model");                     // Variável da matriz "model"
+    view_uniform = glGetUniformLocation(g_GpuProgramID, "view");                       // Variável da matriz "view" em shader_vertex.glsl
+    projection_uniform = glGetUniformLocation(g_GpuProgramID, "projection");           // Variável da matriz "projection" em shader_vertex.glsl
+    render_as_black_uniform = glGetUniformLocation(g_GpuProgramID, "render_as_black"); // Variável booleana em shader_vertex.glsl
+
+    // Fora dos desenhos instanciados, "instance_model" não vem de um buffer
+    // e usa este valor constante: a identidade, uma coluna por atributo.
+    for (GLuint column = 0; column < 4; ++column)
+        glVertexAttrib4f(mesh::LOCATION_INSTANCE_MODEL + column, column == 0, column == 1, column == 2, column == 3);
+
+    // Habilitamos o Z-buffer. Veja slides 104-116 do documento Aula_09_Projecoes.pdf.
+    game::glState.setDepthTest(true);
+
+    // Habilitamos o Backface Culling. Veja slides 23-34 do documento Aula_13_Clipping_and_Culling.pdf e slides 112-123 do documento Aula_14_Laboratorio_3_Revisao.pdf.
+    game::glState.setCullFace(true);
+    game::glState.polygonMode(GL_FILL);
+    glCullFace(GL_BACK);
+    glFrontFace(GL_CCW);
+
+    float previousTime = glfwGetTime();
+    Random::Init();
+
+    // Versão da câmera usada pelo último envio das matrizes: com a câmera
+    // parada, as matrizes não são reenviadas.
+    unsigned long uploaded_camera_version = 0;
+    std::vector<ScenePacket> scene_packets;
+
+    Emitter::ParticleProprieties emitterProprieties;
+    emitterProprieties.xa = 0.0f;
+    emitterProprieties.ya = -1.0f;
+    emitterProprieties.za = 0.0f;
+    emitterProprieties.rotationSpeedX = 0.0f;
+    emitterProprieties.rotationSpeedY = 0.0f;
+    emitterProprieties.rotationSpeedZ = 0.0f;
+    emitterProprieties.initialSize = 1.0f;
+    emitterProprieties.finalSize = 0.0f;
+    emitterProprieties.duration = 4.0f;
+    emitterProprieties.object = renderObjectOf(g_CubeFacesObject);
+
+    e1 = new Emitter::ParticleEmitter(10000, emitterProprieties);
+
+    emitterProprieties.finalSize = 0.5f;
+    e2 = new Emitter::ParticleEmitter(10000, emitterProprieties);
+
+    // Sem janela, os quadros medidos começam com todos os modelos na GPU.
+    platform::FrameTimings headless_timings;
+    if (!window)
+    {
+        while (g_MeshStreamer.pending() > 0)
+        {
+            UpdateSceneMeshes();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (headless_output)
+            platform::makeDirectory(headless_output);
+    }
+
+    for (int frame = 0; window ? !glfwWindowShouldClose(window) : frame < headless_frames; ++frame)
+    {
+        float dt;
+        if (window)
+        {
+            double currentTime = glfwGetTime();
+            dt = currentTime - previousTime;
+            previousTime = currentTime;
+        }
+        else
+        {
+            // Cena roteirizada: passo fixo de 1/60 s e uma volta completa da
+            // câmera ao redor do ponto observado.
+            dt = 1.0f / 60.0f;
+            camera.theta = 2.0f * 3.141592f * frame / headless_frames;
+            camera.phi = 0.3f;
+            headless_timings.beginFrame();
+        }
+
+        // O programa de texto compila em paralelo com o início da execução;
+        // é recolhido no primeiro quadro em que estiver pronto.
+        TextRendering_ProgramReady();
+
+        // Clear screen (glClear() respeita a máscara de escrita do Z-buffer)
+        game::glState.depthMask(true);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Usar shader
+        game::glState.useProgram(g_GpuProgramID);
+
+        camera.onUpdate(dt);
+
+        glm::mat4 view;
+        glm::mat4 projection;
+        camera.computeMatrices(view, projection);
+        // Uniforms ficam guardados no programa entre quadros
+        if (camera.version() != uploaded_camera_version)
+        {
+            glUniformMatrix4fv(view_uniform, 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(projection_uniform, 1, GL_FALSE, glm::value_ptr(projection));
+            uploaded_camera_version = camera.version();
+        }
+        g_RenderQueue.setViewPosition(camera.position);
+
+        // Desenhos da cena usam o cubo e os eixos construídos em BuildTriangles()
+        game::DrawPacket scene_packet;
+        scene_packet.program = g_GpuProgramID;
+        scene_packet.vao = vertex_array_object_id;
+        scene_packet.baseVertex = g_VirtualScene.get(g_CubeFacesObject)->baseVertex;
+        scene_packet.modelUniform = model_uniform;
+        scene_packet.flagUniform = render_as_black_uniform;
+        scene_packet.flag = false;
+
+        e1->onUpdate(dt);
+        e2->onUpdate(dt);
+
+        e1->onRender(g_RenderQueue, g_StreamBuffer, g_GeometryArena, scene_packet);
+        e2->onRender(g_RenderQueue, g_StreamBuffer, g_GeometryArena, scene_packet);
+
+        UpdateSceneMeshes();
+        BuildScenePackets(scene_packet, scene_packets);
+        for (size_t i = 0; i < scene_packets.size(); ++i)
+            g_RenderQueue.submit(scene_packets[i].packet, game::LAYER_OPAQUE, scene_packets[i].position);
+
+        // Overlay text (o texto usa o tamanho da janela)
+        if (window)
+        {
+            if (!camera.isLookAt) {
+                showReticle(window);
+            }
+
+            TextRendering_ShowProjection(window);
+            TextRendering_ShowFramesPerSecond(window);
+            TextRendering_ShowStateCalls(window);
+            TextRendering_ShowCulling(window);
+        }
+
+        g_RenderQueue.execute();
+
+        // Nenhum desenho deste quadro lê mais do buffer de streaming
+        g_StreamBuffer.endFrame();
+
+        if (window)
+        {
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        else
+        {
+            headless_timings.endFrame();
+            if (headless_output)
+            {
+                char path[512];
+                snprintf(path, sizeof(path), "%s/frame_%04d.ppm", headless_output, frame);
+                headless.writeFrame(path);
+            }
+        }
+    }
+
+    if (!window)
+    {
+        headless_timings.print();
+        if (headless_output)
+            headless_timings.write(std::string(headless_output) + "/timings.csv");
+    }
+
+    g_MeshStreamer.stop();
+    g_GeometryArena.destroy();
+    glfwTerminate();
+    return 0;
+}
+
+void DrawCube(GLint render_as_black_uniform)
+{
+    const game::SceneObject &cube_faces = *g_VirtualScene.get(g_CubeFacesObject);
+    const game::SceneObject &axes = *g_VirtualScene.get(g_AxesObject);
+    const game::SceneObject &cube_edges = *g_VirtualScene.get(g_CubeEdgesObject);
+
+    glUniform1i(render_as_black_uniform, false);
+    // Cube
+    {
+        glDrawElementsBaseVertex(
+                cube_faces.renderingMode, // Veja slides 182-188 do documento Aula_04_Modelagem_Geometrica_3D.pdf
+                cube_faces.indexCount,    //
+                GL_UNSIGNED_INT,
+                (void *)cube_faces.firstIndex,
+                cube_faces.baseVertex);
+    }
+    return;
+    // Axes
+    {
+        glLineWidth(4.0f);
+        glDrawElementsBaseVertex(
+                axes.renderingMode,
+                axes.indexCount,
+                GL_UNSIGNED_INT,
+                (void *)axes.firstIndex,
+                axes.baseVertex);
+    }
+    // Edges
+    {
+        glUniform1i(render_as_black_uniform, true);
+        glDrawElementsBaseVertex(
+                cube_edges.renderingMode,
+                cube_edges.indexCount,
+                GL_UNSIGNED_INT,
+                (void *)cube_edges.firstIndex,
+                cube_edges.baseVertex);
+    }
+}
+
+// Cubo e eixos: posições, cores e índices. Usados por BuildTriangles() e
+// pelo renderizador de software (RenderSoftware()).
+const GLfloat g_CubeAxesModelCoefficients[] = {
+    // Vértices de um cubo
+    //    X      Y     Z     W
+    -0.5f, 0.0f, 0.5f, 1.0f,   // posição do vértice 0
+    -0.5f, -1.0f, 0.5f, 1.0f,  // posição do vértice 1
+    0.5f, -1.0f, 0.5f, 1.0f,   // posição do vértice 2
+    0.5f, 0.0f, 0.5f, 1.0f,    // posição do vértice 3
+    -0.5f, 0.0f, -0.5f, 1.0f,  // posição do vértice 4
+    -0.5f, -1.0f, -0.5f, 1.0f, // posição do vértice 5
+    0.5f, -1.0f, -0.5f, 1.0f,  // posição do vértice 6
+    0.5f, 0.0f, -0.5f, 1.0f,   // posição do vértice 7
+                               // Vértices para desenhar o eixo X
+                               //    X      Y     Z     W
+    0.0f, 0.0f, 0.0f, 1.0f,    // posição do vértice 8
+    1.0f, 0.0f, 0.0f, 1.0f,    // posição do vértice 9
+                               // Vértices para desenhar o eixo Y
+                               //    X      Y     Z     W
+    0.0f, 0.0f, 0.0f, 1.0f,    // posição do vértice 10
+    0.0f, 1.0f, 0.0f, 1.0f,    // posição do vértice 11
+                               // Vértices para desenhar o eixo Z
+                               //    X      Y     Z     W
+    0.0f, 0.0f, 0.0f, 1.0f,    // posição do vértice 12
+    0.0f, 0.0f, 1.0f, 1.0f,    // posição do vértice 13
+};
+const GLfloat g_CubeAxesColorCoefficients[] = {
+        // Cores dos vértices do cubo
+        //  R     G     B     A
+        1.0f, 0.5f, 0.0f, 1.0f, // cor do vértice 0
+        1.0f, 0.5f, 0.0f, 1.0f, // cor do vértice 1
+        0.0f, 0.5f, 1.0f, 1.0f, // cor do vértice 2
+        0.0f, 0.5f, 1.0f, 1.0f, // cor do vértice 3
+        1.0f, 0.5f, 0.0f, 1.0f, // cor do vértice 4
+        1.0f, 0.5f, 0.0f, 1.0f, // cor do vértice 5
+        0.0f, 0.5f, 1.0f, 1.0f, // cor do vértice 6
+        0.0f, 0.5f, 1.0f, 1.0f, // cor do vértice 7
+        // Cores para desenhar o eixo X
+        1.0f, 0.0f, 0.0f, 1.0f, // cor do vértice 8
+        1.0f, 0.0f, 0.0f, 1.0f, // cor do vértice 9
+        // Cores para desenhar o eixo Y
+        0.0f, 1.0f, 0.0f, 1.0f, // cor do vértice 10
+        0.0f, 1.0f, 0.0f, 1.0f, // cor do vértice 11
+        // Cores para desenhar o eixo Z
+        0.0f, 0.0f, 1.0f, 1.0f, // cor do vértice 12
+        0.0f, 0.0f, 1.0f, 1.0f, // cor do vértice 13
+};
+const GLuint g_CubeAxesIndices[] = {
+    // Definimos os índices dos vértices que definem as FACES de um cubo
+    // através de 12 triângulos que serão desenhados com o modo de renderização
+    // GL_TRIANGLES.
+    0, 1, 2, // triângulo 1
+    7, 6, 5, // triângulo 2
+    3, 2, 6, // triângulo 3
+    4, 0, 3, // triângulo 4
+    4, 5, 1, // triângulo 5
+    1, 5, 6, // triângulo 6
+    0, 2, 3, // triângulo 7
+    7, 5, 4, // triângulo 8
+    3, 6, 7, // triângulo 9
+    4, 3, 7, // triângulo 10
+    4, 1, 0, // triângulo 11
+    1, 6, 2, // triângulo 12
+             // Definimos os índices dos vértices que definem as ARESTAS de um cubo
+             // através de 12 linhas que serão desenhadas com o modo de renderização
+             // GL_LINES.
+    0, 1,    // linha 1
+    1, 2,    // linha 2
+    2, 3,    // linha 3
+    3, 0,    // linha 4
+    0, 4,    // linha 5
+    4, 7,    // linha 6
+    7, 6,    // linha 7
+    6, 2,    // linha 8
+    6, 5,    // linha 9
+    5, 4,    // linha 10
+    5, 1,    // linha 11
+    7, 3,    // linha 12
+             // Definimos os índices dos vértices que definem as linhas dos eixos X, Y,
+             // Z, que serão desenhados com o modo GL_LINES.
+    8, 9,    // linha 1
+    10, 11,  // linha 2
+    12, 13   // linha 3
+};
+GLuint BuildTriangles()
+{
+    // Os vértices são enviados à GPU em um formato compacto: posição como
+    // half float (W é sempre 1, valor padrão do atributo) e cor como RGBA8,
+    // intercalados em um único buffer. O shader continua recebendo vec4.
+    const size_t vertex_count = sizeof(g_CubeAxesModelCoefficients) / (4 * sizeof(GLfloat));
+    mesh::VertexLayout layout = {};
+    mesh::addAttribute(layout, mesh::LOCATION_POSITION, 3, mesh::FORMAT_HALF);
+    mesh::addAttribute(layout, mesh::LOCATION_COLOR, 4, mesh::FORMAT_UNORM8);
+    std::vector<unsigned char> vertices(vertex_count * layout.stride);
+    for (size_t i = 0; i < vertex_count; ++i)
+    {
+        unsigned char *vertex = &vertices[i * layout.stride];
+        mesh::packAttribute(vertex + layout.attributes[0].offset, &g_CubeAxesModelCoefficients[i * 4], 3, mesh::FORMAT_HALF);
+        mesh::packAttribute(vertex + layout.attributes[1].offset, &g_CubeAxesColorCoefficients[i * 4], 4, mesh::FORMAT_UNORM8);
+    }
+    printf("Cube/axes vertices: %zu -> %u bytes each, %zu -> %zu bytes\n",
+           8 * sizeof(GLfloat), layout.stride, sizeof(g_CubeAxesModelCoefficients) + sizeof(g_CubeAxesColorCoefficients), vertices.size());
+
+    // Cubo e eixos ocupam um intervalo da arena de geometria; os índices
+    // acima são relativos ao seu primeiro vértice (glDrawElementsBaseVertex).
+    mesh::GpuMesh geometry;
+    g_GeometryArena.allocate(layout, (uint32_t)vertex_count, sizeof(g_CubeAxesIndices) / sizeof(GLuint), geometry);
+    g_GeometryArena.write(geometry, vertices.data(), g_CubeAxesIndices);
+    AddCubeAxesObjects(geometry.firstIndex * sizeof(GLuint), geometry.baseVertex);
+
+    // Retornamos o VAO da arena para este formato de vértice. Isso é tudo
+    // que será necessário para renderizar os triângulos definidos acima.
+    return geometry.vao;
+}
+
+void AddCubeAxesObjects(uintptr_t first, GLint base_vertex)
+{
+    game::SceneObject cube_faces;
+    cube_faces.name = "Cubo (faces coloridas)";
+    cube_faces.firstIndex = first + 0;           // Primeiro índice está em indices[0]
+    cube_faces.indexCount = 36;                  // Último índice está em indices[35]; total de 36 índices.
+    cube_faces.renderingMode = GL_TRIANGLES;     // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
+    cube_faces.baseVertex = base_vertex;
+    g_VirtualScene.create(hash::fnv1a32("cube_faces"), cube_faces);
+    game::SceneObject cube_edges;
+    cube_edges.name = "Cubo (arestas pretas)";
+    cube_edges.firstIndex = first + 36 * sizeof(GLuint); // Primeiro índice está em indices[36]
+    cube_edges.indexCount = 24;                          // Último índice está em indices[59]; total de 24 índices.
+    cube_edges.renderingMode = GL_LINES;                 // Índices correspondem ao tipo de rasterização GL_LINES.
+    cube_edges.baseVertex = base_vertex;
+    // Adicionamos o objeto criado acima na nossa cena virtual (g_VirtualScene).
+    g_VirtualScene.create(hash::fnv1a32("cube_edges"), cube_edges);
+    // Criamos um terceiro objeto virtual (SceneObject) que se refere aos eixos XYZ.
+    game::SceneObject axes;
+    axes.name = "Eixos XYZ";
+    axes.firstIndex = first + 60 * sizeof(GLuint); // Primeiro índice está em indices[60]
+    axes.indexCount = 6;                           // Último índice está em indices[65]; total de 6 índices.
+    axes.renderingMode = GL_LINES;                 // Índices correspondem ao tipo de rasterização GL_LINES.
+    axes.baseVertex = base_vertex;
+    g_VirtualScene.create(hash::fnv1a32("axes"), axes);
+
+    g_CubeFacesObject = g_VirtualScene.find(hash::fnv1a32("cube_faces"));
+    g_CubeEdgesObject = g_VirtualScene.find(hash::fnv1a32("cube_edges"));
+    g_AxesObject = g_VirtualScene.find(hash::fnv1a32("axes"));
+}
+
+// Modelos da cena e suas posições no mundo
+struct MeshPlacement { const char *source; glm::mat4 model; };
+const MeshPlacement g_MeshPlacements[] = {
+    { "../data/tower.obj",  Matrix_Translate(15.0f, 0.92f * 2.0f, -10.0f) * Matrix_Scale(2.0f, 2.0f, 2.0f) },
+    { "../data/build1.obj", Matrix_Translate(-60.0f, 8.4f, -60.0f) * Matrix_Scale(0.01f, 0.01f, 0.01f) },
+    { "../data/bunny.obj",  Matrix_Translate(25.0f, 3.0f, 20.0f) * Matrix_Scale(3.0f, 3.0f, 3.0f) },
+    { "../data/tree_stump_01_4k.obj", Matrix_Translate(-20.0f, 1.2f, 15.0f) * Matrix_Scale(6.0f, 6.0f, 6.0f) },
+};
+
+void LoadSceneMeshes(GLFWwindow *window)
+{
+    // Os modelos não têm cor por vértice; usamos uma cor constante para o
+    // atributo "color_coefficients" quando ele não está habilitado no VAO.
+    glVertexAttrib4f(mesh::LOCATION_COLOR, 0.6f, 0.6f, 0.6f, 1.0f);
+
+    g_MeshStreamer.start(window, "../cache/meshes", &g_GeometryArena);
+    for (size_t i = 0; i < sizeof(g_MeshPlacements) / sizeof(g_MeshPlacements[0]); ++i)
+    {
+        MeshInstance instance = PlaceSceneMesh(i);
+        instance.ticket = g_MeshStreamer.request(instance.source, instance.model[3]);
+        g_SceneMeshes.push_back(instance);
+    }
+}
+
+MeshInstance PlaceSceneMesh(size_t index)
+{
+    MeshInstance instance;
+    instance.source = g_MeshPlacements[index].source;
+    instance.ticket = -1;
+    instance.requested = platform::seconds();
+    instance.model = g_MeshPlacements[index].model;
+    instance.decode = Matrix_Identity();
+    instance.scale = mesh::maxScaleOf(instance.model);
+    instance.lod = -1;
+    return instance;
+}
+
+void AttachSceneMesh(MeshInstance &instance, const mesh::GpuMesh &gpu, const std::shared_ptr<collision::TriangleBvh> &bvh,
+                     const std::shared_ptr<collision::OccluderMesh> &occluder)
+{
+    instance.gpu = gpu;
+    instance.bvh = bvh;
+    instance.occluder = occluder;
+    instance.decode = Matrix_Translate(gpu.positionOffset[0], gpu.positionOffset[1], gpu.positionOffset[2]) *
+                      Matrix_Scale(gpu.positionScale[0], gpu.positionScale[1], gpu.positionScale[2]);
+    printf("Mesh \"%s\": %d triangles, %u LODs, ready after %.2f ms\n", instance.source, gpu.indexCount / 3,
+           gpu.lodCount, (platform::seconds() - instance.requested) * 1000.0);
+}
+
+void RebuildSceneBvh()
+{
+    g_SceneBvh.clear();
+    for (size_t i = 0; i < g_SceneMeshes.size(); ++i)
+    {
+        if (g_SceneMeshes[i].bvh)
+            g_SceneBvh.add(g_SceneMeshes[i].bvh.get(), g_SceneMeshes[i].model, (uint32_t)i);
+    }
+    g_SceneBvh.build();
+    for (uint32_t i = 0; i < g_SceneBvh.objectCount(); ++i)
+        g_SceneMeshes[g_SceneBvh.objectId(i)].bounds = g_SceneBvh.objectBounds(i);
+    ++g_SceneVersion;
+}
+
+// Recebe os modelos cujo carregamento terminou desde o último quadro.
+void UpdateSceneMeshes()
+{
+    g_MeshStreamer.setViewPosition(camera.position);
+
+    std::vector<mesh::StreamedMesh> ready;
+    g_MeshStreamer.update(ready);
+    bool rebuild = false;
+    for (size_t i = 0; i < ready.size(); ++i)
+    {
+        for (size_t j = 0; j < g_SceneMeshes.size(); ++j)
+        {
+            MeshInstance &instance = g_SceneMeshes[j];
+            if (instance.ticket != ready[i].ticket)
+                continue;
+            if (!ready[i].loaded)
+                break;
+            AttachSceneMesh(instance, ready[i].gpu, ready[i].bvh, ready[i].occluder);
+            rebuild = true;
+        }
+    }
+
+    if (rebuild)
+        RebuildSceneBvh();
+}
+
+void BuildScenePackets(const game::DrawPacket &scene_packet, std::vector<ScenePacket> &packets)
+{
+    packets.clear();
+    if (camera.version() != g_CulledCameraVersion || g_SceneVersion != g_CulledSceneVersion)
+    {
+        g_FrustumCuller.cull(g_SceneBvh, collision::Frustum::fromMatrix(camera.viewProjectionMatrix()), g_VisibleMeshes);
+        g_OcclusionBuffer.begin(camera.viewProjectionMatrix());
+        for (size_t i = 0; i < g_VisibleMeshes.size(); ++i)
+        {
+            const MeshInstance &instance = g_SceneMeshes[g_VisibleMeshes[i]];
+            if (instance.occluder)
+                g_OcclusionBuffer.addOccluder(*instance.occluder, instance.model);
+        }
+        g_OcclusionBuffer.rasterize();
+        // Ficam na lista só os modelos que não estão atrás dos oclusores
+        size_t kept = 0;
+        for (size_t i = 0; i < g_VisibleMeshes.size(); ++i)
+        {
+            if (g_OcclusionBuffer.isVisible(g_SceneMeshes[g_VisibleMeshes[i]].bounds))
+                g_VisibleMeshes[kept++] = g_VisibleMeshes[i];
+        }
+        g_VisibleMeshes.resize(kept);
+        g_CulledCameraVersion = camera.version();
+        g_CulledSceneVersion = g_SceneVersion;
+    }
+    for (size_t i = 0; i < g_VisibleMeshes.size(); ++i)
+    {
+        MeshInstance &instance = g_SceneMeshes[g_VisibleMeshes[i]];
+        instance.lod = mesh::selectLod(instance.gpu, instance.scale, mesh::pixelsPerUnit(camera, instance.model[3]), instance.lod);
+        const mesh::MeshLod &lod = instance.gpu.lods[instance.lod];
+        ScenePacket packet;
+        packet.packet = scene_packet;
+        packet.packet.vao = instance.gpu.vao;
+        packet.packet.model = instance.model * instance.decode;
+        packet.packet.mode = GL_TRIANGLES;
+        packet.packet.count = lod.indexCount;
+        packet.packet.first = (instance.gpu.firstIndex + lod.firstIndex) * sizeof(uint32_t);
+        packet.packet.baseVertex = instance.gpu.baseVertex;
+        packet.position = instance.model[3];
+        packets.push_back(packet);
+    }
+
+    // Axes
+    const game::SceneObject &object = *g_VirtualScene.get(g_AxesObject);
+    ScenePacket axes;
+    axes.packet = scene_packet;
+    axes.packet.model = Matrix_Identity();
+    axes.packet.lineWidth = 10.0f;
+    axes.packet.mode = object.renderingMode;
+    axes.packet.count = object.indexCount;
+    axes.packet.first = object.firstIndex;
+    axes.packet.baseVertex = object.baseVertex;
+    axes.position = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    packets.push_back(axes);
+}
+
+int RenderSoftware(const char *output, const char *golden)
+{
+    typedef std::chrono::steady_clock Clock;
+    game::SoftwareRenderer renderer((int)camera.width, (int)camera.height);
+
+    // Mesmos vértices e índices que BuildTriangles() envia para a GPU, com
+    // os mesmos objetos em g_VirtualScene (começando do índice 0).
+    const GLuint CUBE_AXES = 1;
+    game::SoftMesh cube_axes;
+    for (size_t i = 0; i < sizeof(g_CubeAxesModelCoefficients) / (4 * sizeof(GLfloat)); ++i)
+    {
+        cube_axes.positions.push_back(glm::make_vec4(&g_CubeAxesModelCoefficients[i * 4]));
+        cube_axes.colors.push_back(glm::make_vec4(&g_CubeAxesColorCoefficients[i * 4]));
+    }
+    cube_axes.indices.assign(g_CubeAxesIndices, g_CubeAxesIndices + sizeof(g_CubeAxesIndices) / sizeof(GLuint));
+    renderer.setVertexArray(CUBE_AXES, &cube_axes);
+    AddCubeAxesObjects(0, 0);
+
+    // Os modelos vêm do mesmo cache que o streaming usa na GPU: posições
+    // quantizadas (decodificadas pela matriz "decode") e todos os LODs no
+    // buffer de índices. Cada um tem seu próprio "VAO", sem cor por vértice
+    // (cor padrão, como em LoadSceneMeshes()).
+    const size_t mesh_count = sizeof(g_MeshPlacements) / sizeof(g_MeshPlacements[0]);
+    std::vector<game::SoftMesh> meshes(mesh_count);
+    for (size_t i = 0; i < mesh_count; ++i)
+    {
+        MeshInstance instance = PlaceSceneMesh(i);
+        mesh::MeshFile file;
+        if (mesh::loadCached(instance.source, "../cache/meshes", file))
+        {
+            const mesh::MeshFileHeader &header = file.info();
+            mesh::GpuMesh gpu = mesh::describe(file);
+            gpu.vao = CUBE_AXES + 1 + (GLuint)i;
+
+            std::vector<float> positions;
+            mesh::readPositions(file, positions);
+            for (size_t v = 0; v < header.vertexCount; ++v)
+            {
+                glm::vec4 stored(1.0f);
+                for (int k = 0; k < 3; ++k)
+                    stored[k] = (positions[v * 3 + k] - gpu.positionOffset[k]) / gpu.positionScale[k];
+                meshes[i].positions.push_back(stored);
+            }
+            const uint32_t *indices = (const uint32_t *)file.indexData();
+            meshes[i].indices.assign(indices, indices + header.indexCount);
+            renderer.setVertexArray(gpu.vao, &meshes[i]);
+
+            std::shared_ptr<collision::TriangleBvh> bvh;
+            std::shared_ptr<collision::OccluderMesh> occluder;
+            mesh::buildCpuData(file, bvh, occluder);
+            AttachSceneMesh(instance, gpu, bvh, occluder);
+        }
+        g_SceneMeshes.push_back(instance);
+    }
+    RebuildSceneBvh();
+
+    glm::mat4 view;
+    glm::mat4 projection;
+    camera.computeMatrices(view, projection);
+    renderer.setViewProjection(view, projection);
+
+    game::DrawPacket scene_packet;
+    scene_packet.vao = CUBE_AXES;
+    std::vector<ScenePacket> packets;
+    BuildScenePackets(scene_packet, packets);
+
+    // Uma thread e todas: as imagens devem ser idênticas.
+    unsigned thread_counts[] = {1, parallel::threadCount()};
+    std::vector<uint32_t> images[2];
+    for (int run = 0; run < 2; ++run)
+    {
+        Clock::time_point start = Clock::now();
+        renderer.clear(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+        for (size_t i = 0; i < packets.size(); ++i)
+            renderer.submit(packets[i].packet);
+        renderer.execute(thread_counts[run]);
+        double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+        const game::SoftwareRenderer::Statistics &stats = renderer.statistics();
+        printf("Software rendering, %u threads: %.2f ms, %zu draws, %zu triangles (%zu culled), %zu lines, %zu fragments\n",
+               thread_counts[run], time * 1000.0, stats.draws, stats.triangles, stats.trianglesCulled, stats.lines, stats.fragments);
+        images[run].assign(renderer.pixels(), renderer.pixels() + (size_t)renderer.stride() * renderer.height());
+    }
+    if (images[0] != images[1])
+    {
+        fprintf(stderr, "ERROR: Software rendering depends on the thread count.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!renderer.writePpm(output))
+        return EXIT_FAILURE;
+    printf("Wrote \"%s\"\n", output);
+
+    if (golden)
+    {
+        size_t different = 0;
+        if (!renderer.compareWithPpm(golden, 2, different))
+            return EXIT_FAILURE;
+        printf("%zu pixels differ from \"%s\"\n", different, golden);
+        if (different > 0)
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+std::string ReadShaderSource(const char *filename)
+{
+    // Le o arquivo do shader
+    std::ifstream file;
+    try
+    {
+        file.exceptions(std::ifstream::failbit);
+        file.open(filename);
+    }
+    catch (std::exception &e)
+    {
+        fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", filename);
+        std::exit(EXIT_FAILURE);
+    }
+    std::stringstream shader;
+    shader << file.rdbuf();
+    return shader.str();
+}
+
+game::PendingProgram LoadShadersFromFiles()
+{
+    std::string vertex_source = ReadShaderSource("../assets/shader_vertex.glsl");
+    std::string fragment_source = ReadShaderSource("../assets/shader_fragment.glsl");
+    if (g_GpuProgramID != 0)
+        glDeleteProgram(g_GpuProgramID);
+    g_GpuProgramID = 0;
+    return g_ProgramCache.begin("shader_vertex.glsl + shader_fragment.glsl", vertex_source, fragment_source);
+}
+
+void FramebufferSizeCallback(GLFWwindow *window, int width, int height)
+{
+    glViewport(0, 0, width, height);
+    camera.screenRatio = ((float)width) / ((float)height);
+    camera.width = (float)width;
+    camera.height = (float)height;
+}
+
+bool g_LeftMouseButtonPressed = false;
+bool g_RightMouseButtonPressed = false;
+bool g_MiddleMouseButtonPressed = false;
+double g_LastCursorPosX, g_LastCursorPosY;
+
+void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
+        g_LeftMouseButtonPressed = true;
+
+    } else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE) {
+        g_LeftMouseButtonPressed = false;
+    }
+    else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
+    {
+        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
+        g_RightMouseButtonPressed = true;
+
+        collision::Ray ray = {
+                {camera.position.x, camera.position.y, camera.position.z},
+                {camera.viewVector.x, camera.viewVector.y, camera.viewVector.z}
+        };
+
+        // Pick the nearest model under the crosshair, if any
+        collision::RaycastHit hit;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool picked = g_SceneBvh.raycast(ray, hit);
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        if (picked) {
+            printf("Picked \"%s\" triangle %u at (%.2f, %.2f, %.2f), t = %.2f, %.1f us (%zu objects, %zu triangles)\n",
+                   g_SceneMeshes[hit.object].source, hit.triangle, hit.position.x, hit.position.y, hit.position.z,
+                   hit.t, micros, g_SceneBvh.objectCount(), g_SceneBvh.triangleCount());
+            return;
+        }
+
+        // Intersect view with floor
+        collision::Plane floor = {{0, 0 ,0}, {0, 1, 0}};
+        float time = collision::collide(floor, ray);
+        collision::Point p = ray.at(time);
+        onClickFloor(button, action, mods, p.x, p.z);
+    } else if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE) {
+        g_RightMouseButtonPressed = false;
+    }
+    else if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_PRESS)
+    {
+        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
+        g_MiddleMouseButtonPressed = true;
+    }
+    else if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_RELEASE)
+    {
+        g_MiddleMouseButtonPressed = false;
+    }
+}
+
+void CursorPosCallback(GLFWwindow *window, double xpos, double ypos)
+{
+    float dx = xpos - g_LastCursorPosX;
+    float dy = ypos - g_LastCursorPosY;
+    if (g_LeftMouseButtonPressed)
+    {
+        // Atualizamos parâmetros da câmera com os deslocamentos
+        camera.theta -= 0.002f*dx;
+        camera.phi   += 0.002f*dy;
+        // Em coordenadas esféricas, o ângulo phi deve ficar entre -pi/2 e +pi/2.
+        float phimax = 3.141592f / 2;
+        float phimin = -phimax;
+        if (camera.phi > phimax)
+            camera.phi = phimax;
+        if (camera.phi < phimin)
+            camera.phi = phimin;
+        // Atualizamos as variáveis globais para armazenar a posição atual do
+        // cursor como sendo a última posição conhecida do cursor.
+        g_LastCursorPosX = xpos;
+        g_LastCursorPosY = ypos;
+    }
+    if (g_RightMouseButtonPressed)
+    {
+        // Deslocamento do cursor do mouse em x e y de coordenadas de tela!
+    }
+    if (g_MiddleMouseButtonPressed)
+    {
+    }
+}
+
+void ScrollCallback(GLFWwindow *window, double xoffset, double yoffset)
+{
+    camera.distance -= 1.0f * yoffset;
+    const float verySmallNumber = std::numeric_limits<float>::epsilon();
+    if (camera.distance < verySmallNumber)
+    {
+        camera.distance = verySmallNumber;
+    }
+}
+
+RenderObject renderObjectOf(game::SceneHandle handle) {
+    const game::SceneObject &object = *g_VirtualScene.get(handle);
+    return {
+            (void*)object.firstIndex,
+            object.indexCount,
+            object.renderingMode
+    };
+}
+
+
+void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mod)
+{
+    for (int i = 0; i < 10; ++i)
+        if (key == GLFW_KEY_0 + i && action == GLFW_PRESS && mod == GLFW_MOD_SHIFT)
+            std::exit(100 + i);
+    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
+        glfwSetWindowShouldClose(window, GL_TRUE);
+    } else if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        camera.usePerspectiveProjection = true;
+    }
+    else if (key == GLFW_KEY_O && action == GLFW_PRESS)
+    {
+        camera.usePerspectiveProjection = false;
+    }
+    else if (key == GLFW_KEY_H && action == GLFW_PRESS)
+    {
+        g_ShowInfoText = !g_ShowInfoText;
+    } else if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        game::glState.printStatistics();
+        game::glState.resetStatistics();
+        g_GeometryArena.printStatistics();
+    } else if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+        sphericalFirework(glm::vec4(0, 0, 0, 1), e2, e1);
+    } else if (key == GLFW_KEY_A && action == GLFW_PRESS) {
+        camera.movement.decX = true;
+    } else if (key == GLFW_KEY_A && action == GLFW_RELEASE) {
+        camera.movement.decX = false;
+    } else if (key == GLFW_KEY_D && action == GLFW_PRESS) {
+        camera.movement.incX = true;
+    } else if (key == GLFW_KEY_D && action == GLFW_RELEASE) {
+        camera.movement.incX = false;
+    } else if (key == GLFW_KEY_S && action == GLFW_PRESS) {
+        camera.movement.decY = true;
+    } else if (key == GLFW_KEY_S && action == GLFW_RELEASE) {
+        camera.movement.decY = false;
+    } else if (key == GLFW_KEY_W && action == GLFW_PRESS) {
+        camera.movement.incY = true;
+    } else if (key == GLFW_KEY_W && action == GLFW_RELEASE) {
+        camera.movement.incY = false;
+    } else if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
+        camera.movement.incZ = true;
+    } else if (key == GLFW_KEY_SPACE && action == GLFW_RELEASE) {
+        camera.movement.incZ = false;
+    } else if (key == GLFW_KEY_LEFT_SHIFT && action == GLFW_PRESS) {
+        camera.movement.decZ = true;
+    } else if (key == GLFW_KEY_LEFT_SHIFT && action == GLFW_RELEASE) {
+        camera.movement.decZ = false;
+    } else if (key == GLFW_KEY_Q && action == GLFW_PRESS) {
+        camera.isLookAt ^= true;
+    } else if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+        camera.bezierTime = 0.0f;
+        camera.bezierDuration = 4.0f;
+        camera.bezierCurve.p0 = glm::vec4(10.0f, 50.0f, 10.0f, 1.0f);
+        camera.bezierCurve.p1 = glm::vec4(0.0f, 0.0f, 20.0f, 1.0f);
+        camera.bezierCurve.p2 = glm::vec4(00.0f, -20.0f, -30.0f, 1.0f);
+        camera.bezierCurve.p3 = glm::vec4(-50.0f, 10.0f, -0.0f, 1.0f);
+    }
+}
+
+void ErrorCallback(int error, const char *description)
+{
+    fprintf(stderr, "ERROR: GLFW: %s\n", description);
+}
+
+// Escrevemos na tela qual matriz de projeção está sendo utilizada.
+void TextRendering_ShowProjection(GLFWwindow *window)
+{
+    if (!g_ShowInfoText)
+        return;
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    if (camera.usePerspectiveProjection)
+        TextRendering_PrintString(window, "Perspective", 1.0f - 13 * charwidth, -1.0f + 2 * lineheight / 10, 1.0f);
+    else
+        TextRendering_PrintString(window, "Orthographic", 1.0f - 13 * charwidth, -1.0f + 2 * lineheight / 10, 1.0f);
+}
+
+// Escrevemos na tela o número de quadros renderizados por segundo (frames per
+// second).
+void showReticle(GLFWwindow* window)
+{
+    static char  buffer[] = "+";
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    TextRendering_PrintString(window, buffer, -0.5f*charwidth, -0.5*lineheight, 1.0f);
+}
+
+void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
+{
+    if (!g_ShowInfoText)
+        return;
+
+    // Variáveis estáticas (static) mantém seus valores entre chamadas
+    // subsequentes da função!
+    static float old_seconds = (float)glfwGetTime();
+    static int ellapsed_frames = 0;
+    static char buffer[20] = "?? fps";
+    static int numchars = 7;
+
+    ellapsed_frames += 1;
+
+    // Recuperamos o número de segundos que passou desde a execução do programa
+    float seconds = (float)glfwGetTime();
+
+    // Número de segundos desde o último cálculo do fps
+    float ellapsed_seconds = seconds - old_seconds;
+
+    if (ellapsed_seconds > 1.0f)
+    {
+        numchars = snprintf(buffer, 20, "%.2f fps", ellapsed_frames / ellapsed_seconds);
+
+        old_seconds = seconds;
+        ellapsed_frames = 0;
+    }
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    TextRendering_PrintString(window, buffer, 1.0f - (numchars + 1) * charwidth, 1.0f - lineheight, 1.0f);
+}
+
+// Escrevemos na tela quantas mudanças de estado do OpenGL foram feitas no
+// quadro anterior e quantas foram evitadas por já estarem em vigor.
+void TextRendering_ShowStateCalls(GLFWwindow* window)
+{
+    static game::GLState::Counter previous_total;
+    static char buffer[48] = "";
+    static int numchars = 0;
+
+    game::GLState::Counter total = game::glState.total();
+    if (total.issued >= previous_total.issued && total.skipped >= previous_total.skipped)
+    {
+        numchars = snprintf(buffer, 48, "GL state: %lu set, %lu skipped",
+                            total.issued - previous_total.issued, total.skipped - previous_total.skipped);
+    }
+    previous_total = total;
+
+    if (!g_ShowInfoText)
+        return;
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    TextRendering_PrintString(window, buffer, 1.0f - (numchars + 1) * charwidth, 1.0f - 2 * lineheight, 1.0f);
+}
+
+// Escrevemos na tela quantos modelos passaram pelo recorte do frustum e
+// quantos destes ficaram escondidos atrás de outros
+void TextRendering_ShowCulling(GLFWwindow* window)
+{
+    if (!g_ShowInfoText)
+        return;
+
+    const collision::CullStatistics &stats = g_FrustumCuller.statistics();
+    char buffer[64];
+    int numchars = snprintf(buffer, 64, "Culling: %zu/%zu in frustum, %zu occluded",
+                            stats.visible, stats.visible + stats.culled, g_OcclusionBuffer.statistics().occludeesHidden);
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    TextRendering_PrintString(window, buffer, 1.0f - (numchars + 1) * charwidth, 1.0f - 3 * lineheight, 1.0f);
+}
+
+// set makeprg=cd\ ..\ &&\ make\ run\ >/dev/null
+// vim: set spell spelllang=pt_br :
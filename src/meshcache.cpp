@@ -0,0 +1,296 @@
+#include "meshcache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "hash.h"
+#include "glstate.h"
+
+namespace mesh {
+    namespace _internal {
+        const char MESH_FILE_MAGIC[4] = {'F', 'C', 'G', 'M'};
+
+        uint64_t alignUp(uint64_t value, uint64_t alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // Every attribute has a known format and fits in the stride; there
+        // is a position of at least 3 components (readPositions() decodes 3).
+        bool validLayout(const VertexLayout &layout) {
+            if (layout.attributeCount > MAX_VERTEX_ATTRIBUTES) {
+                return false;
+            }
+            bool position = false;
+            for (uint32_t i = 0; i < layout.attributeCount; i++) {
+                const VertexAttribute &attribute = layout.attributes[i];
+                if (attribute.format > FORMAT_UNORM8 || attribute.components == 0 || attribute.components > 4 ||
+                    (uint64_t) attribute.offset + attributeSize(attribute.components, (AttributeFormat) attribute.format) > layout.stride) {
+                    return false;
+                }
+                position = position || (attribute.location == LOCATION_POSITION && attribute.components >= 3);
+            }
+            return position;
+        }
+
+        // "offset" and "bytes" describe a range inside a file of "size" bytes.
+        bool validRange(uint64_t offset, uint64_t bytes, uint64_t size) {
+            return offset <= size && bytes <= size - offset;
+        }
+
+        // Vertex size if every attribute was stored as floats.
+        size_t floatVertexSize(const MeshData &mesh) {
+            return 3 * sizeof(float) + (mesh.normals.empty() ? 0 : 3 * sizeof(float)) + (mesh.texcoords.empty() ? 0 : 2 * sizeof(float));
+        }
+    }
+
+    uint64_t hashFile(const std::string &path) {
+        platform::MappedFile file;
+        if (!file.open(path)) {
+            return 0;
+        }
+        return hash::fnv1a64(file.data(), file.size());
+    }
+
+    std::string cachePathOf(const std::string &sourcePath, const std::string &cacheDirectory) {
+        size_t slash = sourcePath.find_last_of("/\\");
+        std::string name = slash == std::string::npos ? sourcePath : sourcePath.substr(slash + 1);
+        size_t dot = name.find_last_of('.');
+        if (dot != std::string::npos) {
+            name = name.substr(0, dot);
+        }
+        return cacheDirectory + "/" + name + ".mesh";
+    }
+
+    bool cookMesh(const MeshData &mesh, const std::vector<LodLevel> &lods, uint64_t sourceHash,
+                  const std::string &cachePath, const MeshVertexFormat &format) {
+        MeshFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, _internal::MESH_FILE_MAGIC, 4);
+        header.version = MESH_FILE_VERSION;
+        header.sourceHash = sourceHash;
+
+        bool hasNormals = !mesh.normals.empty();
+        bool hasTexcoords = !mesh.texcoords.empty();
+
+        VertexLayout &layout = header.layout;
+        addAttribute(layout, LOCATION_POSITION, 3, format.position);
+        if (hasNormals) {
+            addAttribute(layout, LOCATION_NORMAL, 3, format.normal);
+        }
+        if (hasTexcoords) {
+            addAttribute(layout, LOCATION_TEXCOORD, 2, format.texcoord);
+        }
+
+        bool quantized = format.position == FORMAT_UNORM16;
+        for (int k = 0; k < 3; k++) {
+            float extent = mesh.boundsMax[k] - mesh.boundsMin[k];
+            header.positionScale[k] = quantized && extent > 0.0f ? extent : 1.0f;
+            header.positionOffset[k] = quantized ? mesh.boundsMin[k] : 0.0f;
+        }
+
+        header.vertexCount = (uint32_t) mesh.vertexCount();
+        header.lodCount = (uint32_t) std::min(lods.size(), (size_t) MAX_LOD_LEVELS);
+        for (uint32_t i = 0; i < header.lodCount; i++) {
+            header.lods[i].firstIndex = header.indexCount;
+            header.lods[i].indexCount = (uint32_t) lods[i].indices.size();
+            header.lods[i].error = lods[i].error;
+            header.indexCount += header.lods[i].indexCount;
+        }
+        header.vertexOffset = _internal::alignUp(sizeof(header), MESH_BLOB_ALIGNMENT);
+        header.vertexBytes = (uint64_t) header.vertexCount * layout.stride;
+        header.indexOffset = _internal::alignUp(header.vertexOffset + header.vertexBytes, MESH_BLOB_ALIGNMENT);
+        header.indexBytes = (uint64_t) header.indexCount * sizeof(uint32_t);
+        memcpy(header.boundsMin, mesh.boundsMin, sizeof(header.boundsMin));
+        memcpy(header.boundsMax, mesh.boundsMax, sizeof(header.boundsMax));
+
+        std::vector<char> contents(header.indexOffset + header.indexBytes, 0);
+        memcpy(contents.data(), &header, sizeof(header));
+
+        // Interleave the attributes in layout order.
+        char *vertex = contents.data() + header.vertexOffset;
+        for (size_t i = 0; i < header.vertexCount; i++) {
+            const VertexAttribute *attribute = layout.attributes;
+            float position[3];
+            for (int k = 0; k < 3; k++) {
+                position[k] = (mesh.positions[i * 3 + k] - header.positionOffset[k]) / header.positionScale[k];
+            }
+            packAttribute(vertex + attribute->offset, position, 3, format.position);
+            attribute++;
+            if (hasNormals) {
+                packAttribute(vertex + attribute->offset, &mesh.normals[i * 3], 3, format.normal);
+                attribute++;
+            }
+            if (hasTexcoords) {
+                packAttribute(vertex + attribute->offset, &mesh.texcoords[i * 2], 2, format.texcoord);
+            }
+            vertex += layout.stride;
+        }
+        uint32_t *index = (uint32_t *) (contents.data() + header.indexOffset);
+        for (uint32_t i = 0; i < header.lodCount; i++) {
+            if (header.lods[i].indexCount > 0) {
+                memcpy(index + header.lods[i].firstIndex, lods[i].indices.data(), header.lods[i].indexCount * sizeof(uint32_t));
+            }
+        }
+
+        return platform::writeFile(cachePath, contents.data(), contents.size());
+    }
+
+    bool MeshFile::open(const std::string &path) {
+        close();
+        if (!file.open(path)) {
+            return false;
+        }
+
+        const MeshFileHeader *candidate = (const MeshFileHeader *) file.data();
+        if (file.size() < sizeof(MeshFileHeader) ||
+            memcmp(candidate->magic, _internal::MESH_FILE_MAGIC, 4) != 0 ||
+            candidate->version != MESH_FILE_VERSION) {
+            file.close();
+            return false;
+        }
+
+        // A cache of the current version that fails these was truncated or
+        // corrupted; every later read trusts them.
+        bool valid = _internal::validLayout(candidate->layout) &&
+                     candidate->lodCount >= 1 && candidate->lodCount <= MAX_LOD_LEVELS &&
+                     _internal::validRange(candidate->vertexOffset, candidate->vertexBytes, file.size()) &&
+                     _internal::validRange(candidate->indexOffset, candidate->indexBytes, file.size()) &&
+                     candidate->vertexBytes >= (uint64_t) candidate->vertexCount * candidate->layout.stride &&
+                     candidate->indexBytes >= (uint64_t) candidate->indexCount * sizeof(uint32_t) &&
+                     candidate->indexOffset % sizeof(uint32_t) == 0;
+        for (uint32_t i = 0; valid && i < candidate->lodCount; i++) {
+            valid = (uint64_t) candidate->lods[i].firstIndex + candidate->lods[i].indexCount <= candidate->indexCount;
+        }
+        const uint32_t *indices = (const uint32_t *) (file.data() + candidate->indexOffset);
+        for (uint32_t i = 0; valid && i < candidate->indexCount; i++) {
+            valid = indices[i] < candidate->vertexCount;
+        }
+        if (!valid) {
+            fprintf(stderr, "WARNING: Mesh cache \"%s\" is corrupt.\n", path.c_str());
+            file.close();
+            return false;
+        }
+        header = candidate;
+        return true;
+    }
+
+    void readPositions(const MeshFile &file, std::vector<float> &positions) {
+        const MeshFileHeader &header = file.info();
+        const VertexAttribute *position = nullptr;
+        for (uint32_t i = 0; i < header.layout.attributeCount; i++) {
+            if (header.layout.attributes[i].location == LOCATION_POSITION) {
+                position = &header.layout.attributes[i];
+            }
+        }
+        positions.resize((size_t) header.vertexCount * 3);
+        if (position == nullptr) {
+            return;
+        }
+
+        const char *vertex = (const char *) file.vertexData() + position->offset;
+        for (size_t i = 0; i < header.vertexCount; i++, vertex += header.layout.stride) {
+            float *p = &positions[i * 3];
+            unpackAttribute(vertex, p, 3, (AttributeFormat) position->format);
+            for (int k = 0; k < 3; k++) {
+                p[k] = header.positionOffset[k] + header.positionScale[k] * p[k];
+            }
+        }
+    }
+
+    bool loadCached(const std::string &sourcePath, const std::string &cacheDirectory, MeshFile &file) {
+        uint64_t sourceHash = hashFile(sourcePath);
+        std::string cachePath = cachePathOf(sourcePath, cacheDirectory);
+
+        if (file.open(cachePath) && file.info().sourceHash == sourceHash) {
+            return true;
+        }
+        file.close();
+
+        MeshData mesh;
+        if (!loadObj(sourcePath, mesh)) {
+            return false;
+        }
+        // Cooking is the only place that pays for the optimization.
+        optimize(mesh, sourcePath.c_str());
+        std::vector<LodLevel> lods;
+        buildLodChain(mesh, lods, sourcePath.c_str());
+        platform::makeDirectory(cacheDirectory);
+        if (!cookMesh(mesh, lods, sourceHash, cachePath)) {
+            fprintf(stderr, "ERROR: Cannot write mesh cache \"%s\".\n", cachePath.c_str());
+            return false;
+        }
+        printf("Cooked \"%s\" (%zu vertices, %zu triangles)\n", sourcePath.c_str(), mesh.vertexCount(), mesh.triangleCount());
+        if (!file.open(cachePath)) {
+            return false;
+        }
+
+        size_t floatSize = _internal::floatVertexSize(mesh);
+        size_t packedSize = file.info().layout.stride;
+        printf("  vertices: %zu -> %zu bytes each, %.1f KB -> %.1f KB (%.0f%% saved)\n",
+               floatSize, packedSize, floatSize * mesh.vertexCount() / 1024.0, packedSize * mesh.vertexCount() / 1024.0,
+               100.0 - 100.0 * packedSize / floatSize);
+        return true;
+    }
+
+    void cookDirectory(const std::string &sourceDirectory, const std::string &cacheDirectory) {
+        std::vector<std::string> sources = platform::listFiles(sourceDirectory, ".obj");
+        for (size_t i = 0; i < sources.size(); i++) {
+            MeshFile file;
+            if (!loadCached(sources[i], cacheDirectory, file)) {
+                fprintf(stderr, "ERROR: Cannot cook \"%s\".\n", sources[i].c_str());
+            }
+        }
+    }
+
+    GpuMesh describe(const MeshFile &file) {
+        const MeshFileHeader &header = file.info();
+
+        GpuMesh gpu;
+        gpu.indexCount = (GLsizei) header.lods[0].indexCount;
+        gpu.vertexCount = header.vertexCount;
+        gpu.indexTotal = header.indexCount;
+        gpu.lodCount = header.lodCount;
+        memcpy(gpu.lods, header.lods, sizeof(gpu.lods));
+        memcpy(gpu.boundsMin, header.boundsMin, sizeof(gpu.boundsMin));
+        memcpy(gpu.boundsMax, header.boundsMax, sizeof(gpu.boundsMax));
+        memcpy(gpu.positionScale, header.positionScale, sizeof(gpu.positionScale));
+        memcpy(gpu.positionOffset, header.positionOffset, sizeof(gpu.positionOffset));
+        gpu.layout = header.layout;
+        return gpu;
+    }
+
+    GpuMesh uploadBuffers(const MeshFile &file) {
+        const MeshFileHeader &header = file.info();
+
+        GpuMesh gpu = describe(file);
+        glGenBuffers(1, &gpu.vertexBuffer);
+        glGenBuffers(1, &gpu.indexBuffer);
+
+        // GL_COPY_WRITE_BUFFER is not shadowed by game::glState, so this
+        // neither desyncs it nor needs it (it may run on another context).
+        // The mapping is the only CPU copy: the driver reads the pages of
+        // the cache file directly.
+        glBindBuffer(GL_COPY_WRITE_BUFFER, gpu.vertexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr) header.vertexBytes, file.vertexData(), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, gpu.indexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr) header.indexBytes, file.indexData(), GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return gpu;
+    }
+
+    void createVertexArray(GpuMesh &gpu) {
+        glGenVertexArrays(1, &gpu.vao);
+        game::glState.bindVertexArray(gpu.vao);
+        game::glState.bindBuffer(GL_ARRAY_BUFFER, gpu.vertexBuffer);
+        applyLayout(gpu.layout);
+        game::glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.indexBuffer);
+        game::glState.bindVertexArray(0);
+    }
+
+    GpuMesh upload(const MeshFile &file) {
+        GpuMesh gpu = uploadBuffers(file);
+        createVertexArray(gpu);
+        return gpu;
+    }
+}
@@ -0,0 +1,46 @@
+#include "meshlod.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "glm/vec3.hpp"
+#include "glm/geometric.hpp"
+
+namespace mesh {
+    float pixelsPerUnit(const game::Camera &camera, const glm::vec4 &center) {
+        float halfHeight;
+        if (camera.usePerspectiveProjection) {
+            float distance = glm::length(glm::vec3(center - camera.position));
+            halfHeight = std::max(distance, -camera.nearPlane) * std::tan(camera.field_of_view / 2.0f);
+        } else {
+            // Same extent as the orthographic projection of game::Camera.
+            halfHeight = 1.5f * camera.distance / 2.5f;
+        }
+        return halfHeight > 0.0f ? (camera.height / 2.0f) / halfHeight : 0.0f;
+    }
+
+    int selectLod(const GpuMesh &mesh, float scale, float pixelsPerUnit, int current,
+                  float maxPixelError, float hysteresis) {
+        if (mesh.lodCount == 0) {
+            return 0;
+        }
+        int last = (int) mesh.lodCount - 1;
+        int level = std::min(std::max(current, 0), last);
+        float toPixels = scale * pixelsPerUnit;
+
+        while (level > 0 && mesh.lods[level].error * toPixels > maxPixelError * (1.0f + hysteresis)) {
+            level--;
+        }
+        while (level < last && mesh.lods[level + 1].error * toPixels <= maxPixelError * (1.0f - hysteresis)) {
+            level++;
+        }
+        return level;
+    }
+
+    float maxScaleOf(const glm::mat4 &model) {
+        float x = glm::length(glm::vec3(model[0]));
+        float y = glm::length(glm::vec3(model[1]));
+        float z = glm::length(glm::vec3(model[2]));
+        return std::max(x, std::max(y, z));
+    }
+}
@@ -0,0 +1,721 @@
+#include "meshopt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#include "glm/vec3.hpp"
+#include "glm/geometric.hpp"
+
+namespace mesh {
+    namespace _internal {
+        const int FORSYTH_CACHE_SIZE = 32;
+        const float CACHE_DECAY_POWER = 1.5f;
+        const float LAST_TRIANGLE_SCORE = 0.75f;
+        const float VALENCE_BOOST_SCALE = 2.0f;
+        const float VALENCE_BOOST_POWER = 0.5f;
+        const int MAX_VALENCE = 64;
+
+        float cacheScores[FORSYTH_CACHE_SIZE];
+        float valenceScores[MAX_VALENCE];
+        bool tablesReady = false;
+
+        void initTables() {
+            if (tablesReady) {
+                return;
+            }
+            for (int i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+                if (i < 3) {
+                    // The vertices of the last triangle are scored lower so
+                    // the same triangle strip is not followed blindly.
+                    cacheScores[i] = LAST_TRIANGLE_SCORE;
+                } else {
+                    float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                    cacheScores[i] = powf(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+                }
+            }
+            valenceScores[0] = 0.0f;
+            for (int i = 1; i < MAX_VALENCE; i++) {
+                valenceScores[i] = VALENCE_BOOST_SCALE * powf((float) i, -VALENCE_BOOST_POWER);
+            }
+            tablesReady = true;
+        }
+
+        inline float vertexScore(int cachePosition, uint32_t remaining) {
+            if (remaining == 0) {
+                return -1.0f;
+            }
+            float score = cachePosition >= 0 ? cacheScores[cachePosition] : 0.0f;
+            // Vertices with few triangles left are finished first, so they
+            // leave no lonely triangles behind.
+            return score + valenceScores[remaining < (uint32_t) MAX_VALENCE ? remaining : MAX_VALENCE - 1];
+        }
+
+        // Symmetric 4x4 matrix of the quadric error metric (Garland and
+        // Heckbert): the weighted sum of squared distances to a set of
+        // planes, and the sum of the weights.
+        struct Quadric {
+            double a2, b2, c2, d2, ab, ac, ad, bc, bd, cd;
+            double weight;
+        };
+
+        void addPlane(Quadric &q, double a, double b, double c, double d, double weight) {
+            q.a2 += weight * a * a; q.b2 += weight * b * b; q.c2 += weight * c * c; q.d2 += weight * d * d;
+            q.ab += weight * a * b; q.ac += weight * a * c; q.ad += weight * a * d;
+            q.bc += weight * b * c; q.bd += weight * b * d; q.cd += weight * c * d;
+            q.weight += weight;
+        }
+
+        void addQuadric(Quadric &q, const Quadric &other) {
+            q.a2 += other.a2; q.b2 += other.b2; q.c2 += other.c2; q.d2 += other.d2;
+            q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+            q.bc += other.bc; q.bd += other.bd; q.cd += other.cd;
+            q.weight += other.weight;
+        }
+
+        // Weighted mean of the squared distances from "p" to the planes:
+        // a squared distance, whatever the areas.
+        double evaluate(const Quadric &q, const float *p) {
+            double x = p[0], y = p[1], z = p[2];
+            double result = q.a2 * x * x + q.b2 * y * y + q.c2 * z * z + q.d2 +
+                            2.0 * (q.ab * x * y + q.ac * x * z + q.ad * x + q.bc * y * z + q.bd * y + q.cd * z);
+            if (result <= 0.0 || q.weight <= 0.0) {
+                return 0.0;
+            }
+            return result / q.weight;
+        }
+
+        void triangleNormal(const float *a, const float *b, const float *c, double *normal) {
+            double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            double e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+            normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+            normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        }
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+
+            bool operator<(const Collapse &other) const { return cost < other.cost; }
+        };
+
+        // Whether moving "from" onto "to" turns any remaining triangle
+        // around "from" upside down.
+        bool flipsTriangles(const std::vector<float> &positions, const std::vector<uint32_t> &indices,
+                            const uint32_t *triangles, uint32_t triangleCount, uint32_t from, uint32_t to) {
+            for (uint32_t i = 0; i < triangleCount; i++) {
+                const uint32_t *triangle = &indices[triangles[i] * 3];
+                if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                    continue; // Collapses into a degenerate triangle.
+                }
+                const float *before[3];
+                const float *after[3];
+                for (int k = 0; k < 3; k++) {
+                    before[k] = &positions[triangle[k] * 3];
+                    after[k] = triangle[k] == from ? &positions[to * 3] : before[k];
+                }
+                double n0[3], n1[3];
+                triangleNormal(before[0], before[1], before[2], n0);
+                triangleNormal(after[0], after[1], after[2], n1);
+                if (n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Squared distance from "p" to triangle "a", "b", "c" (Ericson's
+        // "Real-Time Collision Detection", 5.1.5).
+        float distanceSquared(const float *pointer, const float *aPointer, const float *bPointer, const float *cPointer) {
+            glm::vec3 p(pointer[0], pointer[1], pointer[2]);
+            glm::vec3 a(aPointer[0], aPointer[1], aPointer[2]);
+            glm::vec3 b(bPointer[0], bPointer[1], bPointer[2]);
+            glm::vec3 c(cPointer[0], cPointer[1], cPointer[2]);
+            glm::vec3 ab = b - a, ac = c - a, ap = p - a, bp = p - b, cp = p - c;
+            float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+            float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+            float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+            float va = d3 * d6 - d5 * d4;
+            float vb = d5 * d2 - d1 * d6;
+            float vc = d1 * d4 - d3 * d2;
+
+            glm::vec3 closest;
+            if (d1 <= 0.0f && d2 <= 0.0f) {
+                closest = a;
+            } else if (d3 >= 0.0f && d4 <= d3) {
+                closest = b;
+            } else if (d6 >= 0.0f && d5 <= d6) {
+                closest = c;
+            } else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+                closest = a + ab * (d1 / (d1 - d3));
+            } else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+                closest = a + ac * (d2 / (d2 - d6));
+            } else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+                closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+            } else {
+                float denominator = 1.0f / (va + vb + vc);
+                closest = a + ab * (vb * denominator) + ac * (vc * denominator);
+            }
+            glm::vec3 offset = p - closest;
+            return glm::dot(offset, offset);
+        }
+
+        // The vertex among "candidates" (copies of one position) whose
+        // normal and texcoord are nearest those of "vertex".
+        uint32_t closestCopy(const MeshData &mesh, uint32_t vertex, const uint32_t *candidates, uint32_t count) {
+            uint32_t best = candidates[0];
+            float bestDistance = -1.0f;
+            for (uint32_t i = 0; i < count; i++) {
+                uint32_t candidate = candidates[i];
+                float distance = 0.0f;
+                if (!mesh.normals.empty()) {
+                    for (int k = 0; k < 3; k++) {
+                        float delta = mesh.normals[candidate * 3 + k] - mesh.normals[vertex * 3 + k];
+                        distance += delta * delta;
+                    }
+                }
+                if (!mesh.texcoords.empty()) {
+                    for (int k = 0; k < 2; k++) {
+                        float delta = mesh.texcoords[candidate * 2 + k] - mesh.texcoords[vertex * 2 + k];
+                        distance += delta * delta;
+                    }
+                }
+                if (bestDistance < 0.0f || distance < bestDistance) {
+                    best = candidate;
+                    bestDistance = distance;
+                }
+            }
+            return best;
+        }
+    }
+
+    VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, unsigned cacheSize) {
+        VertexCacheStatistics statistics = {0.0f, 0.0f};
+        if (indices.empty() || vertexCount == 0) {
+            return statistics;
+        }
+
+        // FIFO cache: a vertex is a hit if it was inserted in the last
+        // "cacheSize" misses.
+        std::vector<size_t> insertedAt(vertexCount, (size_t) -1);
+        size_t misses = 0;
+        for (size_t i = 0; i < indices.size(); i++) {
+            uint32_t v = indices[i];
+            if (insertedAt[v] == (size_t) -1 || misses - insertedAt[v] >= cacheSize) {
+                insertedAt[v] = misses;
+                misses++;
+            }
+        }
+
+        statistics.acmr = (float) misses / (float) (indices.size() / 3);
+        statistics.atvr = (float) misses / (float) vertexCount;
+        return statistics;
+    }
+
+    void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount) {
+        using namespace _internal;
+        initTables();
+
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // Triangle adjacency per vertex (CSR layout).
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        for (size_t i = 0; i < indices.size(); i++) {
+            remaining[indices[i]]++;
+        }
+        std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++) {
+            adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+        }
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+            for (size_t t = 0; t < triangleCount; t++) {
+                for (int k = 0; k < 3; k++) {
+                    adjacency[fill[indices[t * 3 + k]]++] = (uint32_t) t;
+                }
+            }
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> score(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            score[v] = vertexScore(-1, remaining[v]);
+        }
+
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        for (size_t t = 0; t < triangleCount; t++) {
+            triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+        }
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        // Cache with room for the 3 vertices pushed by each new triangle.
+        uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+        int cacheCount = 0;
+
+        size_t scanPosition = 0;
+        int64_t best = -1;
+        for (size_t t = 0; t < triangleCount; t++) {
+            if (best < 0 || triangleScore[best] < triangleScore[t]) {
+                best = (int64_t) t;
+            }
+        }
+
+        while (best >= 0) {
+            const uint32_t *triangle = &indices[best * 3];
+            output.insert(output.end(), triangle, triangle + 3);
+            emitted[best] = true;
+
+            // Move the triangle's vertices to the front of the cache.
+            uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+            int newCount = 0;
+            for (int k = 0; k < 3; k++) {
+                newCache[newCount++] = triangle[k];
+                remaining[triangle[k]]--;
+
+                // Detach the triangle from the vertex adjacency.
+                uint32_t *begin = &adjacency[adjacencyStart[triangle[k]]];
+                uint32_t *end = begin + remaining[triangle[k]] + 1;
+                for (uint32_t *a = begin; a < end; a++) {
+                    if (*a == (uint32_t) best) {
+                        *a = *(end - 1);
+                        break;
+                    }
+                }
+            }
+            for (int i = 0; i < cacheCount; i++) {
+                uint32_t v = cache[i];
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                    newCache[newCount++] = v;
+                }
+            }
+
+            // Rescore the vertices that were (or still are) in the cache
+            // and the triangles around them, remembering the best one.
+            best = -1;
+            float bestScore = -1.0f;
+            for (int i = 0; i < newCount; i++) {
+                uint32_t v = newCache[i];
+                cachePosition[v] = i < FORSYTH_CACHE_SIZE ? i : -1;
+                float newScore = vertexScore(cachePosition[v], remaining[v]);
+                float delta = newScore - score[v];
+                score[v] = newScore;
+
+                const uint32_t *begin = &adjacency[adjacencyStart[v]];
+                for (uint32_t a = 0; a < remaining[v]; a++) {
+                    uint32_t t = begin[a];
+                    triangleScore[t] += delta;
+                    if (triangleScore[t] > bestScore) {
+                        bestScore = triangleScore[t];
+                        best = t;
+                    }
+                }
+            }
+            cacheCount = newCount < FORSYTH_CACHE_SIZE ? newCount : FORSYTH_CACHE_SIZE;
+            for (int i = 0; i < cacheCount; i++) {
+                cache[i] = newCache[i];
+            }
+
+            if (best < 0) {
+                // Nothing adjacent to the cache: continue with the next
+                // triangle not emitted yet.
+                while (scanPosition < triangleCount && emitted[scanPosition]) {
+                    scanPosition++;
+                }
+                if (scanPosition < triangleCount) {
+                    best = (int64_t) scanPosition;
+                }
+            }
+        }
+
+        indices.swap(output);
+    }
+
+    void optimizeVertexFetch(MeshData &mesh) {
+        size_t vertexCount = mesh.vertexCount();
+        std::vector<uint32_t> remap(vertexCount, (uint32_t) -1);
+        uint32_t next = 0;
+        for (size_t i = 0; i < mesh.indices.size(); i++) {
+            uint32_t &index = mesh.indices[i];
+            if (remap[index] == (uint32_t) -1) {
+                remap[index] = next++;
+            }
+            index = remap[index];
+        }
+
+        MeshData reordered;
+        reordered.positions.resize(next * 3);
+        reordered.normals.resize(mesh.normals.empty() ? 0 : next * 3);
+        reordered.texcoords.resize(mesh.texcoords.empty() ? 0 : next * 2);
+        for (size_t v = 0; v < vertexCount; v++) {
+            uint32_t target = remap[v];
+            if (target == (uint32_t) -1) {
+                continue;
+            }
+            for (int k = 0; k < 3; k++) reordered.positions[target * 3 + k] = mesh.positions[v * 3 + k];
+            if (!mesh.normals.empty()) {
+                for (int k = 0; k < 3; k++) reordered.normals[target * 3 + k] = mesh.normals[v * 3 + k];
+            }
+            if (!mesh.texcoords.empty()) {
+                for (int k = 0; k < 2; k++) reordered.texcoords[target * 2 + k] = mesh.texcoords[v * 2 + k];
+            }
+        }
+
+        mesh.positions.swap(reordered.positions);
+        mesh.normals.swap(reordered.normals);
+        mesh.texcoords.swap(reordered.texcoords);
+    }
+
+    float simplify(const MeshData &mesh, const std::vector<uint32_t> &indices, size_t targetIndexCount,
+                   float targetError, std::vector<uint32_t> &result) {
+        using namespace _internal;
+
+        size_t vertexCount = mesh.vertexCount();
+        result = indices;
+        if (result.size() <= targetIndexCount || vertexCount == 0) {
+            return 0.0f;
+        }
+
+        // Work in coordinates where the largest extent is 1, so costs and
+        // "targetError" are comparable across meshes.
+        float extent = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            extent = std::max(extent, mesh.boundsMax[k] - mesh.boundsMin[k]);
+        }
+        float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+        std::vector<float> positions(mesh.positions.size());
+        for (size_t i = 0; i < positions.size(); i++) {
+            positions[i] = (mesh.positions[i] - mesh.boundsMin[i % 3]) * scale;
+        }
+
+        // Vertices split by a normal or texcoord seam share a position.
+        // Collapses work on positions ("canonical" vertices, the first one
+        // of each position), so hard edges and UV seams simplify like the
+        // rest of the surface; every copy of a position is listed in
+        // "copies" to pick the attributes afterwards.
+        std::vector<uint32_t> canonical(vertexCount);
+        std::vector<uint32_t> copiesStart(vertexCount + 1, 0);
+        std::vector<uint32_t> copies(vertexCount);
+        {
+            std::unordered_map<uint64_t, uint32_t> firstWithPosition;
+            firstWithPosition.reserve(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++) {
+                uint32_t bits[3];
+                memcpy(bits, &mesh.positions[v * 3], sizeof(bits));
+                uint64_t key = ((uint64_t) bits[0] * 73856093u) ^ ((uint64_t) bits[1] << 21) ^ ((uint64_t) bits[2] << 42) ^ bits[2];
+                std::pair<std::unordered_map<uint64_t, uint32_t>::iterator, bool> inserted = firstWithPosition.insert(std::make_pair(key, v));
+                uint32_t other = inserted.first->second;
+                canonical[v] = !inserted.second && memcmp(&mesh.positions[other * 3], &mesh.positions[v * 3], sizeof(bits)) == 0 ? other : v;
+                copiesStart[canonical[v] + 1]++;
+            }
+            for (size_t v = 0; v < vertexCount; v++) {
+                copiesStart[v + 1] += copiesStart[v];
+            }
+            std::vector<uint32_t> fill(copiesStart.begin(), copiesStart.end() - 1);
+            for (uint32_t v = 0; v < vertexCount; v++) {
+                copies[fill[canonical[v]]++] = v;
+            }
+        }
+
+        // Border edges have no twin running the other way; both of their
+        // vertices are locked.
+        std::vector<bool> locked(vertexCount, false);
+        {
+            std::unordered_map<uint64_t, uint32_t> edges;
+            edges.reserve(indices.size());
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                for (int k = 0; k < 3; k++) {
+                    uint64_t a = canonical[indices[i + k]], b = canonical[indices[i + (k + 1) % 3]];
+                    edges[(a << 32) | b]++;
+                }
+            }
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                for (int k = 0; k < 3; k++) {
+                    uint64_t a = canonical[indices[i + k]], b = canonical[indices[i + (k + 1) % 3]];
+                    if (edges.find((b << 32) | a) == edges.end()) {
+                        locked[a] = true;
+                        locked[b] = true;
+                    }
+                }
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const float *p[3] = {&positions[indices[i] * 3], &positions[indices[i + 1] * 3], &positions[indices[i + 2] * 3]};
+            double normal[3];
+            triangleNormal(p[0], p[1], p[2], normal);
+            double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            if (length == 0.0) {
+                continue;
+            }
+            double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+            double d = -(a * p[0][0] + b * p[0][1] + c * p[0][2]);
+            // Weighted by area, so slivers do not dominate.
+            double area = 0.5 * length;
+            for (int k = 0; k < 3; k++) {
+                addPlane(quadrics[canonical[indices[i + k]]], a, b, c, d, area);
+            }
+        }
+
+        double maxCost = (double) targetError * targetError;
+        double reachedCost = 0.0;
+        std::vector<uint32_t> welded(result.size());
+        std::vector<uint32_t> adjacencyStart(vertexCount + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<Collapse> collapses;
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        // Vertex each canonical vertex was collapsed into, over all passes
+        std::vector<uint32_t> representative(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            representative[v] = (uint32_t) v;
+        }
+
+        while (result.size() > targetIndexCount) {
+            size_t triangleCount = result.size() / 3;
+            welded.resize(result.size());
+            for (size_t i = 0; i < result.size(); i++) {
+                welded[i] = canonical[result[i]];
+            }
+
+            std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+            for (size_t i = 0; i < welded.size(); i++) {
+                adjacencyStart[welded[i] + 1]++;
+            }
+            for (size_t v = 0; v < vertexCount; v++) {
+                adjacencyStart[v + 1] += adjacencyStart[v];
+            }
+            adjacency.resize(welded.size());
+            {
+                std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+                for (size_t t = 0; t < triangleCount; t++) {
+                    for (int k = 0; k < 3; k++) {
+                        adjacency[fill[welded[t * 3 + k]]++] = (uint32_t) t;
+                    }
+                }
+            }
+
+            // Cheapest direction of every edge.
+            collapses.clear();
+            for (size_t i = 0; i < welded.size(); i += 3) {
+                for (int k = 0; k < 3; k++) {
+                    uint32_t a = welded[i + k], b = welded[i + (k + 1) % 3];
+                    if (locked[a] && locked[b]) {
+                        continue;
+                    }
+                    Quadric q = quadrics[a];
+                    addQuadric(q, quadrics[b]);
+                    Collapse collapse;
+                    collapse.cost = -1.0;
+                    if (!locked[a]) {
+                        collapse.from = a;
+                        collapse.to = b;
+                        collapse.cost = evaluate(q, &positions[b * 3]);
+                    }
+                    if (!locked[b]) {
+                        double cost = evaluate(q, &positions[a * 3]);
+                        if (collapse.cost < 0.0 || cost < collapse.cost) {
+                            collapse.from = b;
+                            collapse.to = a;
+                            collapse.cost = cost;
+                        }
+                    }
+                    if (collapse.cost <= maxCost) {
+                        collapses.push_back(collapse);
+                    }
+                }
+            }
+            std::sort(collapses.begin(), collapses.end());
+
+            // Apply the cheapest collapses that do not share a vertex, until
+            // roughly enough triangles are gone. A pass only goes a little
+            // past the cost of the collapses it needs (each removes about 2
+            // triangles), so cheap ones blocked by a neighbour come before
+            // expensive ones in the next pass. If nothing fits, the limit is
+            // lifted.
+            if (collapses.empty()) {
+                break;
+            }
+            size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+            size_t needed = std::min(collapses.size() - 1, trianglesToRemove / 2);
+            double passLimits[2] = {collapses[needed].cost * 1.5, maxCost};
+            size_t applied = 0;
+            for (int attempt = 0; attempt < 2 && applied == 0; attempt++) {
+                size_t removed = 0;
+                for (size_t v = 0; v < vertexCount; v++) {
+                    remap[v] = (uint32_t) v;
+                }
+                std::fill(touched.begin(), touched.end(), false);
+                for (size_t i = 0; i < collapses.size() && removed < trianglesToRemove; i++) {
+                    const Collapse &collapse = collapses[i];
+                    if (collapse.cost > passLimits[attempt]) {
+                        break;
+                    }
+                    if (touched[collapse.from] || touched[collapse.to]) {
+                        continue;
+                    }
+                    const uint32_t *triangles = &adjacency[adjacencyStart[collapse.from]];
+                    uint32_t count = adjacencyStart[collapse.from + 1] - adjacencyStart[collapse.from];
+                    if (flipsTriangles(positions, welded, triangles, count, collapse.from, collapse.to)) {
+                        continue;
+                    }
+                    for (uint32_t t = 0; t < count; t++) {
+                        const uint32_t *triangle = &welded[triangles[t] * 3];
+                        if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                            removed++;
+                        }
+                    }
+                    remap[collapse.from] = collapse.to;
+                    touched[collapse.from] = true;
+                    touched[collapse.to] = true;
+                    addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+                    reachedCost = std::max(reachedCost, collapse.cost);
+                    applied++;
+                }
+            }
+            if (applied == 0) {
+                break;
+            }
+            for (size_t v = 0; v < vertexCount; v++) {
+                representative[v] = remap[representative[v]];
+            }
+
+            // A corner that moved takes the copy of its new position whose
+            // normal and texcoord are closest to the ones it had.
+            size_t write = 0;
+            for (size_t i = 0; i < result.size(); i += 3) {
+                uint32_t moved[3];
+                for (int k = 0; k < 3; k++) {
+                    moved[k] = remap[welded[i + k]];
+                }
+                if (moved[0] == moved[1] || moved[1] == moved[2] || moved[2] == moved[0]) {
+                    continue;
+                }
+                for (int k = 0; k < 3; k++) {
+                    uint32_t vertex = result[i + k];
+                    if (moved[k] != welded[i + k]) {
+                        vertex = closestCopy(mesh, vertex, &copies[copiesStart[moved[k]]], copiesStart[moved[k] + 1] - copiesStart[moved[k]]);
+                    }
+                    result[write++] = vertex;
+                }
+            }
+            result.resize(write);
+        }
+
+        // The quadrics average over their planes, so they understate the
+        // largest deviation. The error reported is the larger of that and
+        // the distance from each removed vertex to the triangles now around
+        // its representative and their neighbors: close to the true one-sided Hausdorff
+        // distance, at the cost of a walk over the final mesh.
+        std::vector<uint32_t> finalStart(vertexCount + 1, 0);
+        for (size_t i = 0; i < result.size(); i++) {
+            finalStart[canonical[result[i]] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            finalStart[v + 1] += finalStart[v];
+        }
+        std::vector<uint32_t> finalTriangles(result.size());
+        {
+            std::vector<uint32_t> fill(finalStart.begin(), finalStart.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) {
+                finalTriangles[fill[canonical[result[i]]]++] = (uint32_t) (i / 3);
+            }
+        }
+        double measured = 0.0;
+        for (size_t v = 0; v < vertexCount; v++) {
+            uint32_t r = representative[v];
+            bool dropped = finalStart[r] == finalStart[r + 1];
+            if (canonical[v] != v || (r == v && !dropped)) {
+                continue;
+            }
+            float nearest = -1.0f;
+            if (dropped) {
+                // Every triangle around the vertex degenerated (thin parts
+                // collapse to a line): nothing is close by, test them all.
+                for (size_t i = 0; i < result.size(); i += 3) {
+                    float distance = distanceSquared(&positions[v * 3], &positions[result[i] * 3],
+                                                     &positions[result[i + 1] * 3], &positions[result[i + 2] * 3]);
+                    if (nearest < 0.0f || distance < nearest) {
+                        nearest = distance;
+                    }
+                }
+            }
+            // Triangles around the vertices around the representative
+            for (uint32_t i = finalStart[r]; i < finalStart[r + 1]; i++) {
+                for (int k = 0; k < 3; k++) {
+                    uint32_t neighbor = canonical[result[finalTriangles[i] * 3 + k]];
+                    for (uint32_t j = finalStart[neighbor]; j < finalStart[neighbor + 1]; j++) {
+                        const uint32_t *triangle = &result[finalTriangles[j] * 3];
+                        float distance = distanceSquared(&positions[v * 3], &positions[triangle[0] * 3],
+                                                         &positions[triangle[1] * 3], &positions[triangle[2] * 3]);
+                        if (nearest < 0.0f || distance < nearest) {
+                            nearest = distance;
+                        }
+                    }
+                }
+            }
+            measured = std::max(measured, (double) nearest);
+        }
+
+        return (float) sqrt(std::max(reachedCost, measured)) * extent;
+    }
+
+    void buildLodChain(const MeshData &mesh, std::vector<LodLevel> &lods, const char *name) {
+        // Coarsest level may move the surface by 5% of the mesh size.
+        const float MAX_LOD_ERROR = 0.05f;
+
+        lods.clear();
+        lods.push_back(LodLevel());
+        lods[0].indices = mesh.indices;
+        lods[0].error = 0.0f;
+
+        size_t target = mesh.indices.size();
+        while (lods.size() < (size_t) MAX_LOD_LEVELS) {
+            target = target / 6 * 3;
+            if (target == 0) {
+                break;
+            }
+
+            // Always simplified from the full mesh, so the error is measured
+            // against the original surface.
+            LodLevel level;
+            level.error = simplify(mesh, mesh.indices, target, MAX_LOD_ERROR, level.indices);
+            const LodLevel &previous = lods.back();
+            if (level.indices.size() * 5 > previous.indices.size() * 4) {
+                break; // Less than 20% smaller: not worth a level.
+            }
+            // Level selection expects the error to grow with the level.
+            level.error = std::max(level.error, previous.error);
+            optimizeVertexCache(level.indices, mesh.vertexCount());
+            lods.push_back(level);
+        }
+
+        printf("LODs of \"%s\":", name);
+        for (size_t i = 0; i < lods.size(); i++) {
+            printf(" %zu (%g)", lods[i].indices.size() / 3, lods[i].error);
+        }
+        printf("\n");
+    }
+
+    void optimize(MeshData &mesh, const char *name) {
+        VertexCacheStatistics before = analyzeVertexCache(mesh.indices, mesh.vertexCount());
+        optimizeVertexCache(mesh.indices, mesh.vertexCount());
+        optimizeVertexFetch(mesh);
+        VertexCacheStatistics after = analyzeVertexCache(mesh.indices, mesh.vertexCount());
+
+        printf("Optimized \"%s\": ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+               name, before.acmr, after.acmr, before.atvr, after.atvr);
+    }
+}
@@ -0,0 +1,212 @@
+#include "meshstreamer.h"
+
+#include <cstdio>
+
+#include "glm/vec3.hpp"
+#include "glm/geometric.hpp"
+
+namespace mesh {
+    namespace _internal {
+        // Main thread uploads per frame when there is no shared context.
+        const int FALLBACK_UPLOADS_PER_FRAME = 1;
+    }
+
+    void buildCpuData(const MeshFile &file, std::shared_ptr<collision::TriangleBvh> &bvh,
+                      std::shared_ptr<collision::OccluderMesh> &occluder) {
+        const MeshFileHeader &header = file.info();
+        std::vector<float> positions;
+        readPositions(file, positions);
+        const uint32_t *indices = (const uint32_t *) file.indexData();
+
+        const MeshLod &detailed = header.lods[0];
+        bvh.reset(new collision::TriangleBvh());
+        bvh->build(positions.data(), indices + detailed.firstIndex, detailed.indexCount / 3);
+
+        occluder.reset(new collision::OccluderMesh());
+        occluder->build(positions.data(), indices + detailed.firstIndex, detailed.indexCount / 3);
+    }
+
+    void MeshStreamer::start(GLFWwindow *mainWindow, const std::string &cacheDirectory, GeometryArena *arena) {
+        stop();
+        this->cacheDirectory = cacheDirectory;
+        this->arena = arena;
+
+        if (mainWindow != nullptr) {
+            // The hints of the main window (version, profile) still apply.
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            sharedContext = glfwCreateWindow(1, 1, "", nullptr, mainWindow);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        }
+        if (sharedContext == nullptr) {
+            fprintf(stderr, "WARNING: No shared context for streaming, meshes are uploaded by the main thread.\n");
+        }
+
+        running = true;
+        worker = std::thread(&MeshStreamer::run, this);
+    }
+
+    void MeshStreamer::stop() {
+        if (!running) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+            requests.clear();
+        }
+        wakeUp.notify_all();
+        worker.join();
+
+        for (size_t i = 0; i < finished.size(); i++) {
+            uploading.push_back(std::move(finished[i]));
+        }
+        finished.clear();
+        for (size_t i = 0; i < uploading.size(); i++) {
+            Result &result = *uploading[i];
+            if (result.fence != nullptr) {
+                glDeleteSync(result.fence);
+            }
+            glDeleteBuffers(1, &result.gpu.vertexBuffer);
+            glDeleteBuffers(1, &result.gpu.indexBuffer);
+        }
+        uploading.clear();
+
+        if (sharedContext != nullptr) {
+            glfwDestroyWindow(sharedContext);
+            sharedContext = nullptr;
+        }
+    }
+
+    int MeshStreamer::request(const std::string &sourcePath, const glm::vec4 &position) {
+        Request request;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            request.ticket = nextTicket++;
+            request.sourcePath = sourcePath;
+            request.position = position;
+            requests.push_back(request);
+        }
+        wakeUp.notify_one();
+        return request.ticket;
+    }
+
+    void MeshStreamer::setViewPosition(const glm::vec4 &position) {
+        std::lock_guard<std::mutex> lock(mutex);
+        viewPosition = position;
+    }
+
+    size_t MeshStreamer::pending() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return requests.size() + finished.size() + uploading.size();
+    }
+
+    void MeshStreamer::run() {
+        if (sharedContext != nullptr) {
+            glfwMakeContextCurrent(sharedContext);
+        }
+
+        for (;;) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (running && requests.empty()) {
+                    wakeUp.wait(lock);
+                }
+                if (!running) {
+                    break;
+                }
+
+                // Few requests are queued at once: a linear scan keeps the
+                // order right as the camera moves.
+                size_t nearest = 0;
+                float nearestDistance = 0.0f;
+                for (size_t i = 0; i < requests.size(); i++) {
+                    float distance = glm::length(glm::vec3(requests[i].position - viewPosition));
+                    if (i == 0 || distance < nearestDistance) {
+                        nearest = i;
+                        nearestDistance = distance;
+                    }
+                }
+                request = requests[nearest];
+                requests.erase(requests.begin() + nearest);
+            }
+
+            std::unique_ptr<Result> result(new Result());
+            result->ticket = request.ticket;
+            result->fence = nullptr;
+            std::unique_ptr<MeshFile> file(new MeshFile());
+            result->loaded = loadCached(request.sourcePath, cacheDirectory, *file);
+            if (!result->loaded) {
+                fprintf(stderr, "ERROR: Cannot stream \"%s\".\n", request.sourcePath.c_str());
+            } else if (sharedContext != nullptr) {
+                result->gpu = uploadBuffers(*file);
+                result->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                // The fence must reach the GPU before the main context waits
+                // on it.
+                glFlush();
+                // Built while the copy runs.
+                buildCpuData(*file, result->bvh, result->occluder);
+            } else {
+                buildCpuData(*file, result->bvh, result->occluder);
+                result->file = std::move(file);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(std::move(result));
+        }
+
+        if (sharedContext != nullptr) {
+            glfwMakeContextCurrent(nullptr);
+        }
+    }
+
+    void MeshStreamer::update(std::vector<StreamedMesh> &ready) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < finished.size(); i++) {
+                uploading.push_back(std::move(finished[i]));
+            }
+            finished.clear();
+        }
+
+        int uploads = 0;
+        for (size_t i = 0; i < uploading.size();) {
+            Result &result = *uploading[i];
+            if (result.loaded) {
+                if (result.file) {
+                    if (uploads == _internal::FALLBACK_UPLOADS_PER_FRAME) {
+                        i++;
+                        continue;
+                    }
+                    if (arena == nullptr || !arena->upload(*result.file, result.gpu)) {
+                        result.gpu = uploadBuffers(*result.file);
+                    }
+                    result.file.reset();
+                    uploads++;
+                } else {
+                    GLenum status = glClientWaitSync(result.fence, 0, 0);
+                    if (status == GL_TIMEOUT_EXPIRED) {
+                        i++;
+                        continue;
+                    }
+                    glDeleteSync(result.fence);
+                    result.fence = nullptr;
+                }
+                // Binding the buffers here also makes the other context's
+                // writes visible to this one.
+                if (!result.gpu.inArena && (arena == nullptr || !arena->adopt(result.gpu))) {
+                    createVertexArray(result.gpu);
+                }
+            }
+
+            StreamedMesh mesh;
+            mesh.ticket = result.ticket;
+            mesh.loaded = result.loaded;
+            mesh.gpu = result.gpu;
+            mesh.bvh = result.bvh;
+            mesh.occluder = result.occluder;
+            ready.push_back(mesh);
+            uploading.erase(uploading.begin() + i);
+        }
+    }
+}
@@ -0,0 +1,467 @@
+#include "objloader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#include "parallel.h"
+#include "platform.h"
+#include "tiny_obj_loader.h"
+
+namespace mesh {
+    namespace _internal {
+        const int32_t ABSENT = std::numeric_limits<int32_t>::min();
+
+        // One triangle corner. Indices are 0-based; negative (relative) OBJ
+        // indices are stored relative to the start of the chunk and flagged
+        // in "relative" until the chunk offsets are known.
+        struct Corner {
+            int32_t v, t, n;
+            uint8_t relative;
+        };
+
+        struct Chunk {
+            std::vector<float> positions;
+            std::vector<float> texcoords;
+            std::vector<float> normals;
+            std::vector<Corner> corners;
+            bool hasRelative = false;
+            bool error = false;
+        };
+
+        inline bool isSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        inline const char *skipSpaces(const char *p, const char *end) {
+            while (p < end && isSpace(*p)) p++;
+            return p;
+        }
+
+        inline const char *skipLine(const char *p, const char *end) {
+            const char *newline = (const char *) memchr(p, '\n', end - p);
+            return newline ? newline + 1 : end;
+        }
+
+        // Locale-independent float parser for the subset of the syntax
+        // found in OBJ files: [+-]digits[.digits][(e|E)[+-]digits].
+        inline const char *parseFloat(const char *p, const char *end, float &value) {
+            static const double POWERS[] = {
+                    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+            };
+
+            p = skipSpaces(p, end);
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negative = *p == '-';
+                p++;
+            }
+
+            uint64_t mantissa = 0;
+            int exponent = 0;
+            int digits = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; p++) {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    digits += mantissa != 0;
+                } else {
+                    exponent++;
+                }
+            }
+            if (p < end && *p == '.') {
+                p++;
+                for (; p < end && *p >= '0' && *p <= '9'; p++) {
+                    if (digits < 19) {
+                        mantissa = mantissa * 10 + (*p - '0');
+                        digits += mantissa != 0;
+                        exponent--;
+                    }
+                }
+            }
+            if (p < end && (*p == 'e' || *p == 'E')) {
+                p++;
+                bool negativeExponent = false;
+                if (p < end && (*p == '-' || *p == '+')) {
+                    negativeExponent = *p == '-';
+                    p++;
+                }
+                int e = 0;
+                for (; p < end && *p >= '0' && *p <= '9'; p++) {
+                    if (e < 1000) e = e * 10 + (*p - '0');
+                }
+                exponent += negativeExponent ? -e : e;
+            }
+
+            double result = (double) mantissa;
+            while (exponent > 22) { result *= 1e22; exponent -= 22; }
+            while (exponent < -22) { result /= 1e22; exponent += 22; }
+            result = exponent >= 0 ? result * POWERS[exponent] : result / POWERS[-exponent];
+            value = (float) (negative ? -result : result);
+            return p;
+        }
+
+        inline const char *parseInt(const char *p, const char *end, int32_t &value, bool &ok) {
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negative = *p == '-';
+                p++;
+            }
+            const char *start = p;
+            int64_t result = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; p++) {
+                result = result * 10 + (*p - '0');
+            }
+            ok = p != start && result <= std::numeric_limits<int32_t>::max();
+            value = (int32_t) (negative ? -result : result);
+            return p;
+        }
+
+        // Turns a 1-based (or negative, relative) OBJ index into a 0-based
+        // one. Returns true if the result is relative to the chunk start.
+        inline bool resolveIndex(int32_t raw, size_t localCount, int32_t &index) {
+            if (raw > 0) {
+                index = raw - 1;
+                return false;
+            }
+            index = (int32_t) localCount + raw;
+            return true;
+        }
+
+        // Parses one "f" statement into a triangle fan, emitted as the
+        // corners are read: only the first and the previous corner are
+        // kept, so faces may have any number of corners.
+        const char *parseFace(const char *p, const char *end, Chunk &chunk) {
+            const size_t faceStart = chunk.corners.size();
+            Corner first = {ABSENT, ABSENT, ABSENT, 0};
+            Corner previous = first;
+            int count = 0;
+
+            while (true) {
+                p = skipSpaces(p, end);
+                if (p >= end || *p == '\n' || *p == '#') {
+                    break;
+                }
+
+                Corner corner = {ABSENT, ABSENT, ABSENT, 0};
+                int32_t raw;
+                bool ok;
+                p = parseInt(p, end, raw, ok);
+                if (!ok || raw == 0) {
+                    // The whole face is dropped, with the triangles already
+                    // emitted for it.
+                    chunk.corners.resize(faceStart);
+                    chunk.error = true;
+                    // Up to the newline: the caller skips the rest of the
+                    // line.
+                    const char *newline = (const char *) memchr(p, '\n', end - p);
+                    return newline ? newline : end;
+                }
+                if (resolveIndex(raw, chunk.positions.size() / 3, corner.v)) corner.relative |= 1;
+
+                if (p < end && *p == '/') {
+                    p++;
+                    if (p < end && *p != '/') {
+                        p = parseInt(p, end, raw, ok);
+                        if (ok && raw != 0 && resolveIndex(raw, chunk.texcoords.size() / 2, corner.t)) corner.relative |= 2;
+                    }
+                    if (p < end && *p == '/') {
+                        p++;
+                        p = parseInt(p, end, raw, ok);
+                        if (ok && raw != 0 && resolveIndex(raw, chunk.normals.size() / 3, corner.n)) corner.relative |= 4;
+                    }
+                }
+
+                chunk.hasRelative |= corner.relative != 0;
+                if (count == 0) {
+                    first = corner;
+                } else if (count >= 2) {
+                    chunk.corners.push_back(first);
+                    chunk.corners.push_back(previous);
+                    chunk.corners.push_back(corner);
+                }
+                previous = corner;
+                count++;
+            }
+            return p;
+        }
+
+        void parseChunk(const char *p, const char *end, Chunk &chunk) {
+            // Rough guess from the average size of a line; avoids most
+            // reallocations on large files.
+            size_t expectedLines = (end - p) / 32;
+            chunk.positions.reserve(expectedLines * 3 / 2);
+            chunk.corners.reserve(expectedLines * 3 / 2);
+
+            while (p < end) {
+                p = skipSpaces(p, end);
+                if (p >= end) break;
+
+                if (p[0] == 'v' && p + 1 < end) {
+                    if (isSpace(p[1])) {
+                        float x, y, z;
+                        p = parseFloat(p + 2, end, x);
+                        p = parseFloat(p, end, y);
+                        p = parseFloat(p, end, z);
+                        chunk.positions.push_back(x);
+                        chunk.positions.push_back(y);
+                        chunk.positions.push_back(z);
+                    } else if (p[1] == 't' && p + 2 < end && isSpace(p[2])) {
+                        float u, v;
+                        p = parseFloat(p + 3, end, u);
+                        p = parseFloat(p, end, v);
+                        chunk.texcoords.push_back(u);
+                        chunk.texcoords.push_back(v);
+                    } else if (p[1] == 'n' && p + 2 < end && isSpace(p[2])) {
+                        float x, y, z;
+                        p = parseFloat(p + 3, end, x);
+                        p = parseFloat(p, end, y);
+                        p = parseFloat(p, end, z);
+                        chunk.normals.push_back(x);
+                        chunk.normals.push_back(y);
+                        chunk.normals.push_back(z);
+                    }
+                } else if (p[0] == 'f' && p + 1 < end && isSpace(p[1])) {
+                    p = parseFace(p + 2, end, chunk);
+                }
+
+                // Whatever is left (comments, o/g/s/usemtl, extra
+                // components such as w) is ignored.
+                p = skipLine(p, end);
+            }
+        }
+
+        struct CornerKey {
+            int32_t v, t, n;
+            bool operator==(const CornerKey &other) const {
+                return v == other.v && t == other.t && n == other.n;
+            }
+        };
+
+        struct CornerKeyHash {
+            size_t operator()(const CornerKey &key) const {
+                uint64_t h = (uint32_t) key.v;
+                h = h * 0x9E3779B97F4A7C15ULL ^ (uint32_t) key.t;
+                h = h * 0x9E3779B97F4A7C15ULL ^ (uint32_t) key.n;
+                return (size_t) (h ^ (h >> 29));
+            }
+        };
+
+        template<typename T>
+        void append(std::vector<T> &destination, const std::vector<T> &source) {
+            destination.insert(destination.end(), source.begin(), source.end());
+        }
+    }
+
+    void MeshData::computeBounds() {
+        for (int axis = 0; axis < 3; axis++) {
+            boundsMin[axis] = positions.empty() ? 0.0f : std::numeric_limits<float>::max();
+            boundsMax[axis] = positions.empty() ? 0.0f : -std::numeric_limits<float>::max();
+        }
+        for (size_t i = 0; i < positions.size(); i += 3) {
+            for (int axis = 0; axis < 3; axis++) {
+                boundsMin[axis] = std::min(boundsMin[axis], positions[i + axis]);
+                boundsMax[axis] = std::max(boundsMax[axis], positions[i + axis]);
+            }
+        }
+    }
+
+    bool parseObj(const char *data, size_t count, MeshData &mesh, unsigned threads) {
+        using namespace _internal;
+
+        if (threads == 0) {
+            threads = parallel::threadCount();
+        }
+        // Chunks smaller than this are not worth a thread.
+        const size_t MIN_CHUNK = 256 * 1024;
+        size_t chunkCount = std::max((size_t) 1, std::min((size_t) threads, count / MIN_CHUNK));
+
+        // Chunk boundaries are moved forward to the start of the next line.
+        std::vector<size_t> starts(chunkCount + 1, count);
+        starts[0] = 0;
+        for (size_t i = 1; i < chunkCount; i++) {
+            size_t offset = count * i / chunkCount;
+            const char *newline = (const char *) memchr(data + offset, '\n', count - offset);
+            starts[i] = newline ? (size_t) (newline - data) + 1 : count;
+        }
+
+        std::vector<Chunk> chunks(chunkCount);
+        parallel::forChunks(chunkCount, (unsigned) chunkCount, [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                parseChunk(data + starts[i], data + std::max(starts[i], starts[i + 1]), chunks[i]);
+            }
+        });
+
+        // Absolute and relative indices become global.
+        size_t vBase = 0, tBase = 0, nBase = 0;
+        size_t cornerCount = 0;
+        bool error = false;
+        for (size_t i = 0; i < chunkCount; i++) {
+            Chunk &chunk = chunks[i];
+            error |= chunk.error;
+            if (chunk.hasRelative) {
+                for (size_t c = 0; c < chunk.corners.size(); c++) {
+                    Corner &corner = chunk.corners[c];
+                    if (corner.relative & 1) corner.v += (int32_t) vBase;
+                    if (corner.relative & 2) corner.t += (int32_t) tBase;
+                    if (corner.relative & 4) corner.n += (int32_t) nBase;
+                }
+            }
+            vBase += chunk.positions.size() / 3;
+            tBase += chunk.texcoords.size() / 2;
+            nBase += chunk.normals.size() / 3;
+            cornerCount += chunk.corners.size();
+        }
+        if (error) {
+            fprintf(stderr, "WARNING: Malformed face statements were skipped.\n");
+        }
+
+        std::vector<float> positions, texcoords, normals;
+        positions.reserve(vBase * 3);
+        texcoords.reserve(tBase * 2);
+        normals.reserve(nBase * 3);
+        for (size_t i = 0; i < chunkCount; i++) {
+            append(positions, chunks[i].positions);
+            append(texcoords, chunks[i].texcoords);
+            append(normals, chunks[i].normals);
+            std::vector<float>().swap(chunks[i].positions);
+            std::vector<float>().swap(chunks[i].texcoords);
+            std::vector<float>().swap(chunks[i].normals);
+        }
+
+        mesh = MeshData();
+        mesh.indices.reserve(cornerCount);
+
+        bool useTexcoords = !texcoords.empty();
+        bool useNormals = !normals.empty();
+
+        auto valid = [](int32_t index, size_t size) {
+            return index >= 0 && (size_t) index < size;
+        };
+
+        if (!useTexcoords && !useNormals) {
+            // Positions only: OBJ indices are already the final indices.
+            mesh.positions.swap(positions);
+            for (size_t i = 0; i < chunkCount; i++) {
+                for (size_t c = 0; c < chunks[i].corners.size(); c += 3) {
+                    const Corner *triangle = &chunks[i].corners[c];
+                    if (valid(triangle[0].v, vBase) && valid(triangle[1].v, vBase) && valid(triangle[2].v, vBase)) {
+                        mesh.indices.push_back((uint32_t) triangle[0].v);
+                        mesh.indices.push_back((uint32_t) triangle[1].v);
+                        mesh.indices.push_back((uint32_t) triangle[2].v);
+                    }
+                }
+            }
+            mesh.computeBounds();
+            return true;
+        }
+
+        std::unordered_map<CornerKey, uint32_t, CornerKeyHash> unique;
+        unique.reserve(vBase * 2);
+        mesh.positions.reserve(vBase * 3);
+        if (useTexcoords) mesh.texcoords.reserve(vBase * 2);
+        if (useNormals) mesh.normals.reserve(vBase * 3);
+
+        for (size_t i = 0; i < chunkCount; i++) {
+            const std::vector<Corner> &corners = chunks[i].corners;
+            for (size_t c = 0; c < corners.size(); c += 3) {
+                if (!valid(corners[c].v, vBase) || !valid(corners[c + 1].v, vBase) || !valid(corners[c + 2].v, vBase)) {
+                    continue;
+                }
+                for (int k = 0; k < 3; k++) {
+                    const Corner &corner = corners[c + k];
+                    CornerKey key = {corner.v,
+                                     valid(corner.t, tBase) ? corner.t : ABSENT,
+                                     valid(corner.n, nBase) ? corner.n : ABSENT};
+
+                    std::pair<std::unordered_map<CornerKey, uint32_t, CornerKeyHash>::iterator, bool> inserted =
+                            unique.insert(std::make_pair(key, (uint32_t) mesh.vertexCount()));
+                    if (inserted.second) {
+                        mesh.positions.insert(mesh.positions.end(), &positions[key.v * 3], &positions[key.v * 3] + 3);
+                        if (useTexcoords) {
+                            if (key.t != ABSENT) {
+                                mesh.texcoords.insert(mesh.texcoords.end(), &texcoords[key.t * 2], &texcoords[key.t * 2] + 2);
+                            } else {
+                                mesh.texcoords.insert(mesh.texcoords.end(), 2, 0.0f);
+                            }
+                        }
+                        if (useNormals) {
+                            if (key.n != ABSENT) {
+                                mesh.normals.insert(mesh.normals.end(), &normals[key.n * 3], &normals[key.n * 3] + 3);
+                            } else {
+                                mesh.normals.insert(mesh.normals.end(), 3, 0.0f);
+                            }
+                        }
+                    }
+                    mesh.indices.push_back(inserted.first->second);
+                }
+            }
+        }
+
+        mesh.computeBounds();
+        return true;
+    }
+
+    bool loadObj(const std::string &path, MeshData &mesh, unsigned threads) {
+        platform::MappedFile file;
+        if (!file.open(path)) {
+            fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", path.c_str());
+            return false;
+        }
+        return parseObj(file.data(), file.size(), mesh, threads);
+    }
+
+    void benchmarkObjLoaders(const std::string &directory) {
+        typedef std::chrono::steady_clock Clock;
+        const int RUNS = 3;
+
+        std::vector<std::string> files = platform::listFiles(directory, ".obj");
+        printf("%-36s %9s %12s %12s %12s %8s\n", "file", "size", "tinyobj", "mmap x1", "mmap xN", "speedup");
+
+        for (size_t f = 0; f < files.size(); f++) {
+            const std::string &path = files[f];
+            double best[3] = {1e30, 1e30, 1e30};
+            size_t triangles[3] = {0, 0, 0};
+            size_t bytes = 0;
+
+            for (int run = 0; run < RUNS; run++) {
+                {
+                    tinyobj::attrib_t attrib;
+                    std::vector<tinyobj::shape_t> shapes;
+                    std::vector<tinyobj::material_t> materials;
+                    std::string warn, err;
+                    Clock::time_point start = Clock::now();
+                    tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), directory.c_str(), true);
+                    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+                    best[0] = std::min(best[0], elapsed);
+                    triangles[0] = 0;
+                    for (size_t s = 0; s < shapes.size(); s++) {
+                        triangles[0] += shapes[s].mesh.indices.size() / 3;
+                    }
+                }
+
+                unsigned threadCounts[2] = {1, parallel::threadCount()};
+                for (int variant = 0; variant < 2; variant++) {
+                    MeshData mesh;
+                    Clock::time_point start = Clock::now();
+                    platform::MappedFile file;
+                    if (!file.open(path)) break;
+                    bytes = file.size();
+                    parseObj(file.data(), file.size(), mesh, threadCounts[variant]);
+                    file.close();
+                    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+                    best[1 + variant] = std::min(best[1 + variant], elapsed);
+                    triangles[1 + variant] = mesh.triangleCount();
+                }
+            }
+
+            std::string name = path.substr(path.find_last_of("/\\") + 1);
+            printf("%-36s %7.2fMB %10.2fms %10.2fms %10.2fms %7.1fx%s\n", name.c_str(), bytes / 1e6,
+                   best[0] * 1e3, best[1] * 1e3, best[2] * 1e3, best[0] / best[2],
+                   (triangles[0] == triangles[1] && triangles[1] == triangles[2]) ? "" : "  (triangle count mismatch)");
+        }
+        printf("(best of %d runs, %u threads)\n", RUNS, parallel::threadCount());
+    }
+}
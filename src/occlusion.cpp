@@ -0,0 +1,573 @@
+#include "occlusion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <unordered_map>
+
+#include "glm/vec3.hpp"
+#include "glm/geometric.hpp"
+
+#include "matrices.h"
+#include "parallel.h"
+#include "platform.h"
+#include "simd.h"
+
+namespace collision {
+    namespace _internal {
+        const uint32_t FULL_ROW = 0xFFFFFFFFu;
+
+        // Coverage of one tile: bit x of rows[y] is set when the center of
+        // pixel (x0 + x, y0 + y) is inside the three edges.
+        void tileCoverageScalar(const TriangleSetup &t, float x0, float y0, uint32_t *rows) {
+            for (int y = 0; y < OcclusionBuffer::TILE_HEIGHT; y++) {
+                float py = y0 + y;
+                uint32_t bits = 0;
+                for (int x = 0; x < OcclusionBuffer::TILE_WIDTH; x++) {
+                    float px = x0 + x;
+                    bool inside = true;
+                    for (int e = 0; e < 3; e++) {
+                        inside = inside && t.edgeA[e] * px + t.edgeB[e] * py + t.edgeC[e] >= 0.0f;
+                    }
+                    bits |= (uint32_t) inside << x;
+                }
+                rows[y] = bits;
+            }
+        }
+
+#ifdef SIMD_X86
+        TARGET_SSE
+        void tileCoverageSse(const TriangleSetup &t, float x0, float y0, uint32_t *rows) {
+            const __m128 offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+            __m128 a[3], c[3];
+            for (int e = 0; e < 3; e++) {
+                a[e] = _mm_set1_ps(t.edgeA[e]);
+                c[e] = _mm_set1_ps(t.edgeC[e]);
+            }
+            for (int y = 0; y < OcclusionBuffer::TILE_HEIGHT; y++) {
+                float py = y0 + y;
+                __m128 by[3];
+                for (int e = 0; e < 3; e++) {
+                    by[e] = _mm_set1_ps(t.edgeB[e] * py);
+                }
+                uint32_t bits = 0;
+                for (int x = 0; x < OcclusionBuffer::TILE_WIDTH; x += 4) {
+                    __m128 px = _mm_add_ps(_mm_set1_ps(x0 + x), offsets);
+                    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                    for (int e = 0; e < 3; e++) {
+                        __m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[e], px), by[e]), c[e]);
+                        inside = _mm_and_ps(inside, _mm_cmpge_ps(value, _mm_setzero_ps()));
+                    }
+                    bits |= (uint32_t) _mm_movemask_ps(inside) << x;
+                }
+                rows[y] = bits;
+            }
+        }
+
+        // True when any of "count" depths is at or behind "depth".
+        TARGET_SSE
+        bool anyAtOrBehind(const float *depths, int count, float depth) {
+            __m128 limit = _mm_set1_ps(depth);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(depths + i), limit)) != 0) {
+                    return true;
+                }
+            }
+            for (; i < count; i++) {
+                if (depths[i] <= depth) {
+                    return true;
+                }
+            }
+            return false;
+        }
+#else
+        bool anyAtOrBehind(const float *depths, int count, float depth) {
+            for (int i = 0; i < count; i++) {
+                if (depths[i] <= depth) {
+                    return true;
+                }
+            }
+            return false;
+        }
+#endif
+
+        inline void tileCoverage(const TriangleSetup &t, float x0, float y0, uint32_t *rows) {
+#ifdef SIMD_X86
+            tileCoverageSse(t, x0, y0, rows);
+#else
+            tileCoverageScalar(t, x0, y0, rows);
+#endif
+        }
+
+        bool setupTriangle(const glm::vec4 &v0, const glm::vec4 &v1, const glm::vec4 &v2,
+                           int width, int height, TriangleSetup &setup) {
+            const glm::vec4 *clip[3] = {&v0, &v1, &v2};
+            float x[3], y[3], depth[3];
+            for (int i = 0; i < 3; i++) {
+                const glm::vec4 &v = *clip[i];
+                // Occluders are only drawn where they surely are: triangles
+                // crossing the near plane are dropped instead of clipped.
+                if (v.w <= 0.0f || v.z < -v.w) {
+                    return false;
+                }
+                x[i] = (v.x / v.w * 0.5f + 0.5f) * width;
+                y[i] = (v.y / v.w * 0.5f + 0.5f) * height;
+                depth[i] = (v.w - v.z) / v.w;
+            }
+
+            float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+            if (!(std::fabs(area) > 1e-6f)) {
+                return false;
+            }
+            if (area < 0.0f) {
+                std::swap(x[1], x[2]);
+                std::swap(y[1], y[2]);
+                std::swap(depth[1], depth[2]);
+                area = -area;
+            }
+
+            float minX = std::max(std::min(std::min(x[0], x[1]), x[2]), 0.0f);
+            float maxX = std::min(std::max(std::max(x[0], x[1]), x[2]), width - 1.0f);
+            float minY = std::max(std::min(std::min(y[0], y[1]), y[2]), 0.0f);
+            float maxY = std::min(std::max(std::max(y[0], y[1]), y[2]), height - 1.0f);
+            if (minX > maxX || minY > maxY) {
+                return false;
+            }
+            setup.minX = (int) minX;
+            setup.maxX = (int) maxX;
+            setup.minY = (int) minY;
+            setup.maxY = (int) maxY;
+
+            for (int e = 0; e < 3; e++) {
+                int next = (e + 1) % 3;
+                setup.edgeA[e] = y[e] - y[next];
+                setup.edgeB[e] = x[next] - x[e];
+                setup.edgeC[e] = x[e] * y[next] - x[next] * y[e];
+            }
+
+            // Depth is affine in screen space.
+            setup.depthA = ((depth[1] - depth[0]) * (y[2] - y[0]) - (depth[2] - depth[0]) * (y[1] - y[0])) / area;
+            setup.depthB = ((depth[2] - depth[0]) * (x[1] - x[0]) - (depth[1] - depth[0]) * (x[2] - x[0])) / area;
+            setup.depthC = depth[0] - setup.depthA * x[0] - setup.depthB * y[0];
+            setup.depthMin = std::min(std::min(depth[0], depth[1]), depth[2]);
+            return true;
+        }
+    }
+
+    void OccluderMesh::build(const float *positions, const uint32_t *indices, size_t triangleCount,
+                             size_t maxTriangles) {
+        std::vector<uint32_t> kept(triangleCount);
+        for (size_t t = 0; t < triangleCount; t++) {
+            kept[t] = (uint32_t) t;
+        }
+        if (triangleCount > maxTriangles) {
+            std::vector<float> areas(triangleCount);
+            for (size_t t = 0; t < triangleCount; t++) {
+                const float *a = &positions[indices[t * 3] * 3];
+                const float *b = &positions[indices[t * 3 + 1] * 3];
+                const float *c = &positions[indices[t * 3 + 2] * 3];
+                glm::vec3 normal = glm::cross(glm::vec3(b[0] - a[0], b[1] - a[1], b[2] - a[2]),
+                                              glm::vec3(c[0] - a[0], c[1] - a[1], c[2] - a[2]));
+                areas[t] = glm::dot(normal, normal);
+            }
+            std::nth_element(kept.begin(), kept.begin() + maxTriangles, kept.end(), [&](uint32_t a, uint32_t b) {
+                return areas[a] > areas[b] || (areas[a] == areas[b] && a < b);
+            });
+            kept.resize(maxTriangles);
+            std::sort(kept.begin(), kept.end());
+        }
+
+        std::unordered_map<uint32_t, uint32_t> remap;
+        this->positions.clear();
+        this->indices.resize(kept.size() * 3);
+        for (size_t i = 0; i < kept.size() * 3; i++) {
+            uint32_t index = indices[kept[i / 3] * 3 + i % 3];
+            std::pair<std::unordered_map<uint32_t, uint32_t>::iterator, bool> inserted =
+                remap.insert(std::make_pair(index, (uint32_t) remap.size()));
+            if (inserted.second) {
+                for (int k = 0; k < 3; k++) {
+                    this->positions.push_back(positions[index * 3 + k]);
+                }
+            }
+            this->indices[i] = inserted.first->second;
+        }
+    }
+
+    // Definitions for the uses by reference (std::min(), std::max()).
+    const int OcclusionBuffer::TILE_WIDTH;
+    const int OcclusionBuffer::TILE_HEIGHT;
+
+    OcclusionBuffer::OcclusionBuffer(int width, int height)
+        : tilesX((width + TILE_WIDTH - 1) / TILE_WIDTH), tilesY((height + TILE_HEIGHT - 1) / TILE_HEIGHT),
+          viewProjection(1.0f) {
+        reference.assign(tilesX * tilesY, 0.0f);
+        working.assign(tilesX * tilesY, std::numeric_limits<float>::max());
+        masks.assign(tilesX * tilesY * TILE_HEIGHT, 0);
+    }
+
+    void OcclusionBuffer::begin(const glm::mat4 &viewProjection) {
+        this->viewProjection = viewProjection;
+        triangles.clear();
+        // Nothing is hidden behind the far plane.
+        std::fill(reference.begin(), reference.end(), 0.0f);
+        std::fill(working.begin(), working.end(), std::numeric_limits<float>::max());
+        std::fill(masks.begin(), masks.end(), 0);
+        stats = Statistics();
+    }
+
+    void OcclusionBuffer::addOccluder(const OccluderMesh &occluder, const glm::mat4 &model) {
+        addOccluder(occluder.positions.data(), occluder.indices.data(), occluder.indices.size() / 3, model);
+    }
+
+    void OcclusionBuffer::addOccluder(const float *positions, const uint32_t *indices, size_t triangleCount, const glm::mat4 &model) {
+        glm::mat4 transform = viewProjection * model;
+        uint32_t vertexCount = 0;
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            vertexCount = std::max(vertexCount, indices[i] + 1);
+        }
+        clipPositions.resize(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            clipPositions[v] = transform * glm::vec4(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2], 1.0f);
+        }
+
+        stats.triangles += triangleCount;
+        _internal::TriangleSetup setup;
+        for (size_t t = 0; t < triangleCount; t++) {
+            const uint32_t *corners = &indices[t * 3];
+            if (_internal::setupTriangle(clipPositions[corners[0]], clipPositions[corners[1]], clipPositions[corners[2]],
+                                         width(), height(), setup)) {
+                triangles.push_back(setup);
+            } else {
+                stats.trianglesDropped++;
+            }
+        }
+    }
+
+    void OcclusionBuffer::updateTile(int tile, const uint32_t *coverage, float depth) {
+        uint32_t *rows = &masks[tile * TILE_HEIGHT];
+        bool full = true;
+        for (int y = 0; y < TILE_HEIGHT; y++) {
+            full = full && coverage[y] == _internal::FULL_ROW;
+        }
+        if (full) {
+            // The triangle alone hides everything behind it. The working
+            // layer stays, unless it is no longer in front of the reference.
+            reference[tile] = depth;
+            if (working[tile] <= depth) {
+                working[tile] = std::numeric_limits<float>::max();
+                std::fill(rows, rows + TILE_HEIGHT, 0);
+            }
+            return;
+        }
+
+        working[tile] = std::min(working[tile], depth);
+        full = true;
+        for (int y = 0; y < TILE_HEIGHT; y++) {
+            rows[y] |= coverage[y];
+            full = full && rows[y] == _internal::FULL_ROW;
+        }
+        if (full) {
+            reference[tile] = working[tile];
+            working[tile] = std::numeric_limits<float>::max();
+            std::fill(rows, rows + TILE_HEIGHT, 0);
+        }
+    }
+
+    void OcclusionBuffer::rasterizeBand(int tileRowBegin, int tileRowEnd, size_t &tileUpdates) {
+        for (size_t i = 0; i < triangles.size(); i++) {
+            const _internal::TriangleSetup &t = triangles[i];
+            int rowBegin = std::max(tileRowBegin, t.minY / TILE_HEIGHT);
+            int rowEnd = std::min(tileRowEnd, t.maxY / TILE_HEIGHT + 1);
+            int columnBegin = t.minX / TILE_WIDTH;
+            int columnEnd = t.maxX / TILE_WIDTH + 1;
+
+            for (int ty = rowBegin; ty < rowEnd; ty++) {
+                // Pixel centers at the corners of the tiles
+                float y0 = ty * TILE_HEIGHT + 0.5f;
+                float y1 = y0 + (TILE_HEIGHT - 1);
+                for (int tx = columnBegin; tx < columnEnd; tx++) {
+                    float x0 = tx * TILE_WIDTH + 0.5f;
+                    float x1 = x0 + (TILE_WIDTH - 1);
+
+                    // The farthest the triangle can be in the tile. The
+                    // plane only reaches below depthMin outside the
+                    // triangle.
+                    float depth = t.depthC + t.depthA * (t.depthA > 0.0f ? x0 : x1) + t.depthB * (t.depthB > 0.0f ? y0 : y1);
+                    depth = std::max(depth, t.depthMin);
+                    int tile = ty * tilesX + tx;
+                    if (depth <= reference[tile]) {
+                        continue;
+                    }
+
+                    // Edges evaluated at the tile's corner deepest inside
+                    // and farthest outside them.
+                    bool outside = false, inside = true;
+                    for (int e = 0; e < 3 && !outside; e++) {
+                        float a = t.edgeA[e], b = t.edgeB[e];
+                        float highest = a * (a > 0.0f ? x1 : x0) + b * (b > 0.0f ? y1 : y0) + t.edgeC[e];
+                        float lowest = a * (a > 0.0f ? x0 : x1) + b * (b > 0.0f ? y0 : y1) + t.edgeC[e];
+                        outside = highest < 0.0f;
+                        inside = inside && lowest >= 0.0f;
+                    }
+                    if (outside) {
+                        continue;
+                    }
+
+                    uint32_t coverage[TILE_HEIGHT];
+                    if (inside) {
+                        std::fill(coverage, coverage + TILE_HEIGHT, _internal::FULL_ROW);
+                    } else {
+                        _internal::tileCoverage(t, x0, y0, coverage);
+                        uint32_t any = 0;
+                        for (int y = 0; y < TILE_HEIGHT; y++) {
+                            any |= coverage[y];
+                        }
+                        if (any == 0) {
+                            continue;
+                        }
+                    }
+                    updateTile(tile, coverage, depth);
+                    tileUpdates++;
+                }
+            }
+        }
+    }
+
+    void OcclusionBuffer::rasterize(unsigned threads) {
+        if (threads == 0) {
+            threads = parallel::threadCount();
+        }
+        std::vector<size_t> tileUpdates(threads, 0);
+        parallel::framePool().forChunks((size_t) tilesY, threads, [&](size_t chunk, size_t begin, size_t end) {
+            rasterizeBand((int) begin, (int) end, tileUpdates[chunk]);
+        });
+        for (size_t i = 0; i < tileUpdates.size(); i++) {
+            stats.tileUpdates += tileUpdates[i];
+        }
+    }
+
+    bool OcclusionBuffer::isVisible(const Cube &box) {
+        stats.occludeesTested++;
+        float minX = std::numeric_limits<float>::infinity(), minY = minX;
+        float maxX = -minX, maxY = -minX;
+        float nearest = -std::numeric_limits<float>::infinity();
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec4 v = viewProjection * glm::vec4(corner & 1 ? box.positionMax.x : box.positionMin.x,
+                                                     corner & 2 ? box.positionMax.y : box.positionMin.y,
+                                                     corner & 4 ? box.positionMax.z : box.positionMin.z, 1.0f);
+            if (v.w <= 0.0f || v.z < -v.w) {
+                return true;
+            }
+            float x = (v.x / v.w * 0.5f + 0.5f) * width();
+            float y = (v.y / v.w * 0.5f + 0.5f) * height();
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            nearest = std::max(nearest, (v.w - v.z) / v.w);
+        }
+
+        minX = std::max(minX, 0.0f);
+        maxX = std::min(maxX, width() - 1.0f);
+        minY = std::max(minY, 0.0f);
+        maxY = std::min(maxY, height() - 1.0f);
+        if (minX <= maxX && minY <= maxY) {
+            int pixelMinX = (int) minX, pixelMaxX = (int) maxX;
+            int pixelMinY = (int) minY, pixelMaxY = (int) maxY;
+            int columnBegin = pixelMinX / TILE_WIDTH;
+            int columnEnd = pixelMaxX / TILE_WIDTH + 1;
+            for (int ty = pixelMinY / TILE_HEIGHT; ty <= pixelMaxY / TILE_HEIGHT; ty++) {
+                if (!_internal::anyAtOrBehind(&reference[ty * tilesX + columnBegin], columnEnd - columnBegin, nearest)) {
+                    continue;
+                }
+                // Tiles whose reference is not enough may still hide the box
+                // with the working layer, if it covers the box's pixels.
+                int rowBegin = std::max(pixelMinY - ty * TILE_HEIGHT, 0);
+                int rowEnd = std::min(pixelMaxY - ty * TILE_HEIGHT + 1, TILE_HEIGHT);
+                for (int tx = columnBegin; tx < columnEnd; tx++) {
+                    int tile = ty * tilesX + tx;
+                    if (reference[tile] > nearest) {
+                        continue;
+                    }
+                    if (working[tile] <= nearest) {
+                        return true;
+                    }
+                    int bitBegin = std::max(pixelMinX - tx * TILE_WIDTH, 0);
+                    int bitEnd = std::min(pixelMaxX - tx * TILE_WIDTH + 1, TILE_WIDTH);
+                    uint32_t rowMask = (_internal::FULL_ROW >> (TILE_WIDTH - (bitEnd - bitBegin))) << bitBegin;
+                    for (int y = rowBegin; y < rowEnd; y++) {
+                        if ((masks[tile * TILE_HEIGHT + y] & rowMask) != rowMask) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        stats.occludeesHidden++;
+        return false;
+    }
+
+    bool OcclusionBuffer::writeDepthImage(const std::string &path) const {
+        float nearest = 0.0f;
+        for (size_t i = 0; i < reference.size(); i++) {
+            nearest = std::max(nearest, reference[i]);
+        }
+        char header[64];
+        int headerSize = snprintf(header, sizeof(header), "P5\n%d %d\n255\n", width(), height());
+        std::vector<char> contents(header, header + headerSize);
+        // Rows go top down in the image.
+        for (int y = height() - 1; y >= 0; y--) {
+            for (int x = 0; x < width(); x++) {
+                float depth = reference[(y / TILE_HEIGHT) * tilesX + x / TILE_WIDTH];
+                contents.push_back((char) (nearest > 0.0f ? (unsigned char) (255.0f * depth / nearest) : 0));
+            }
+        }
+        return platform::writeFile(path, contents.data(), contents.size());
+    }
+
+    void benchmarkOcclusion() {
+        typedef std::chrono::steady_clock Clock;
+        const size_t BOX_COUNT = 10000;
+        const int WALLS = 8;
+        const int WALL_QUADS = 16;
+        const int REPEATS = 20;
+
+        // Walls split in WALL_QUADS x WALL_QUADS quads, 30 to 60 units in
+        // front of the camera, with gaps between them.
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+        std::mt19937 generator(11);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (int w = 0; w < WALLS; w++) {
+            float left = -70.0f + w * 18.0f + 4.0f * unit(generator);
+            float bottom = -20.0f + 10.0f * unit(generator);
+            float z = -30.0f - 30.0f * unit(generator);
+            float size = 14.0f;
+            uint32_t first = (uint32_t) (positions.size() / 3);
+            for (int j = 0; j <= WALL_QUADS; j++) {
+                for (int i = 0; i <= WALL_QUADS; i++) {
+                    positions.push_back(left + size * i / WALL_QUADS);
+                    positions.push_back(bottom + 2.0f * size * j / WALL_QUADS);
+                    positions.push_back(z);
+                }
+            }
+            for (int j = 0; j < WALL_QUADS; j++) {
+                for (int i = 0; i < WALL_QUADS; i++) {
+                    uint32_t corner = first + j * (WALL_QUADS + 1) + i;
+                    uint32_t quad[6] = {corner, corner + 1, corner + WALL_QUADS + 2, corner, corner + WALL_QUADS + 2, corner + WALL_QUADS + 1};
+                    indices.insert(indices.end(), quad, quad + 6);
+                }
+            }
+        }
+        size_t triangleCount = indices.size() / 3;
+
+        std::vector<Cube> boxes(BOX_COUNT);
+        for (size_t i = 0; i < BOX_COUNT; i++) {
+            float z = -10.0f - 190.0f * unit(generator);
+            float spread = -z * 0.6f;
+            Point p = {spread * (2.0f * unit(generator) - 1.0f), spread * 0.6f * (2.0f * unit(generator) - 1.0f), z};
+            float s = 0.5f + 2.0f * unit(generator);
+            boxes[i].positionMin = p;
+            boxes[i].positionMax = {p.x + s, p.y + s, p.z + s};
+        }
+
+        glm::mat4 view = Matrix_Camera_View(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(0.0f, 0.0f, -1.0f, 0.0f), glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+        glm::mat4 projection = Matrix_Perspective(3.141592f / 3.0f, 320.0f / 192.0f, -0.1f, -1000.0f);
+        glm::mat4 viewProjection = projection * view;
+        glm::mat4 identity(1.0f);
+
+        OcclusionBuffer buffer;
+        unsigned threadCounts[2] = {1, parallel::threadCount()};
+        double rasterizeTimes[2] = {0.0, 0.0};
+        std::vector<bool> visible[2];
+        double testTime = 0.0;
+        for (int run = 0; run < 2; run++) {
+            for (int repeat = 0; repeat < REPEATS; repeat++) {
+                buffer.begin(viewProjection);
+                Clock::time_point start = Clock::now();
+                buffer.addOccluder(positions.data(), indices.data(), triangleCount, identity);
+                buffer.rasterize(threadCounts[run]);
+                rasterizeTimes[run] += std::chrono::duration<double>(Clock::now() - start).count();
+            }
+            Clock::time_point start = Clock::now();
+            visible[run].resize(BOX_COUNT);
+            for (size_t i = 0; i < BOX_COUNT; i++) {
+                visible[run][i] = buffer.isVisible(boxes[i]);
+            }
+            testTime = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        const OcclusionBuffer::Statistics &stats = buffer.statistics();
+
+        // Reference: the nearest depth of every pixel, from the same
+        // triangle setup.
+        int width = buffer.width(), height = buffer.height();
+        std::vector<float> depths(width * height, 0.0f);
+        for (size_t t = 0; t < triangleCount; t++) {
+            glm::vec4 clip[3];
+            for (int k = 0; k < 3; k++) {
+                const float *p = &positions[indices[t * 3 + k] * 3];
+                clip[k] = viewProjection * glm::vec4(p[0], p[1], p[2], 1.0f);
+            }
+            _internal::TriangleSetup s;
+            if (!_internal::setupTriangle(clip[0], clip[1], clip[2], width, height, s)) {
+                continue;
+            }
+            for (int y = s.minY; y <= s.maxY; y++) {
+                for (int x = s.minX; x <= s.maxX; x++) {
+                    float px = x + 0.5f, py = y + 0.5f;
+                    bool inside = true;
+                    for (int e = 0; e < 3; e++) {
+                        inside = inside && s.edgeA[e] * px + s.edgeB[e] * py + s.edgeC[e] >= 0.0f;
+                    }
+                    if (inside) {
+                        float &depth = depths[y * width + x];
+                        depth = std::max(depth, s.depthA * px + s.depthB * py + s.depthC);
+                    }
+                }
+            }
+        }
+
+        size_t hidden = 0, referenceHidden = 0, wrong = 0, threadMismatches = 0;
+        for (size_t i = 0; i < BOX_COUNT; i++) {
+            float minX = std::numeric_limits<float>::infinity(), minY = minX, maxX = -minX, maxY = -minX;
+            float nearest = -std::numeric_limits<float>::infinity();
+            bool crossesNear = false;
+            for (int corner = 0; corner < 8; corner++) {
+                const Cube &box = boxes[i];
+                glm::vec4 v = viewProjection * glm::vec4(corner & 1 ? box.positionMax.x : box.positionMin.x,
+                                                         corner & 2 ? box.positionMax.y : box.positionMin.y,
+                                                         corner & 4 ? box.positionMax.z : box.positionMin.z, 1.0f);
+                crossesNear = crossesNear || v.w <= 0.0f || v.z < -v.w;
+                float x = (v.x / v.w * 0.5f + 0.5f) * width;
+                float y = (v.y / v.w * 0.5f + 0.5f) * height;
+                minX = std::min(minX, x);
+                maxX = std::max(maxX, x);
+                minY = std::min(minY, y);
+                maxY = std::max(maxY, y);
+                nearest = std::max(nearest, (v.w - v.z) / v.w);
+            }
+            bool referenceVisible = crossesNear;
+            for (int y = (int) std::max(minY, 0.0f); !referenceVisible && y <= (int) std::min(maxY, height - 1.0f); y++) {
+                for (int x = (int) std::max(minX, 0.0f); !referenceVisible && x <= (int) std::min(maxX, width - 1.0f); x++) {
+                    referenceVisible = depths[y * width + x] <= nearest;
+                }
+            }
+            hidden += !visible[1][i];
+            referenceHidden += !referenceVisible;
+            wrong += !visible[1][i] && referenceVisible;
+            threadMismatches += visible[0][i] != visible[1][i];
+        }
+
+        printf("%zu occluder triangles (%zu dropped), %zu boxes, %dx%d buffer\n", triangleCount,
+               stats.trianglesDropped, BOX_COUNT, width, height);
+        printf("rasterize: %.3f ms on 1 thread, %.3f ms on %u threads, %zu tile updates\n",
+               rasterizeTimes[0] / REPEATS * 1e3, rasterizeTimes[1] / REPEATS * 1e3, threadCounts[1], stats.tileUpdates);
+        printf("test: %.1f ns per box\n", testTime / BOX_COUNT * 1e9);
+        printf("hidden: %zu (a full depth buffer hides %zu), %zu wrongly hidden, %zu differ between thread counts\n",
+               hidden, referenceHidden, wrong, threadMismatches);
+    }
+}
@@ -0,0 +1,79 @@
+#include "parallel.h"
+
+namespace parallel {
+    ThreadPool::ThreadPool(unsigned threads) {
+        if (threads == 0) {
+            threads = threadCount();
+        }
+        for (unsigned i = 1; i < threads; i++) {
+            workers.push_back(std::thread(&ThreadPool::work, this));
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+
+    void ThreadPool::run(size_t jobCount, size_t jobChunks, const Job &function) {
+        std::lock_guard<std::mutex> submit(submitting);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &function;
+            count = jobCount;
+            chunks = jobChunks;
+            nextChunk = 0;
+            pendingChunks = jobChunks;
+            generation++;
+        }
+        wake.notify_all();
+
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pendingChunks == 0; });
+        job = nullptr;
+    }
+
+    void ThreadPool::runChunks() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (job != nullptr && nextChunk < chunks) {
+            const Job &function = *job;
+            size_t chunk = nextChunk++;
+            size_t begin = count * chunk / chunks;
+            size_t end = count * (chunk + 1) / chunks;
+            lock.unlock();
+            function(chunk, begin, end);
+            lock.lock();
+            if (--pendingChunks == 0) {
+                done.notify_all();
+            }
+        }
+    }
+
+    void ThreadPool::work() {
+        unsigned long seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            lock.unlock();
+            runChunks();
+            lock.lock();
+        }
+    }
+
+    ThreadPool &framePool() {
+        static ThreadPool pool;
+        return pool;
+    }
+}
@@ -0,0 +1,184 @@
+#include "platform.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace platform {
+    double seconds() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool makeDirectory(const std::string &path) {
+        // Create the parents first
+        size_t slash = path.find_last_of("/\\");
+        if (slash != std::string::npos && slash > 0) {
+            std::string parent = path.substr(0, slash);
+            if (parent != "." && parent != "..") {
+                makeDirectory(parent);
+            }
+        }
+
+#ifdef _WIN32
+        int result = _mkdir(path.c_str());
+#else
+        int result = mkdir(path.c_str(), 0755);
+#endif
+        return result == 0 || errno == EEXIST;
+    }
+
+    bool readFile(const std::string &path, std::string &contents) {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            return false;
+        }
+
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if (size < 0) {
+            fclose(file);
+            return false;
+        }
+
+        contents.resize((size_t) size);
+        size_t read = size > 0 ? fread(&contents[0], 1, (size_t) size, file) : 0;
+        fclose(file);
+        return read == (size_t) size;
+    }
+
+    bool writeFile(const std::string &path, const void *data, size_t size) {
+        // Write to a temporary file first so a crash never leaves a truncated
+        // file behind under the final name.
+        std::string temporary = path + ".tmp";
+        FILE *file = fopen(temporary.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+
+        bool ok = fwrite(data, 1, size, file) == size;
+        ok = (fclose(file) == 0) && ok;
+        if (!ok) {
+            remove(temporary.c_str());
+            return false;
+        }
+
+#ifdef _WIN32
+        remove(path.c_str());
+#endif
+        return rename(temporary.c_str(), path.c_str()) == 0;
+    }
+
+    static bool endsWith(const std::string &str, const std::string &suffix) {
+        return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    std::vector<std::string> listFiles(const std::string &directory, const std::string &suffix) {
+        std::vector<std::string> files;
+#ifdef _WIN32
+        WIN32_FIND_DATAA entry;
+        HANDLE search = FindFirstFileA((directory + "/*").c_str(), &entry);
+        if (search != INVALID_HANDLE_VALUE) {
+            do {
+                std::string name = entry.cFileName;
+                if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && endsWith(name, suffix)) {
+                    files.push_back(directory + "/" + name);
+                }
+            } while (FindNextFileA(search, &entry));
+            FindClose(search);
+        }
+#else
+        DIR *dir = opendir(directory.c_str());
+        if (dir != nullptr) {
+            while (struct dirent *entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name[0] != '.' && endsWith(name, suffix)) {
+                    files.push_back(directory + "/" + name);
+                }
+            }
+            closedir(dir);
+        }
+#endif
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    bool MappedFile::open(const std::string &path) {
+        close();
+#ifdef _WIN32
+        HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+            CloseHandle(handle);
+            return false;
+        }
+        HANDLE view = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (view == NULL) {
+            CloseHandle(handle);
+            return false;
+        }
+        address = MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+        if (address == nullptr) {
+            CloseHandle(view);
+            CloseHandle(handle);
+            return false;
+        }
+        file = handle;
+        mapping = view;
+        length = (size_t) size.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void *pointer = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping stays valid after the descriptor is closed.
+        ::close(fd);
+        if (pointer == MAP_FAILED) {
+            return false;
+        }
+        madvise(pointer, (size_t) info.st_size, MADV_SEQUENTIAL);
+        address = pointer;
+        length = (size_t) info.st_size;
+#endif
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (address == nullptr) {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(address);
+        CloseHandle((HANDLE) mapping);
+        CloseHandle((HANDLE) file);
+        mapping = nullptr;
+        file = nullptr;
+#else
+        munmap(address, length);
+#endif
+        address = nullptr;
+        length = 0;
+    }
+}
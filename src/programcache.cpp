@@ -0,0 +1,284 @@
+#include "programcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "glext.h"
+#include "hash.h"
+#include "platform.h"
+
+void SubmitShader(GLuint shader_id, const std::string &source)
+{
+    const GLchar *shader_string = source.c_str();
+    const GLint shader_string_length = static_cast<GLint>(source.length());
+    // Compila o shader
+    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
+    glCompileShader(shader_id);
+}
+
+bool CheckShader(GLuint shader_id, const char *label)
+{
+    // Verifica se compilou
+    GLint compiled_ok;
+    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
+    GLint log_length = 0;
+    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
+    if (log_length == 0)
+        return compiled_ok == GL_TRUE;
+    GLchar *log = new GLchar[log_length];
+    glGetShaderInfoLog(shader_id, log_length, &log_length, log);
+    if (log_length != 0)
+    {
+        std::string output;
+        // Loca o erro
+        if (!compiled_ok)
+        {
+            output += "ERROR: OpenGL compilation of \"";
+            output += label;
+            output += "\" failed.\n";
+        }
+        else
+        {
+            output += "WARNING: OpenGL compilation of \"";
+            output += label;
+            output += "\".\n";
+        }
+        output += "== Start of compilation log\n";
+        output += log;
+        output += "== End of compilation log\n";
+        fprintf(stderr, "%s", output.c_str());
+    }
+    delete[] log;
+    return compiled_ok == GL_TRUE;
+}
+
+static void PrintLinkLog(GLuint program_id)
+{
+    // Log error
+    GLint log_length = 0;
+    glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &log_length);
+    GLchar *log = new GLchar[log_length + 1];
+    log[0] = '\0';
+    glGetProgramInfoLog(program_id, log_length + 1, &log_length, log);
+    std::string output;
+    output += "ERROR: OpenGL linking of program failed.\n";
+    output += "== Start of link log\n";
+    output += log;
+    output += "\n== End of link log\n";
+    delete[] log;
+    fprintf(stderr, "%s", output.c_str());
+}
+
+namespace game {
+    namespace _internal {
+        struct ProgramBinaryHeader {
+            char magic[4];
+            uint32_t version;
+            uint64_t key;
+            uint32_t format;
+            uint32_t length;
+        };
+
+        const char PROGRAM_BINARY_MAGIC[4] = {'F', 'C', 'G', 'P'};
+        const uint32_t PROGRAM_BINARY_VERSION = 1;
+    }
+
+    void ProgramCache::init(const std::string &directory) {
+        this->directory = directory;
+        this->enabled = glext::programBinary && platform::makeDirectory(directory);
+
+        const char *strings[] = {
+                (const char *) glGetString(GL_VENDOR),
+                (const char *) glGetString(GL_RENDERER),
+                (const char *) glGetString(GL_VERSION),
+                (const char *) glGetString(GL_SHADING_LANGUAGE_VERSION),
+        };
+        uint64_t h = hash::FNV64_OFFSET;
+        for (const char *s : strings) {
+            h = hash::fnv1a64(s, h);
+            h = hash::fnv1a64("\n", 1, h);
+        }
+        this->contextHash = h;
+
+        if (!glext::programBinary) {
+            printf("Program cache disabled: driver does not support program binaries.\n");
+        }
+    }
+
+    std::string ProgramCache::pathOf(uint64_t key) const {
+        char name[32];
+        snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long) key);
+        return directory + name;
+    }
+
+    bool ProgramCache::submitBinary(GLuint program_id, uint64_t key) {
+        std::string contents;
+        if (!platform::readFile(pathOf(key), contents)) {
+            return false;
+        }
+
+        _internal::ProgramBinaryHeader header;
+        if (contents.size() < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, contents.data(), sizeof(header));
+        if (memcmp(header.magic, _internal::PROGRAM_BINARY_MAGIC, 4) != 0 ||
+            header.version != _internal::PROGRAM_BINARY_VERSION ||
+            header.key != key ||
+            contents.size() - sizeof(header) != header.length) {
+            return false;
+        }
+
+        // Whether the driver accepts the binary is only checked in finish().
+        glext::ProgramBinary(program_id, header.format, contents.data() + sizeof(header), header.length);
+        return true;
+    }
+
+    void ProgramCache::storeBinary(GLuint program_id, uint64_t key) {
+        GLint length = 0;
+        glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+
+        std::vector<char> contents(sizeof(_internal::ProgramBinaryHeader) + length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        glext::GetProgramBinary(program_id, length, &written, &format, contents.data() + sizeof(_internal::ProgramBinaryHeader));
+        if (written != length) {
+            return;
+        }
+
+        _internal::ProgramBinaryHeader header;
+        memcpy(header.magic, _internal::PROGRAM_BINARY_MAGIC, 4);
+        header.version = _internal::PROGRAM_BINARY_VERSION;
+        header.key = key;
+        header.format = format;
+        header.length = (uint32_t) length;
+        memcpy(contents.data(), &header, sizeof(header));
+
+        if (!platform::writeFile(pathOf(key), contents.data(), contents.size())) {
+            fprintf(stderr, "WARNING: Cannot write program cache file \"%s\".\n", pathOf(key).c_str());
+        }
+    }
+
+    void ProgramCache::submitSource(PendingProgram &pending, const std::string &vertexSource, const std::string &fragmentSource) {
+        pending.fromCache = false;
+        pending.program_id = glCreateProgram();
+
+        pending.vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+        SubmitShader(pending.vertex_shader_id, vertexSource);
+        pending.fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+        SubmitShader(pending.fragment_shader_id, fragmentSource);
+
+        // Linking right away is fine: glLinkProgram() is also asynchronous
+        // and compile errors surface through the link status anyway.
+        glAttachShader(pending.program_id, pending.vertex_shader_id);
+        glAttachShader(pending.program_id, pending.fragment_shader_id);
+        if (enabled) {
+            glext::ProgramParameteri(pending.program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(pending.program_id);
+    }
+
+    PendingProgram ProgramCache::begin(const char *name, const std::string &vertexSource, const std::string &fragmentSource) {
+        PendingProgram pending;
+        pending.name = name;
+        pending.start = platform::seconds();
+
+        pending.key = hash::fnv1a64(vertexSource.data(), vertexSource.size(), contextHash);
+        pending.key = hash::fnv1a64("\0", 1, pending.key);
+        pending.key = hash::fnv1a64(fragmentSource.data(), fragmentSource.size(), pending.key);
+
+        if (enabled) {
+            pending.program_id = glCreateProgram();
+            if (submitBinary(pending.program_id, pending.key)) {
+                // Keep the sources in case the driver rejects the binary.
+                pending.fromCache = true;
+                const GLchar *vertex_string = vertexSource.c_str();
+                const GLchar *fragment_string = fragmentSource.c_str();
+                pending.vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+                glShaderSource(pending.vertex_shader_id, 1, &vertex_string, nullptr);
+                pending.fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+                glShaderSource(pending.fragment_shader_id, 1, &fragment_string, nullptr);
+                return pending;
+            }
+            glDeleteProgram(pending.program_id);
+        }
+
+        submitSource(pending, vertexSource, fragmentSource);
+        return pending;
+    }
+
+    bool ProgramCache::isReady(const PendingProgram &pending) const {
+        if (!glext::parallelShaderCompile) {
+            return true;
+        }
+        GLint done = GL_FALSE;
+        glGetProgramiv(pending.program_id, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+    GLuint ProgramCache::finish(PendingProgram &pending) {
+        GLint linked_ok = GL_FALSE;
+        glGetProgramiv(pending.program_id, GL_LINK_STATUS, &linked_ok);
+
+        if (pending.fromCache) {
+            if (linked_ok == GL_TRUE) {
+                glDeleteShader(pending.vertex_shader_id);
+                glDeleteShader(pending.fragment_shader_id);
+
+                double elapsed = platform::seconds() - pending.start;
+                hits += 1;
+                hitSeconds += elapsed;
+                printf("Program \"%s\": cache hit (%.2f ms)\n", pending.name.c_str(), elapsed * 1000.0);
+                return pending.program_id;
+            }
+
+            // The driver may reject binaries produced by a different build
+            // even if the version strings match. Binaries rejected by
+            // glProgramBinary() leave the program in an unusable state, so
+            // start over with a fresh one from the sources kept aside.
+            glDeleteProgram(pending.program_id);
+            pending.program_id = glCreateProgram();
+            glCompileShader(pending.vertex_shader_id);
+            glCompileShader(pending.fragment_shader_id);
+            glAttachShader(pending.program_id, pending.vertex_shader_id);
+            glAttachShader(pending.program_id, pending.fragment_shader_id);
+            glext::ProgramParameteri(pending.program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            glLinkProgram(pending.program_id);
+            glGetProgramiv(pending.program_id, GL_LINK_STATUS, &linked_ok);
+            pending.fromCache = false;
+        }
+
+        std::string vertexLabel = pending.name + " (vertex)";
+        std::string fragmentLabel = pending.name + " (fragment)";
+        CheckShader(pending.vertex_shader_id, vertexLabel.c_str());
+        CheckShader(pending.fragment_shader_id, fragmentLabel.c_str());
+        if (linked_ok == GL_FALSE) {
+            PrintLinkLog(pending.program_id);
+        }
+
+        // The program keeps its own copy of the compiled code.
+        glDetachShader(pending.program_id, pending.vertex_shader_id);
+        glDetachShader(pending.program_id, pending.fragment_shader_id);
+        glDeleteShader(pending.vertex_shader_id);
+        glDeleteShader(pending.fragment_shader_id);
+
+        if (enabled && linked_ok == GL_TRUE) {
+            storeBinary(pending.program_id, pending.key);
+        }
+
+        double elapsed = platform::seconds() - pending.start;
+        compilations += 1;
+        compileSeconds += elapsed;
+        printf("Program \"%s\": compiled from source (%.2f ms)\n", pending.name.c_str(), elapsed * 1000.0);
+        return pending.program_id;
+    }
+
+    void ProgramCache::printStatistics() const {
+        printf("Programs: %d cache hit(s) in %.2f ms, %d compiled in %.2f ms\n",
+               hits, hitSeconds * 1000.0, compilations, compileSeconds * 1000.0);
+    }
+}
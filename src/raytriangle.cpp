@@ -0,0 +1,374 @@
+#include "raytriangle.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include "bvh.h"
+#include "objloader.h"
+#include "simd.h"
+
+namespace collision {
+    namespace _internal {
+        // Same threshold as collide(Triangle, Ray).
+        const float DETERMINANT_EPSILON = 1e-9f;
+
+        bool intersectScalar(const TriangleBlock *blocks, size_t count, const Ray &ray, float &tMax, uint32_t &triangle) {
+            const float o[3] = {ray.startPosition.x, ray.startPosition.y, ray.startPosition.z};
+            const float d[3] = {ray.direction.x, ray.direction.y, ray.direction.z};
+            bool hit = false;
+
+            for (size_t b = 0; b < count; b++) {
+                const TriangleBlock &block = blocks[b];
+                for (int i = 0; i < TRIANGLE_BLOCK_SIZE; i++) {
+                    float e1[3] = {block.edge1[0][i], block.edge1[1][i], block.edge1[2][i]};
+                    float e2[3] = {block.edge2[0][i], block.edge2[1][i], block.edge2[2][i]};
+                    float p[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+                    float determinant = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+                    if (std::fabs(determinant) < DETERMINANT_EPSILON) {
+                        continue;
+                    }
+                    float inverse = 1.0f / determinant;
+
+                    float s[3] = {o[0] - block.v0[0][i], o[1] - block.v0[1][i], o[2] - block.v0[2][i]};
+                    float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverse;
+                    float q[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0]};
+                    float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inverse;
+                    float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inverse;
+                    if (u >= 0.0f && u <= 1.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t < tMax) {
+                        tMax = t;
+                        triangle = (uint32_t) (b * TRIANGLE_BLOCK_SIZE + i);
+                        hit = true;
+                    }
+                }
+            }
+            return hit;
+        }
+
+#ifdef SIMD_X86
+        // The SIMD kernels keep, per lane, the nearest t and the step that
+        // found it (as a float, exact below 2^24 steps). The lane and the
+        // step give back the triangle once all blocks are done.
+        inline bool pickNearest(const float *distances, const float *steps, int lanes, float &tMax, uint32_t &triangle) {
+            int best = -1;
+            for (int lane = 0; lane < lanes; lane++) {
+                if (steps[lane] < 0.0f) {
+                    continue;
+                }
+                uint32_t index = (uint32_t) steps[lane] * lanes + lane;
+                // Ties go to the lowest index, as in the scalar kernel.
+                if (best < 0 || distances[lane] < tMax ||
+                    (distances[lane] == tMax && index < triangle)) {
+                    tMax = distances[lane];
+                    triangle = index;
+                    best = lane;
+                }
+            }
+            return best >= 0;
+        }
+
+        TARGET_SSE
+        bool intersectSse(const TriangleBlock *blocks, size_t count, const Ray &ray, float &tMax, uint32_t &triangle) {
+            const __m128 ox = _mm_set1_ps(ray.startPosition.x);
+            const __m128 oy = _mm_set1_ps(ray.startPosition.y);
+            const __m128 oz = _mm_set1_ps(ray.startPosition.z);
+            const __m128 dx = _mm_set1_ps(ray.direction.x);
+            const __m128 dy = _mm_set1_ps(ray.direction.y);
+            const __m128 dz = _mm_set1_ps(ray.direction.z);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 epsilon = _mm_set1_ps(DETERMINANT_EPSILON);
+            const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+            __m128 nearest = _mm_set1_ps(tMax);
+            __m128 nearestStep = _mm_set1_ps(-1.0f);
+            __m128 step = zero;
+
+            for (size_t b = 0; b < count; b++) {
+                const TriangleBlock &block = blocks[b];
+                for (int h = 0; h < TRIANGLE_BLOCK_SIZE; h += 4) {
+                    __m128 e1x = _mm_loadu_ps(&block.edge1[0][h]);
+                    __m128 e1y = _mm_loadu_ps(&block.edge1[1][h]);
+                    __m128 e1z = _mm_loadu_ps(&block.edge1[2][h]);
+                    __m128 e2x = _mm_loadu_ps(&block.edge2[0][h]);
+                    __m128 e2y = _mm_loadu_ps(&block.edge2[1][h]);
+                    __m128 e2z = _mm_loadu_ps(&block.edge2[2][h]);
+
+                    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+                    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+                    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+                    __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+                    __m128 inverse = _mm_div_ps(one, determinant);
+
+                    __m128 sx = _mm_sub_ps(ox, _mm_loadu_ps(&block.v0[0][h]));
+                    __m128 sy = _mm_sub_ps(oy, _mm_loadu_ps(&block.v0[1][h]));
+                    __m128 sz = _mm_sub_ps(oz, _mm_loadu_ps(&block.v0[2][h]));
+                    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverse);
+
+                    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+                    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+                    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+                    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverse);
+                    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverse);
+
+                    // Ordered compares: the NaNs of degenerate lanes fail them.
+                    __m128 mask = _mm_cmpge_ps(_mm_and_ps(determinant, absMask), epsilon);
+                    mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+                    mask = _mm_and_ps(mask, _mm_cmple_ps(u, one));
+                    mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+                    mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+                    mask = _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+                    mask = _mm_and_ps(mask, _mm_cmplt_ps(t, nearest));
+
+                    nearest = _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, nearest));
+                    nearestStep = _mm_or_ps(_mm_and_ps(mask, step), _mm_andnot_ps(mask, nearestStep));
+                    step = _mm_add_ps(step, one);
+                }
+            }
+
+            float distances[4], steps[4];
+            _mm_storeu_ps(distances, nearest);
+            _mm_storeu_ps(steps, nearestStep);
+            return pickNearest(distances, steps, 4, tMax, triangle);
+        }
+
+        TARGET_AVX
+        bool intersectAvx(const TriangleBlock *blocks, size_t count, const Ray &ray, float &tMax, uint32_t &triangle) {
+            const __m256 ox = _mm256_set1_ps(ray.startPosition.x);
+            const __m256 oy = _mm256_set1_ps(ray.startPosition.y);
+            const __m256 oz = _mm256_set1_ps(ray.startPosition.z);
+            const __m256 dx = _mm256_set1_ps(ray.direction.x);
+            const __m256 dy = _mm256_set1_ps(ray.direction.y);
+            const __m256 dz = _mm256_set1_ps(ray.direction.z);
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 epsilon = _mm256_set1_ps(DETERMINANT_EPSILON);
+            const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+            __m256 nearest = _mm256_set1_ps(tMax);
+            __m256 nearestStep = _mm256_set1_ps(-1.0f);
+            __m256 step = zero;
+
+            for (size_t b = 0; b < count; b++) {
+                const TriangleBlock &block = blocks[b];
+                __m256 e1x = _mm256_loadu_ps(block.edge1[0]);
+                __m256 e1y = _mm256_loadu_ps(block.edge1[1]);
+                __m256 e1z = _mm256_loadu_ps(block.edge1[2]);
+                __m256 e2x = _mm256_loadu_ps(block.edge2[0]);
+                __m256 e2y = _mm256_loadu_ps(block.edge2[1]);
+                __m256 e2z = _mm256_loadu_ps(block.edge2[2]);
+
+                __m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+                __m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+                __m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+                __m256 determinant = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+                __m256 inverse = _mm256_div_ps(one, determinant);
+
+                __m256 sx = _mm256_sub_ps(ox, _mm256_loadu_ps(block.v0[0]));
+                __m256 sy = _mm256_sub_ps(oy, _mm256_loadu_ps(block.v0[1]));
+                __m256 sz = _mm256_sub_ps(oz, _mm256_loadu_ps(block.v0[2]));
+                __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), inverse);
+
+                __m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+                __m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+                __m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+                __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), inverse);
+                __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), inverse);
+
+                __m256 mask = _mm256_cmp_ps(_mm256_and_ps(determinant, absMask), epsilon, _CMP_GE_OQ);
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, nearest, _CMP_LT_OQ));
+
+                nearest = _mm256_blendv_ps(nearest, t, mask);
+                nearestStep = _mm256_blendv_ps(nearestStep, step, mask);
+                step = _mm256_add_ps(step, one);
+            }
+
+            float distances[8], steps[8];
+            _mm256_storeu_ps(distances, nearest);
+            _mm256_storeu_ps(steps, nearestStep);
+            return pickNearest(distances, steps, 8, tMax, triangle);
+        }
+#endif
+    }
+
+    void TriangleBlocks::build(const float *positions, const uint32_t *indices, size_t count) {
+        triangleCount = count;
+        blocks.resize((count + TRIANGLE_BLOCK_SIZE - 1) / TRIANGLE_BLOCK_SIZE);
+        if (!blocks.empty()) {
+            // Zero edges make the padding degenerate.
+            memset(&blocks.back(), 0, sizeof(TriangleBlock));
+        }
+
+        for (size_t t = 0; t < count; t++) {
+            TriangleBlock &block = blocks[t / TRIANGLE_BLOCK_SIZE];
+            size_t lane = t % TRIANGLE_BLOCK_SIZE;
+            const float *v0 = &positions[indices[t * 3 + 0] * 3];
+            const float *v1 = &positions[indices[t * 3 + 1] * 3];
+            const float *v2 = &positions[indices[t * 3 + 2] * 3];
+            for (int k = 0; k < 3; k++) {
+                block.v0[k][lane] = v0[k];
+                block.edge1[k][lane] = v1[k] - v0[k];
+                block.edge2[k][lane] = v2[k] - v0[k];
+            }
+        }
+    }
+
+    RayTriangleKernel bestRayTriangleKernel() {
+#ifdef SIMD_X86
+        static const RayTriangleKernel best =
+                __builtin_cpu_supports("avx") ? KERNEL_AVX : (__builtin_cpu_supports("sse2") ? KERNEL_SSE : KERNEL_SCALAR);
+        return best;
+#else
+        return KERNEL_SCALAR;
+#endif
+    }
+
+    const char *kernelName(RayTriangleKernel kernel) {
+        switch (kernel) {
+            case KERNEL_SSE: return "SSE";
+            case KERNEL_AVX: return "AVX";
+            default: return "scalar";
+        }
+    }
+
+    bool intersect(const TriangleBlock *blocks, size_t count, const Ray &ray, float &tMax, uint32_t &triangle,
+                   RayTriangleKernel kernel) {
+#ifdef SIMD_X86
+        // Kernels the CPU lacks fall back to the best one it has.
+        if (kernel > bestRayTriangleKernel()) {
+            kernel = bestRayTriangleKernel();
+        }
+        if (kernel == KERNEL_AVX) {
+            return _internal::intersectAvx(blocks, count, ray, tMax, triangle);
+        }
+        if (kernel == KERNEL_SSE) {
+            return _internal::intersectSse(blocks, count, ray, tMax, triangle);
+        }
+#endif
+        return _internal::intersectScalar(blocks, count, ray, tMax, triangle);
+    }
+
+    bool intersect(const TriangleBlocks &triangles, const Ray &ray, float &tMax, uint32_t &triangle,
+                   RayTriangleKernel kernel) {
+        return intersect(triangles.blocks.data(), triangles.blocks.size(), ray, tMax, triangle, kernel);
+    }
+
+    void benchmarkRayTriangle(const std::string &path) {
+        typedef std::chrono::steady_clock Clock;
+        const int RAYS = 2048;
+        // Rays also checked against collide(Triangle, Ray), one triangle at
+        // a time.
+        const int REFERENCE_RAYS = 64;
+
+        mesh::MeshData mesh;
+        if (!mesh::loadObj(path, mesh)) {
+            return;
+        }
+        mesh.computeBounds();
+        TriangleBlocks triangles;
+        triangles.build(mesh.positions.data(), mesh.indices.data(), mesh.triangleCount());
+
+        // Rays from a sphere around the mesh towards random points of its
+        // bounding box: most of them hit.
+        float center[3], radius = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            center[k] = 0.5f * (mesh.boundsMin[k] + mesh.boundsMax[k]);
+            radius = std::max(radius, mesh.boundsMax[k] - mesh.boundsMin[k]);
+        }
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::vector<Ray> rays(RAYS);
+        for (int r = 0; r < RAYS; r++) {
+            float from[3], to[3];
+            float length = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                from[k] = unit(generator);
+                length += from[k] * from[k];
+            }
+            length = std::sqrt(length);
+            for (int k = 0; k < 3; k++) {
+                from[k] = center[k] + from[k] / length * radius;
+                to[k] = center[k] + unit(generator) * 0.5f * (mesh.boundsMax[k] - mesh.boundsMin[k]);
+            }
+            rays[r].startPosition = {from[0], from[1], from[2]};
+            rays[r].direction = {to[0] - from[0], to[1] - from[1], to[2] - from[2]};
+        }
+
+        // Reference results
+        std::vector<float> referenceT(RAYS);
+        std::vector<uint32_t> referenceTriangle(RAYS);
+        int referenceMismatches = 0;
+        for (int r = 0; r < RAYS; r++) {
+            referenceT[r] = std::numeric_limits<float>::infinity();
+            referenceTriangle[r] = UINT32_MAX;
+            intersect(triangles, rays[r], referenceT[r], referenceTriangle[r], KERNEL_SCALAR);
+
+            if (r < REFERENCE_RAYS) {
+                float nearest = std::numeric_limits<float>::infinity();
+                uint32_t nearestTriangle = UINT32_MAX;
+                for (size_t t = 0; t < mesh.triangleCount(); t++) {
+                    const float *p[3];
+                    for (int k = 0; k < 3; k++) {
+                        p[k] = &mesh.positions[mesh.indices[t * 3 + k] * 3];
+                    }
+                    Triangle triangle = {{p[0][0], p[0][1], p[0][2]}, {p[1][0], p[1][1], p[1][2]}, {p[2][0], p[2][1], p[2][2]}};
+                    float hit = collide(triangle, rays[r]);
+                    if (hit >= 0.0f && hit < nearest) {
+                        nearest = hit;
+                        nearestTriangle = (uint32_t) t;
+                    }
+                }
+                if (nearestTriangle != referenceTriangle[r]) {
+                    referenceMismatches++;
+                }
+            }
+        }
+
+        std::string name = path.substr(path.find_last_of("/\\") + 1);
+        printf("%s: %zu triangles, %d rays, every ray against every triangle\n", name.c_str(), triangles.triangleCount, RAYS);
+        printf("%-8s %14s %16s %12s\n", "kernel", "rays/s", "tests/s", "mismatches");
+        for (int k = KERNEL_SCALAR; k <= bestRayTriangleKernel(); k++) {
+            RayTriangleKernel kernel = (RayTriangleKernel) k;
+            int mismatches = kernel == KERNEL_SCALAR ? referenceMismatches : 0;
+            Clock::time_point start = Clock::now();
+            for (int r = 0; r < RAYS; r++) {
+                float t = std::numeric_limits<float>::infinity();
+                uint32_t triangle = UINT32_MAX;
+                intersect(triangles, rays[r], t, triangle, kernel);
+                if (triangle != referenceTriangle[r] || t != referenceT[r]) {
+                    mismatches++;
+                }
+            }
+            double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            printf("%-8s %14.0f %16.3e %12d\n", kernelName(kernel), RAYS / elapsed,
+                   RAYS * (double) triangles.triangleCount / elapsed, mismatches);
+        }
+
+        // The same rays through a triangle BVH, whose leaves go to the best
+        // kernel one block at a time.
+        TriangleBvh bvh;
+        bvh.build(mesh.positions.data(), mesh.indices.data(), mesh.triangleCount());
+        int mismatches = 0;
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < RAYS; r++) {
+            float t = std::numeric_limits<float>::infinity();
+            uint32_t triangle = UINT32_MAX;
+            bvh.raycast(rays[r], t, triangle);
+            if (triangle != referenceTriangle[r] || t != referenceT[r]) {
+                mismatches++;
+            }
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        printf("%-8s %14.0f %16s %12d\n", "BVH", RAYS / elapsed, "-", mismatches);
+        printf("(scalar mismatches are against collide(Triangle, Ray) on the first %d rays)\n", REFERENCE_RAYS);
+    }
+}
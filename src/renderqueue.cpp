@@ -0,0 +1,138 @@
+#include "renderqueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "glm/gtc/type_ptr.hpp"
+
+#include "glstate.h"
+
+namespace game {
+    namespace _internal {
+        // Non-negative floats keep their order when compared as integers,
+        // so the top bits of the representation are a cheap depth quantizer.
+        uint64_t depthBits(float depth) {
+            if (!(depth > 0.0f)) {
+                return 0;
+            }
+            uint32_t bits;
+            memcpy(&bits, &depth, sizeof(bits));
+            return (bits >> 7) & 0xFFFFFF;
+        }
+
+        uint64_t nameBits(GLuint name) {
+            return name & 0xFFF;
+        }
+
+        bool isLine(GLenum mode) {
+            return mode == GL_LINES || mode == GL_LINE_STRIP || mode == GL_LINE_LOOP;
+        }
+    }
+
+    // Key layout, from the most significant bit:
+    //
+    //   opaque:      layer:2 | program:12 | vao:12 | texture:12 | depth:24 | 0:2
+    //   translucent: layer:2 | ~depth:24  | program:12 | vao:12 | texture:12 | 0:2
+    //   overlay:     layer:2 | 0:30       | sequence:32
+    uint64_t RenderQueue::makeKey(RenderLayer layer, const DrawPacket &packet, float depth, uint32_t sequence) {
+        uint64_t key = (uint64_t) layer << 62;
+        uint64_t program = _internal::nameBits(packet.program);
+        uint64_t vao = _internal::nameBits(packet.vao);
+        uint64_t texture = _internal::nameBits(packet.texture);
+        uint64_t depthKey = _internal::depthBits(depth);
+
+        switch (layer) {
+            case LAYER_OPAQUE:
+                key |= program << 50 | vao << 38 | texture << 26 | depthKey << 2;
+                break;
+            case LAYER_TRANSLUCENT:
+                key |= (~depthKey & 0xFFFFFF) << 38 | program << 26 | vao << 14 | texture << 2;
+                break;
+            case LAYER_OVERLAY:
+                key |= sequence;
+                break;
+        }
+        return key;
+    }
+
+    void RenderQueue::submit(const DrawPacket &packet, RenderLayer layer, glm::vec4 position) {
+        glm::vec4 offset = position - viewPosition;
+        float depth = offset.x * offset.x + offset.y * offset.y + offset.z * offset.z;
+
+        packets.push_back(packet);
+        packets.back().key = makeKey(layer, packet, depth, sequence++);
+    }
+
+    void RenderQueue::execute() {
+        order.resize(packets.size());
+        for (size_t i = 0; i < packets.size(); i++) {
+            order[i] = std::make_pair(packets[i].key, (uint32_t) i);
+        }
+        // Ties keep their submission order since the index is the second
+        // member of the pair.
+        std::sort(order.begin(), order.end());
+
+        Statistics statistics;
+        statistics.packets = packets.size();
+
+        GLuint previousProgram = glState.program();
+        GLuint previousVertexArray = glState.vertexArray();
+        for (size_t i = 0; i < order.size(); i++) {
+            const DrawPacket &packet = packets[order[i].second];
+
+            if (packet.program != previousProgram) {
+                statistics.programSwitches += 1;
+                previousProgram = packet.program;
+            }
+            if (packet.vao != previousVertexArray) {
+                statistics.vertexArraySwitches += 1;
+                previousVertexArray = packet.vao;
+            }
+
+            glState.useProgram(packet.program);
+            glState.bindVertexArray(packet.vao);
+            if (packet.texture != 0) {
+                glState.bindTexture(0, GL_TEXTURE_2D, packet.texture);
+            }
+            glState.depthFunc(packet.depthFunc);
+            glState.depthMask(packet.depthWrite);
+            glState.setBlend(packet.blend != BLEND_NONE);
+            if (packet.blend == BLEND_ALPHA) {
+                glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            } else if (packet.blend == BLEND_ADDITIVE) {
+                glState.blendFunc(GL_SRC_ALPHA, GL_ONE);
+            }
+            if (_internal::isLine(packet.mode)) {
+                glState.lineWidth(packet.lineWidth);
+            }
+
+            if (packet.modelUniform >= 0) {
+                glUniformMatrix4fv(packet.modelUniform, 1, GL_FALSE, glm::value_ptr(packet.model));
+            }
+            if (packet.flagUniform >= 0) {
+                glUniform1i(packet.flagUniform, packet.flag);
+            }
+
+            if (packet.indexed) {
+                void *indices = (void *) packet.first;
+                if (packet.instances > 1) {
+                    glDrawElementsInstancedBaseVertex(packet.mode, packet.count, GL_UNSIGNED_INT, indices, packet.instances, packet.baseVertex);
+                } else if (packet.baseVertex != 0) {
+                    glDrawElementsBaseVertex(packet.mode, packet.count, GL_UNSIGNED_INT, indices, packet.baseVertex);
+                } else {
+                    glDrawElements(packet.mode, packet.count, GL_UNSIGNED_INT, indices);
+                }
+            } else {
+                if (packet.instances > 1) {
+                    glDrawArraysInstanced(packet.mode, (GLint) packet.first, packet.count, packet.instances);
+                } else {
+                    glDrawArrays(packet.mode, (GLint) packet.first, packet.count);
+                }
+            }
+        }
+
+        lastFrame = statistics;
+        packets.clear();
+        sequence = 0;
+    }
+}
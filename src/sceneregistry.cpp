@@ -0,0 +1,80 @@
+#include "sceneregistry.h"
+
+#include <cstdio>
+
+namespace game {
+    SceneHandle SceneRegistry::create(uint32_t name, const SceneObject &object) {
+        SceneHandle handle;
+        if (byName.find(name) != byName.end()) {
+            fprintf(stderr, "ERROR: Scene object \"%s\" is already registered (or its name hash collides).\n",
+                    object.name != nullptr ? object.name : "?");
+            return handle;
+        }
+
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            if (slots.size() > SceneHandle::INDEX_MASK) {
+                fprintf(stderr, "ERROR: Scene registry is full.\n");
+                return handle;
+            }
+            slot = (uint32_t) slots.size();
+            Slot fresh;
+            fresh.generation = 1;
+            slots.push_back(fresh);
+        }
+
+        slots[slot].dense = (uint32_t) objects.size();
+        objects.push_back(object);
+        owners.push_back(slot);
+        names.push_back(name);
+
+        handle.value = (slots[slot].generation << SceneHandle::INDEX_BITS) | slot;
+        byName[name] = handle;
+        return handle;
+    }
+
+    void SceneRegistry::destroy(SceneHandle handle) {
+        if (get(handle) == nullptr) {
+            return;
+        }
+        Slot &slot = slots[handle.index()];
+        uint32_t last = (uint32_t) objects.size() - 1;
+
+        byName.erase(names[slot.dense]);
+        // Keep the storage dense: the last object takes the freed place.
+        objects[slot.dense] = objects[last];
+        owners[slot.dense] = owners[last];
+        names[slot.dense] = names[last];
+        slots[owners[slot.dense]].dense = slot.dense;
+        objects.pop_back();
+        owners.pop_back();
+        names.pop_back();
+
+        // Generation 0 is skipped so no handle is ever 0.
+        slot.generation = (slot.generation + 1) & SceneHandle::GENERATION_MASK;
+        if (slot.generation == 0) {
+            slot.generation = 1;
+        }
+        freeSlots.push_back(handle.index());
+    }
+
+    SceneObject *SceneRegistry::get(SceneHandle handle) {
+        uint32_t index = handle.index();
+        if (!handle.valid() || index >= slots.size() || slots[index].generation != handle.generation()) {
+            return nullptr;
+        }
+        return &objects[slots[index].dense];
+    }
+
+    const SceneObject *SceneRegistry::get(SceneHandle handle) const {
+        return const_cast<SceneRegistry *>(this)->get(handle);
+    }
+
+    SceneHandle SceneRegistry::find(uint32_t name) const {
+        std::unordered_map<uint32_t, SceneHandle>::const_iterator found = byName.find(name);
+        return found != byName.end() ? found->second : SceneHandle();
+    }
+}
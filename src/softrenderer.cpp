@@ -0,0 +1,616 @@
+#include "softrenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "parallel.h"
+#include "platform.h"
+#include "simd.h"
+
+namespace game {
+    namespace _internal {
+        const uint32_t LINE_BIT = 0x80000000u;
+
+        inline bool depthPasses(GLenum func, float depth, float stored) {
+            switch (func) {
+                case GL_NEVER: return false;
+                case GL_LESS: return depth < stored;
+                case GL_EQUAL: return depth == stored;
+                case GL_LEQUAL: return depth <= stored;
+                case GL_GREATER: return depth > stored;
+                case GL_NOTEQUAL: return depth != stored;
+                case GL_GEQUAL: return depth >= stored;
+                default: return true;
+            }
+        }
+
+        // RGBA8 with the conversion of GL: clamp, then round to nearest.
+        inline uint32_t packColor(const glm::vec4 &color) {
+            uint32_t packed = 0;
+            for (int c = 0; c < 4; c++) {
+                float value = std::min(std::max(color[c], 0.0f), 1.0f);
+                packed |= (uint32_t) (value * 255.0f + 0.5f) << (8 * c);
+            }
+            return packed;
+        }
+
+        inline void plane(const float *x, const float *y, const float *value, float area, float *out) {
+            out[0] = ((value[1] - value[0]) * (y[2] - y[0]) - (value[2] - value[0]) * (y[1] - y[0])) / area;
+            out[1] = ((value[2] - value[0]) * (x[1] - x[0]) - (value[1] - value[0]) * (x[2] - x[0])) / area;
+            out[2] = value[0] - out[0] * x[0] - out[1] * y[0];
+        }
+
+        inline float evaluate(const float *plane, float x, float y) {
+            return plane[0] * x + (plane[1] * y + plane[2]);
+        }
+
+        void rasterizeTriangleScalar(const SoftTriangle &t, int x0, int y0, int x1, int y1,
+                                     uint32_t *colors, float *depths, int stride, size_t &fragments) {
+            for (int y = y0; y <= y1; y++) {
+                float py = y + 0.5f;
+                for (int x = x0; x <= x1; x++) {
+                    float px = x + 0.5f;
+                    bool inside = true;
+                    for (int e = 0; e < 3; e++) {
+                        inside = inside && t.edgeA[e] * px + (t.edgeB[e] * py + t.edgeC[e]) >= t.edgeBias[e];
+                    }
+                    float depth = evaluate(t.depth, px, py);
+                    float &stored = depths[y * stride + x];
+                    if (!inside || !depthPasses(t.depthFunc, depth, stored)) {
+                        continue;
+                    }
+                    if (t.depthWrite) {
+                        stored = depth;
+                    }
+                    float w = 1.0f / evaluate(t.inverseW, px, py);
+                    glm::vec4 color;
+                    for (int c = 0; c < 4; c++) {
+                        color[c] = evaluate(t.color[c], px, py) * w;
+                    }
+                    colors[y * stride + x] = packColor(color);
+                    fragments++;
+                }
+            }
+        }
+
+#ifdef SIMD_X86
+        TARGET_SSE
+        inline __m128 depthTest(GLenum func, __m128 depth, __m128 stored) {
+            switch (func) {
+                case GL_NEVER: return _mm_setzero_ps();
+                case GL_LESS: return _mm_cmplt_ps(depth, stored);
+                case GL_EQUAL: return _mm_cmpeq_ps(depth, stored);
+                case GL_LEQUAL: return _mm_cmple_ps(depth, stored);
+                case GL_GREATER: return _mm_cmpgt_ps(depth, stored);
+                case GL_NOTEQUAL: return _mm_cmpneq_ps(depth, stored);
+                case GL_GEQUAL: return _mm_cmpge_ps(depth, stored);
+                default: return _mm_castsi128_ps(_mm_set1_epi32(-1));
+            }
+        }
+
+        TARGET_SSE
+        inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+
+        // The same operations as rasterizeTriangleScalar(), 4 pixels at a
+        // time. "x0" must be a multiple of 4 and rows hold whole groups.
+        TARGET_SSE
+        void rasterizeTriangleSse(const SoftTriangle &t, int x0, int y0, int x1, int y1,
+                                  uint32_t *colors, float *depths, int stride, size_t &fragments) {
+            const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 scale = _mm_set1_ps(255.0f);
+            const __m128 half = _mm_set1_ps(0.5f);
+            __m128 edgeA[3], edgeBias[3];
+            for (int e = 0; e < 3; e++) {
+                edgeA[e] = _mm_set1_ps(t.edgeA[e]);
+                edgeBias[e] = _mm_set1_ps(t.edgeBias[e]);
+            }
+            const __m128 depthA = _mm_set1_ps(t.depth[0]);
+            const __m128 inverseWA = _mm_set1_ps(t.inverseW[0]);
+            __m128 colorA[4];
+            for (int c = 0; c < 4; c++) {
+                colorA[c] = _mm_set1_ps(t.color[c][0]);
+            }
+
+            for (int y = y0; y <= y1; y++) {
+                float py = y + 0.5f;
+                __m128 edgeRow[3];
+                for (int e = 0; e < 3; e++) {
+                    edgeRow[e] = _mm_set1_ps(t.edgeB[e] * py + t.edgeC[e]);
+                }
+                const __m128 depthRow = _mm_set1_ps(t.depth[1] * py + t.depth[2]);
+                const __m128 inverseWRow = _mm_set1_ps(t.inverseW[1] * py + t.inverseW[2]);
+                __m128 colorRow[4];
+                for (int c = 0; c < 4; c++) {
+                    colorRow[c] = _mm_set1_ps(t.color[c][1] * py + t.color[c][2]);
+                }
+
+                for (int x = x0; x <= x1; x += 4) {
+                    __m128 px = _mm_add_ps(_mm_set1_ps((float) x), offsets);
+                    __m128 mask = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], px), edgeRow[0]), edgeBias[0]);
+                    mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], px), edgeRow[1]), edgeBias[1]));
+                    mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], px), edgeRow[2]), edgeBias[2]));
+                    if (_mm_movemask_ps(mask) == 0) {
+                        continue;
+                    }
+
+                    float *depthRowPointer = depths + y * stride + x;
+                    __m128 stored = _mm_loadu_ps(depthRowPointer);
+                    __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, px), depthRow);
+                    mask = _mm_and_ps(mask, depthTest(t.depthFunc, depth, stored));
+                    int lanes = _mm_movemask_ps(mask);
+                    if (lanes == 0) {
+                        continue;
+                    }
+                    if (t.depthWrite) {
+                        _mm_storeu_ps(depthRowPointer, select(mask, depth, stored));
+                    }
+
+                    __m128 w = _mm_div_ps(one, _mm_add_ps(_mm_mul_ps(inverseWA, px), inverseWRow));
+                    __m128i packed = _mm_setzero_si128();
+                    for (int c = 0; c < 4; c++) {
+                        __m128 value = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(colorA[c], px), colorRow[c]), w);
+                        value = _mm_min_ps(_mm_max_ps(value, zero), one);
+                        __m128i channel = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+                        packed = _mm_or_si128(packed, _mm_slli_epi32(channel, 8 * c));
+                    }
+                    uint32_t *colorRowPointer = colors + y * stride + x;
+                    __m128 previous = _mm_loadu_ps((const float *) colorRowPointer);
+                    _mm_storeu_ps((float *) colorRowPointer, select(mask, _mm_castsi128_ps(packed), previous));
+                    fragments += (lanes & 1) + ((lanes >> 1) & 1) + ((lanes >> 2) & 1) + ((lanes >> 3) & 1);
+                }
+            }
+        }
+#endif
+
+        // One pixel wide steps along the major axis, "width" pixels across
+        // it, as GL draws aliased wide lines.
+        void rasterizeLine(const SoftLine &line, int x0, int y0, int x1, int y1,
+                           uint32_t *colors, float *depths, int stride, size_t &fragments) {
+            const SoftVertex &a = line.ends[0];
+            const SoftVertex &b = line.ends[1];
+            float dx = b.x - a.x, dy = b.y - a.y;
+            bool xMajor = std::fabs(dx) >= std::fabs(dy);
+            float major0 = xMajor ? a.x : a.y;
+            float delta = xMajor ? dx : dy;
+            if (delta == 0.0f) {
+                return;
+            }
+            float majorMin = std::min(major0, major0 + delta);
+            float majorMax = std::max(major0, major0 + delta);
+            int stepBegin = std::max((int) std::ceil(majorMin - 0.5f), xMajor ? x0 : y0);
+            int stepEnd = std::min((int) std::ceil(majorMax - 0.5f) - 1, xMajor ? x1 : y1);
+
+            for (int step = stepBegin; step <= stepEnd; step++) {
+                float t = (step + 0.5f - major0) / delta;
+                float minor = xMajor ? a.y + t * dy : a.x + t * dx;
+                int first = (int) std::floor(minor) - (line.width - 1) / 2;
+                float depth = a.z + t * (b.z - a.z);
+                float inverseW = a.inverseW + t * (b.inverseW - a.inverseW);
+                glm::vec4 color = (a.color + t * (b.color - a.color)) / inverseW;
+                uint32_t packed = packColor(color);
+                for (int across = first; across < first + line.width; across++) {
+                    int x = xMajor ? step : across;
+                    int y = xMajor ? across : step;
+                    if (x < x0 || x > x1 || y < y0 || y > y1) {
+                        continue;
+                    }
+                    float &stored = depths[y * stride + x];
+                    if (!depthPasses(line.depthFunc, depth, stored)) {
+                        continue;
+                    }
+                    if (line.depthWrite) {
+                        stored = depth;
+                    }
+                    colors[y * stride + x] = packed;
+                    fragments++;
+                }
+            }
+        }
+    }
+
+    SoftwareRenderer::SoftwareRenderer(int width, int height)
+        : imageWidth(width), imageHeight(height), rowStride((width + 3) & ~3),
+          tilesX((width + TILE_SIZE - 1) / TILE_SIZE), tilesY((height + TILE_SIZE - 1) / TILE_SIZE) {
+        colors.assign((size_t) rowStride * height, 0);
+        depths.assign((size_t) rowStride * height, 1.0f);
+    }
+
+    void SoftwareRenderer::setVertexArray(GLuint vertexArray, const SoftMesh *mesh) {
+        for (size_t i = 0; i < vertexArrays.size(); i++) {
+            if (vertexArrays[i].first == vertexArray) {
+                vertexArrays[i].second = mesh;
+                return;
+            }
+        }
+        vertexArrays.push_back(std::make_pair(vertexArray, mesh));
+    }
+
+    void SoftwareRenderer::setViewProjection(const glm::mat4 &view, const glm::mat4 &projection) {
+        viewProjection = projection * view;
+    }
+
+    void SoftwareRenderer::clear(const glm::vec4 &color) {
+        std::fill(colors.begin(), colors.end(), _internal::packColor(color));
+        std::fill(depths.begin(), depths.end(), 1.0f);
+    }
+
+    void SoftwareRenderer::submit(const DrawPacket &packet) {
+        const SoftMesh *mesh = nullptr;
+        for (size_t i = 0; i < vertexArrays.size(); i++) {
+            if (vertexArrays[i].first == packet.vao) {
+                mesh = vertexArrays[i].second;
+            }
+        }
+        if (mesh == nullptr) {
+            fprintf(stderr, "WARNING: No software geometry for VAO %u, draw skipped.\n", packet.vao);
+            return;
+        }
+        if (packet.mode != GL_TRIANGLES && packet.mode != GL_LINES) {
+            fprintf(stderr, "WARNING: Software rendering only draws GL_TRIANGLES and GL_LINES.\n");
+            return;
+        }
+
+        if (primitiveStarts.empty()) {
+            primitiveStarts.push_back(0);
+        }
+        size_t primitives = packet.count / (packet.mode == GL_TRIANGLES ? 3 : 2);
+        packets.push_back(packet);
+        packetMeshes.push_back(mesh);
+        packetTransforms.push_back(viewProjection * packet.model);
+        primitiveStarts.push_back(primitiveStarts.back() + primitives);
+    }
+
+    _internal::SoftVertex SoftwareRenderer::toWindow(const glm::vec4 &clip, const glm::vec4 &color) const {
+        _internal::SoftVertex vertex;
+        vertex.inverseW = 1.0f / clip.w;
+        vertex.x = (clip.x * vertex.inverseW * 0.5f + 0.5f) * imageWidth;
+        vertex.y = (clip.y * vertex.inverseW * 0.5f + 0.5f) * imageHeight;
+        vertex.z = clip.z * vertex.inverseW * 0.5f + 0.5f;
+        vertex.color = color * vertex.inverseW;
+        return vertex;
+    }
+
+    void SoftwareRenderer::setupRange(size_t begin, size_t end, Bin &bin) const {
+        size_t p = std::upper_bound(primitiveStarts.begin(), primitiveStarts.end(), begin) - primitiveStarts.begin() - 1;
+        for (size_t i = begin; i < end; i++) {
+            while (i >= primitiveStarts[p + 1]) {
+                p++;
+            }
+            const DrawPacket &packet = packets[p];
+            const SoftMesh &mesh = *packetMeshes[p];
+            int corners = packet.mode == GL_TRIANGLES ? 3 : 2;
+            size_t first = packet.indexed ? packet.first / sizeof(uint32_t) : packet.first;
+            first += (i - primitiveStarts[p]) * corners;
+
+            glm::vec4 clip[3], vertexColors[3];
+            bool valid = true;
+            for (int k = 0; k < corners; k++) {
+                size_t index = packet.indexed ? (first + k < mesh.indices.size() ? mesh.indices[first + k] + packet.baseVertex : (size_t) -1) : first + k;
+                if (index >= mesh.positions.size()) {
+                    valid = false;
+                    break;
+                }
+                clip[k] = packetTransforms[p] * mesh.positions[index];
+                if (packet.flag != 0) {
+                    vertexColors[k] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+                } else {
+                    vertexColors[k] = index < mesh.colors.size() ? mesh.colors[index] : defaultColor;
+                }
+            }
+            if (!valid) {
+                continue;
+            }
+            if (corners == 3) {
+                addTriangle(clip, vertexColors, packet, bin);
+            } else {
+                addLine(clip, vertexColors, packet, bin);
+            }
+        }
+    }
+
+    void SoftwareRenderer::addTriangle(const glm::vec4 *clip, const glm::vec4 *vertexColors, const DrawPacket &packet, Bin &bin) const {
+        bin.stats.triangles++;
+
+        // Clips against the near plane (z >= -w); the rest of the frustum
+        // is handled by the bounds of the triangle in the window.
+        glm::vec4 polygon[4], polygonColors[4];
+        int count = 0;
+        for (int k = 0; k < 3; k++) {
+            int next = (k + 1) % 3;
+            float d0 = clip[k].z + clip[k].w;
+            float d1 = clip[next].z + clip[next].w;
+            if (d0 >= 0.0f) {
+                polygon[count] = clip[k];
+                polygonColors[count++] = vertexColors[k];
+            }
+            if ((d0 >= 0.0f) != (d1 >= 0.0f)) {
+                float t = d0 / (d0 - d1);
+                polygon[count] = clip[k] + t * (clip[next] - clip[k]);
+                polygonColors[count++] = vertexColors[k] + t * (vertexColors[next] - vertexColors[k]);
+            }
+        }
+
+        bool drawn = false;
+        for (int k = 1; k + 1 < count; k++) {
+            _internal::SoftVertex vertices[3] = {
+                toWindow(polygon[0], polygonColors[0]),
+                toWindow(polygon[k], polygonColors[k]),
+                toWindow(polygon[k + 1], polygonColors[k + 1]),
+            };
+            drawn = setupTriangle(vertices, packet, bin) || drawn;
+        }
+        if (!drawn) {
+            bin.stats.trianglesCulled++;
+        }
+    }
+
+    bool SoftwareRenderer::setupTriangle(const _internal::SoftVertex *vertices, const DrawPacket &packet, Bin &bin) const {
+        using namespace _internal;
+        float x[3], y[3];
+        int order[3] = {0, 1, 2};
+        float area = (vertices[1].x - vertices[0].x) * (vertices[2].y - vertices[0].y) -
+                     (vertices[2].x - vertices[0].x) * (vertices[1].y - vertices[0].y);
+        if (!(area != 0.0f) || std::isinf(area)) {
+            return false;
+        }
+        if (area < 0.0f) {
+            if (cullFace) {
+                return false;
+            }
+            std::swap(order[1], order[2]);
+            area = -area;
+        }
+        for (int k = 0; k < 3; k++) {
+            x[k] = vertices[order[k]].x;
+            y[k] = vertices[order[k]].y;
+        }
+
+        // Pixels whose centers can be inside
+        float minX = std::max(std::ceil(std::min(std::min(x[0], x[1]), x[2]) - 0.5f), 0.0f);
+        float maxX = std::min(std::floor(std::max(std::max(x[0], x[1]), x[2]) - 0.5f), imageWidth - 1.0f);
+        float minY = std::max(std::ceil(std::min(std::min(y[0], y[1]), y[2]) - 0.5f), 0.0f);
+        float maxY = std::min(std::floor(std::max(std::max(y[0], y[1]), y[2]) - 0.5f), imageHeight - 1.0f);
+        if (minX > maxX || minY > maxY) {
+            return false;
+        }
+
+        SoftTriangle triangle;
+        triangle.minX = (int) minX;
+        triangle.maxX = (int) maxX;
+        triangle.minY = (int) minY;
+        triangle.maxY = (int) maxY;
+        for (int e = 0; e < 3; e++) {
+            int next = (e + 1) % 3;
+            triangle.edgeA[e] = y[e] - y[next];
+            triangle.edgeB[e] = x[next] - x[e];
+            triangle.edgeC[e] = x[e] * y[next] - x[next] * y[e];
+            // Counter-clockwise with y up: the inside is right of left
+            // edges and below top edges.
+            bool topLeft = triangle.edgeA[e] > 0.0f || (triangle.edgeA[e] == 0.0f && triangle.edgeB[e] < 0.0f);
+            triangle.edgeBias[e] = topLeft ? 0.0f : std::numeric_limits<float>::denorm_min();
+        }
+
+        float values[3];
+        for (int k = 0; k < 3; k++) {
+            values[k] = vertices[order[k]].z;
+        }
+        plane(x, y, values, area, triangle.depth);
+        for (int k = 0; k < 3; k++) {
+            values[k] = vertices[order[k]].inverseW;
+        }
+        plane(x, y, values, area, triangle.inverseW);
+        for (int c = 0; c < 4; c++) {
+            for (int k = 0; k < 3; k++) {
+                values[k] = vertices[order[k]].color[c];
+            }
+            plane(x, y, values, area, triangle.color[c]);
+        }
+        triangle.depthFunc = packet.depthFunc;
+        triangle.depthWrite = packet.depthWrite;
+
+        // Binned into the tiles its bounds touch, except those entirely
+        // outside one of its edges.
+        uint32_t index = (uint32_t) bin.triangles.size();
+        bin.triangles.push_back(triangle);
+        for (int ty = triangle.minY / TILE_SIZE; ty <= triangle.maxY / TILE_SIZE; ty++) {
+            float y0 = ty * TILE_SIZE + 0.5f;
+            float y1 = y0 + (TILE_SIZE - 1);
+            for (int tx = triangle.minX / TILE_SIZE; tx <= triangle.maxX / TILE_SIZE; tx++) {
+                float x0 = tx * TILE_SIZE + 0.5f;
+                float x1 = x0 + (TILE_SIZE - 1);
+                bool outside = false;
+                for (int e = 0; e < 3 && !outside; e++) {
+                    float a = triangle.edgeA[e], b = triangle.edgeB[e];
+                    outside = a * (a > 0.0f ? x1 : x0) + b * (b > 0.0f ? y1 : y0) + triangle.edgeC[e] < 0.0f;
+                }
+                if (!outside) {
+                    bin.tiles[ty * tilesX + tx].push_back(index);
+                    bin.stats.binnedPrimitives++;
+                }
+            }
+        }
+        return true;
+    }
+
+    void SoftwareRenderer::addLine(const glm::vec4 *clip, const glm::vec4 *vertexColors, const DrawPacket &packet, Bin &bin) const {
+        bin.stats.lines++;
+        float d0 = clip[0].z + clip[0].w;
+        float d1 = clip[1].z + clip[1].w;
+        if (d0 < 0.0f && d1 < 0.0f) {
+            return;
+        }
+        glm::vec4 ends[2] = {clip[0], clip[1]};
+        glm::vec4 endColors[2] = {vertexColors[0], vertexColors[1]};
+        if (d0 < 0.0f || d1 < 0.0f) {
+            float t = d0 / (d0 - d1);
+            int behind = d0 < 0.0f ? 0 : 1;
+            ends[behind] = clip[0] + t * (clip[1] - clip[0]);
+            endColors[behind] = vertexColors[0] + t * (vertexColors[1] - vertexColors[0]);
+        }
+
+        _internal::SoftLine line;
+        line.ends[0] = toWindow(ends[0], endColors[0]);
+        line.ends[1] = toWindow(ends[1], endColors[1]);
+        line.width = std::max(1, (int) (packet.lineWidth + 0.5f));
+        line.depthFunc = packet.depthFunc;
+        line.depthWrite = packet.depthWrite;
+        float reach = line.width * 0.5f + 1.0f;
+        float minX = std::max(std::min(line.ends[0].x, line.ends[1].x) - reach, 0.0f);
+        float maxX = std::min(std::max(line.ends[0].x, line.ends[1].x) + reach, imageWidth - 1.0f);
+        float minY = std::max(std::min(line.ends[0].y, line.ends[1].y) - reach, 0.0f);
+        float maxY = std::min(std::max(line.ends[0].y, line.ends[1].y) + reach, imageHeight - 1.0f);
+        if (minX > maxX || minY > maxY) {
+            return;
+        }
+        line.minX = (int) minX;
+        line.maxX = (int) maxX;
+        line.minY = (int) minY;
+        line.maxY = (int) maxY;
+
+        uint32_t index = (uint32_t) bin.lines.size() | _internal::LINE_BIT;
+        bin.lines.push_back(line);
+        for (int ty = line.minY / TILE_SIZE; ty <= line.maxY / TILE_SIZE; ty++) {
+            for (int tx = line.minX / TILE_SIZE; tx <= line.maxX / TILE_SIZE; tx++) {
+                bin.tiles[ty * tilesX + tx].push_back(index);
+                bin.stats.binnedPrimitives++;
+            }
+        }
+    }
+
+    void SoftwareRenderer::rasterizeTile(int tile, size_t &fragments) {
+        int tileX0 = (tile % tilesX) * TILE_SIZE;
+        int tileY0 = (tile / tilesX) * TILE_SIZE;
+        int tileX1 = std::min(tileX0 + TILE_SIZE, imageWidth) - 1;
+        int tileY1 = std::min(tileY0 + TILE_SIZE, imageHeight) - 1;
+
+        // Bins hold consecutive ranges of primitives, so this is
+        // submission order.
+        for (size_t b = 0; b < bins.size(); b++) {
+            const std::vector<uint32_t> &primitives = bins[b].tiles[tile];
+            for (size_t i = 0; i < primitives.size(); i++) {
+                if (primitives[i] & _internal::LINE_BIT) {
+                    _internal::rasterizeLine(bins[b].lines[primitives[i] & ~_internal::LINE_BIT], tileX0, tileY0, tileX1, tileY1,
+                                             colors.data(), depths.data(), rowStride, fragments);
+                    continue;
+                }
+                const _internal::SoftTriangle &triangle = bins[b].triangles[primitives[i]];
+                int x0 = std::max(triangle.minX, tileX0);
+                int x1 = std::min(triangle.maxX, tileX1);
+                int y0 = std::max(triangle.minY, tileY0);
+                int y1 = std::min(triangle.maxY, tileY1);
+#ifdef SIMD_X86
+                // Whole groups of 4: the row stride is padded and tiles
+                // start at multiples of 4, so the extra pixels are either
+                // outside the triangle or the padding.
+                _internal::rasterizeTriangleSse(triangle, x0 & ~3, y0, x1, y1, colors.data(), depths.data(), rowStride, fragments);
+#else
+                _internal::rasterizeTriangleScalar(triangle, x0, y0, x1, y1, colors.data(), depths.data(), rowStride, fragments);
+#endif
+            }
+        }
+    }
+
+    void SoftwareRenderer::execute(unsigned threads) {
+        if (threads == 0) {
+            threads = parallel::threadCount();
+        }
+        stats = Statistics();
+        stats.draws = packets.size();
+        size_t primitiveCount = primitiveStarts.empty() ? 0 : primitiveStarts.back();
+
+        bins.resize(threads);
+        for (size_t b = 0; b < bins.size(); b++) {
+            bins[b].triangles.clear();
+            bins[b].lines.clear();
+            bins[b].tiles.resize(tilesX * tilesY);
+            for (size_t t = 0; t < bins[b].tiles.size(); t++) {
+                bins[b].tiles[t].clear();
+            }
+            bins[b].stats = Statistics();
+        }
+
+        parallel::framePool().forChunks(primitiveCount, threads, [&](size_t chunk, size_t begin, size_t end) {
+            setupRange(begin, end, bins[chunk]);
+        });
+
+        // Tiles are dealt in turns: the busy middle of the screen is
+        // shared by every thread.
+        std::vector<size_t> fragments(threads, 0);
+        size_t tileCount = (size_t) tilesX * tilesY;
+        parallel::framePool().forChunks((size_t) threads, threads, [&](size_t chunk, size_t, size_t) {
+            for (size_t tile = chunk; tile < tileCount; tile += threads) {
+                rasterizeTile((int) tile, fragments[chunk]);
+            }
+        });
+
+        for (size_t b = 0; b < bins.size(); b++) {
+            stats.triangles += bins[b].stats.triangles;
+            stats.trianglesCulled += bins[b].stats.trianglesCulled;
+            stats.lines += bins[b].stats.lines;
+            stats.binnedPrimitives += bins[b].stats.binnedPrimitives;
+            stats.fragments += fragments[b];
+        }
+
+        packets.clear();
+        packetMeshes.clear();
+        packetTransforms.clear();
+        primitiveStarts.clear();
+    }
+
+    bool SoftwareRenderer::writePpm(const std::string &path) const {
+        char header[64];
+        int headerSize = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", imageWidth, imageHeight);
+        std::vector<unsigned char> contents(header, header + headerSize);
+        contents.reserve(headerSize + (size_t) imageWidth * imageHeight * 3);
+        for (int y = imageHeight - 1; y >= 0; y--) {
+            for (int x = 0; x < imageWidth; x++) {
+                uint32_t pixel = colors[y * rowStride + x];
+                contents.push_back((unsigned char) pixel);
+                contents.push_back((unsigned char) (pixel >> 8));
+                contents.push_back((unsigned char) (pixel >> 16));
+            }
+        }
+        return platform::writeFile(path, contents.data(), contents.size());
+    }
+
+    bool SoftwareRenderer::compareWithPpm(const std::string &path, int tolerance, size_t &differentPixels) const {
+        std::string contents;
+        if (!platform::readFile(path, contents)) {
+            return false;
+        }
+        int fileWidth = 0, fileHeight = 0, maxValue = 0, headerSize = 0;
+        if (sscanf(contents.c_str(), "P6 %d %d %d%n", &fileWidth, &fileHeight, &maxValue, &headerSize) != 3 ||
+            fileWidth != imageWidth || fileHeight != imageHeight || maxValue != 255) {
+            fprintf(stderr, "ERROR: \"%s\" is not a %dx%d PPM image.\n", path.c_str(), imageWidth, imageHeight);
+            return false;
+        }
+        // A single whitespace separates the header from the pixels.
+        headerSize++;
+        if (contents.size() < (size_t) headerSize + (size_t) imageWidth * imageHeight * 3) {
+            fprintf(stderr, "ERROR: \"%s\" is truncated.\n", path.c_str());
+            return false;
+        }
+
+        const unsigned char *expected = (const unsigned char *) contents.data() + headerSize;
+        differentPixels = 0;
+        for (int y = imageHeight - 1; y >= 0; y--) {
+            for (int x = 0; x < imageWidth; x++, expected += 3) {
+                uint32_t pixel = colors[y * rowStride + x];
+                bool different = false;
+                for (int c = 0; c < 3; c++) {
+                    different = different || std::abs((int) ((pixel >> (8 * c)) & 0xFF) - expected[c]) > tolerance;
+                }
+                differentPixels += different;
+            }
+        }
+        return true;
+    }
+}
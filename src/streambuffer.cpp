@@ -0,0 +1,147 @@
+#include "streambuffer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "glext.h"
+#include "glstate.h"
+
+namespace game {
+    void StreamBuffer::init(size_t regionSize) {
+        this->regionSize = regionSize;
+        this->region = 0;
+        this->head = 0;
+
+        glGenBuffers(1, &buffer_id);
+        glState.bindBuffer(GL_ARRAY_BUFFER, buffer_id);
+
+        if (glext::bufferStorage) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            GLsizeiptr size = (GLsizeiptr) (regionSize * STREAM_REGIONS);
+            glext::BufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+            persistent = (uint8_t *) glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        }
+
+        if (persistent == nullptr) {
+            // A buffer created through glBufferStorage() is immutable, so
+            // start over with a fresh name.
+            if (glext::bufferStorage) {
+                glState.forgetBuffer(buffer_id);
+                glDeleteBuffers(1, &buffer_id);
+                glGenBuffers(1, &buffer_id);
+                glState.bindBuffer(GL_ARRAY_BUFFER, buffer_id);
+            }
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) regionSize, nullptr, GL_STREAM_DRAW);
+            orphaned = true;
+        }
+
+        printf("Stream buffer: %zu KiB per frame, %s\n", regionSize / 1024,
+               persistent ? "persistent mapping" : "orphaning");
+    }
+
+    void StreamBuffer::destroy() {
+        for (int i = 0; i < STREAM_REGIONS; i++) {
+            if (fences[i]) {
+                glDeleteSync(fences[i]);
+                fences[i] = nullptr;
+            }
+        }
+        if (persistent != nullptr || mapped) {
+            glState.bindBuffer(GL_ARRAY_BUFFER, buffer_id);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            persistent = nullptr;
+            mapped = false;
+        }
+        glState.forgetBuffer(buffer_id);
+        glDeleteBuffers(1, &buffer_id);
+        buffer_id = 0;
+    }
+
+    void StreamBuffer::waitRegion(int index) {
+        if (!fences[index]) {
+            return;
+        }
+
+        // Polling first avoids flushing when the GPU is already done.
+        GLenum status = glClientWaitSync(fences[index], 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            stalls += 1;
+            do {
+                status = glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            } while (status == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fences[index]);
+        fences[index] = nullptr;
+    }
+
+    void StreamBuffer::nextRegion() {
+        commit();
+        if (persistent != nullptr) {
+            if (fences[region]) {
+                glDeleteSync(fences[region]);
+            }
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            region = (region + 1) % STREAM_REGIONS;
+        } else {
+            orphaned = false;
+        }
+        head = 0;
+    }
+
+    void *StreamBuffer::allocate(size_t size, size_t alignment, GLintptr &offset) {
+        if (size == 0) {
+            // Mapping an empty range is an error.
+            return nullptr;
+        }
+
+        // The frame's draws run in RenderQueue::execute(), after every
+        // allocation, so the region cannot be closed (fenced or orphaned)
+        // before endFrame(): what does not fit is dropped.
+        size_t start = (head + alignment - 1) / alignment * alignment;
+        if (start + size > regionSize) {
+            if (overflows++ == 0) {
+                fprintf(stderr, "ERROR: Stream allocation of %zu bytes does not fit the %zu bytes left this frame.\n",
+                        size, regionSize - std::min(head, regionSize));
+            }
+            return nullptr;
+        }
+        head = start + size;
+
+        if (persistent != nullptr) {
+            if (start == 0) {
+                waitRegion(region);
+            }
+            offset = (GLintptr) (region * regionSize + start);
+            return persistent + offset;
+        }
+
+        glState.bindBuffer(GL_ARRAY_BUFFER, buffer_id);
+        if (!orphaned) {
+            // Give the driver a fresh storage; the old one lives until the
+            // GPU is done with it.
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) regionSize, nullptr, GL_STREAM_DRAW);
+            orphaned = true;
+        }
+        if (mapped) {
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        offset = (GLintptr) start;
+        void *pointer = glMapBufferRange(GL_ARRAY_BUFFER, offset, (GLsizeiptr) size,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        mapped = pointer != nullptr;
+        return pointer;
+    }
+
+    void StreamBuffer::commit() {
+        if (!mapped) {
+            return;
+        }
+        glState.bindBuffer(GL_ARRAY_BUFFER, buffer_id);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        mapped = false;
+    }
+
+    void StreamBuffer::endFrame() {
+        nextRegion();
+    }
+}
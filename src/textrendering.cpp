@@ -10,8 +10,14 @@
 
 #include "utils.h"
 #include "dejavufont.h"
+#include "programcache.h"
+#include "streambuffer.h"
+#include "glstate.h"
+#include "renderqueue.h"
 
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+extern game::ProgramCache g_ProgramCache; // Definido em main.cpp
+extern game::StreamBuffer g_StreamBuffer; // Definido em main.cpp
+extern game::RenderQueue g_RenderQueue;   // Definido em main.cpp
 
 const GLchar* const textvertexshader_source = ""
 "#version 330\n"
@@ -35,63 +41,15 @@ const GLchar* const textfragmentshader_source = ""
 "}\n"
 "\0";
 
-void TextRendering_LoadShader(const GLchar* const shader_string, GLuint shader_id)
-{
-    // Define o código do shader, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, NULL);
-
-    // Compila o código do shader (em tempo de execução)
-    glCompileShader(shader_id);
-
-    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
-    GLint compiled_ok;
-    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
-
-    GLint log_length = 0;
-    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
-
-    // Alocamos memória para guardar o log de compilação.
-    // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-    GLchar* log = new GLchar[log_length];
-    glGetShaderInfoLog(shader_id, log_length, &log_length, log);
-
-    // Imprime no terminal qualquer erro ou "warning" de compilação
-    if ( log_length != 0 )
-    {
-        std::string  output;
-
-        if ( !compiled_ok )
-        {
-            output += "ERROR: OpenGL compilation failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-        else
-        {
-            output += "ERROR: OpenGL compilation failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-
-        fprintf(stderr, "%s", output.c_str());
-    }
-
-    // A chamada "delete" em C++ é equivalente ao "free()" do C
-    delete [] log;
-}
-
 GLuint textVAO;
-GLuint textVBO;
-GLuint textprogram_id;
+GLuint textprogram_id = 0;
 GLuint texttexture_id;
+game::PendingProgram textprogram;
 
 void TextRendering_Init()
 {
     GLuint sampler;
 
-    glGenBuffers(1, &textVBO);
     glGenVertexArrays(1, &textVAO);
     glGenTextures(1, &texttexture_id);
     glGenSamplers(1, &sampler);
@@ -101,20 +59,9 @@ void TextRendering_Init()
     glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glCheckError();
 
-    GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
-    TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
-    glCheckError();
-
-    GLuint textfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    TextRendering_LoadShader(textfragmentshader_source, textfragmentshader_id);
-    glCheckError();
-
-    textprogram_id = CreateGpuProgram(textvertexshader_id, textfragmentshader_id);
-    glLinkProgram(textprogram_id);
-    glCheckError();
-
-    GLuint texttex_uniform;
-    texttex_uniform = glGetUniformLocation(textprogram_id, "tex");
+    // The program compiles in the background while the font is uploaded and
+    // the rest of the scene loads; see TextRendering_ProgramReady().
+    textprogram = g_ProgramCache.begin("text", textvertexshader_source, textfragmentshader_source);
     glCheckError();
 
     glActiveTexture(GL_TEXTURE0);
@@ -125,35 +72,67 @@ void TextRendering_Init()
 
     glBindVertexArray(textVAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    // Glyph quads are written into the shared stream buffer every frame; the
+    // draw call picks them through its "first" vertex.
+    glBindBuffer(GL_ARRAY_BUFFER, g_StreamBuffer.buffer());
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
     glCheckError();
 
-    glUseProgram(textprogram_id);
-    glUniform1i(texttex_uniform, 0);
-    glUseProgram(0);
-    glCheckError();
-
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     glCheckError();
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // The calls above bypassed the state tracker.
+    game::glState.invalidate();
+
+}
+
+// Collects the text program once the driver has finished it. Until then
+// text is skipped, so frames never wait on the compiler; without
+// GL_KHR_parallel_shader_compile the first call blocks in finish().
+bool TextRendering_ProgramReady()
+{
+    if (textprogram_id != 0) {
+        return true;
+    }
+    if (!g_ProgramCache.isReady(textprogram)) {
+        return false;
+    }
+
+    textprogram_id = g_ProgramCache.finish(textprogram);
+    GLuint texttex_uniform = glGetUniformLocation(textprogram_id, "tex");
+    game::glState.useProgram(textprogram_id);
+    glUniform1i(texttex_uniform, 0);
+    glCheckError();
+    return true;
 }
 
 float textscale = 1.5f;
 
 void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
 {
+    if (!TextRendering_ProgramReady()) {
+        return;
+    }
+
     scale *= textscale;
     int width, height;
     glfwGetWindowSize(window, &width, &height);
     float sx = scale / width;
     float sy = scale / height;
 
+    struct TextVertex {float x, y, s, t;};
+    const size_t vertex_size = sizeof(TextVertex);
+
+    // All glyphs of the string go into one allocation and one draw call.
+    GLintptr offset;
+    TextVertex *data = (TextVertex *) g_StreamBuffer.allocate(6 * str.size() * vertex_size, vertex_size, offset);
+    if (!data) {
+        return;
+    }
+
+    GLsizei vertex_count = 0;
     for (size_t i = 0; i < str.size(); i++)
     {
         // Find the glyph for the character we are looking for
@@ -180,34 +159,36 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
         float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
         float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
 
-        struct {float x, y, s, t;} data[6] = {
-            { x0, y0, s0, t0 },
-            { x0, y1, s0, t1 },
-            { x1, y1, s1, t1 },
-            { x0, y0, s0, t0 },
-            { x1, y1, s1, t1 },
-            { x1, y0, s1, t0 }
-        };
-
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDepthFunc(GL_ALWAYS);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        glUseProgram(textprogram_id);
-        glBindVertexArray(textVAO);
-        glBindTexture(GL_TEXTURE_2D, texttexture_id);
-
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        glBindVertexArray(0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glUseProgram(0);
-        glDepthFunc(GL_LESS);
+        TextVertex *quad = data + vertex_count;
+        quad[0] = { x0, y0, s0, t0 };
+        quad[1] = { x0, y1, s0, t1 };
+        quad[2] = { x1, y1, s1, t1 };
+        quad[3] = { x0, y0, s0, t0 };
+        quad[4] = { x1, y1, s1, t1 };
+        quad[5] = { x1, y0, s1, t0 };
+        vertex_count += 6;
 
         x += (glyph->advance_x * sx);
     }
+    g_StreamBuffer.commit();
+
+    if (vertex_count == 0) {
+        return;
+    }
+
+    // Text is drawn on top of everything, in the order it was printed.
+    game::DrawPacket packet;
+    packet.program = textprogram_id;
+    packet.vao = textVAO;
+    packet.texture = texttexture_id;
+    packet.depthFunc = GL_ALWAYS;
+    packet.depthWrite = false;
+    packet.blend = game::BLEND_ALPHA;
+    packet.mode = GL_TRIANGLES;
+    packet.indexed = false;
+    packet.first = offset / vertex_size;
+    packet.count = vertex_count;
+    g_RenderQueue.submit(packet, game::LAYER_OVERLAY);
 }
 
 float TextRendering_LineHeight(GLFWwindow* window)
@@ -0,0 +1,177 @@
+#include "vertexformat.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "glad/glad.h"
+
+namespace mesh {
+    namespace _internal {
+        inline float clampf(float value, float low, float high) {
+            return value < low ? low : (value > high ? high : value);
+        }
+    }
+
+    size_t attributeSize(uint32_t components, AttributeFormat format) {
+        switch (format) {
+            case FORMAT_FLOAT: return components * 4;
+            case FORMAT_HALF: return components * 2;
+            case FORMAT_UNORM16: return components * 2;
+            case FORMAT_SNORM10: return 4;
+            case FORMAT_UNORM8: return components;
+        }
+        return 0;
+    }
+
+    void addAttribute(VertexLayout &layout, uint32_t location, uint32_t components, AttributeFormat format) {
+        VertexAttribute &attribute = layout.attributes[layout.attributeCount++];
+        attribute.location = location;
+        attribute.components = components;
+        attribute.normalized = GL_FALSE;
+        attribute.format = format;
+        switch (format) {
+            case FORMAT_FLOAT: attribute.type = GL_FLOAT; break;
+            case FORMAT_HALF: attribute.type = GL_HALF_FLOAT; break;
+            case FORMAT_UNORM16: attribute.type = GL_UNSIGNED_SHORT; attribute.normalized = GL_TRUE; break;
+            case FORMAT_SNORM10:
+                // The packed type is only accepted with 4 components.
+                attribute.type = GL_INT_2_10_10_10_REV;
+                attribute.components = 4;
+                attribute.normalized = GL_TRUE;
+                break;
+            case FORMAT_UNORM8: attribute.type = GL_UNSIGNED_BYTE; attribute.normalized = GL_TRUE; break;
+        }
+        attribute.offset = layout.stride;
+        layout.stride += (uint32_t) ((attributeSize(components, format) + 3) & ~(size_t) 3);
+    }
+
+    uint16_t packHalf(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint16_t sign = (uint16_t) ((bits >> 16) & 0x8000);
+        uint32_t floatExponent = (bits >> 23) & 0xff;
+        uint32_t mantissa = bits & 0x7fffff;
+
+        if (floatExponent == 0xff) {
+            return sign | 0x7c00 | (mantissa ? 0x200 : 0); // Inf, NaN
+        }
+        int32_t exponent = (int32_t) floatExponent - 127 + 15;
+        if (exponent >= 31) {
+            return sign | 0x7c00; // Too large: infinity
+        }
+        if (exponent <= 0) {
+            // Subnormal half (or zero).
+            if (exponent < -10) {
+                return sign;
+            }
+            mantissa |= 0x800000;
+            uint32_t shift = (uint32_t) (14 - exponent);
+            uint32_t half = mantissa >> shift;
+            if ((mantissa >> (shift - 1)) & 1) {
+                half++;
+            }
+            return sign | (uint16_t) half;
+        }
+        uint32_t half = ((uint32_t) exponent << 10) | (mantissa >> 13);
+        // Rounds to nearest; a carry correctly bumps the exponent.
+        if (mantissa & 0x1000) {
+            half++;
+        }
+        return sign | (uint16_t) half;
+    }
+
+    float unpackHalf(uint16_t value) {
+        uint32_t sign = (uint32_t) (value & 0x8000) << 16;
+        uint32_t exponent = (value >> 10) & 0x1f;
+        uint32_t mantissa = value & 0x3ff;
+
+        uint32_t bits;
+        if (exponent == 0) {
+            float result = ldexpf((float) mantissa, -24);
+            return sign ? -result : result;
+        } else if (exponent == 31) {
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        } else {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    void packAttribute(void *destination, const float *values, uint32_t components, AttributeFormat format) {
+        using _internal::clampf;
+        switch (format) {
+            case FORMAT_FLOAT:
+                memcpy(destination, values, components * sizeof(float));
+                break;
+            case FORMAT_HALF: {
+                uint16_t *out = (uint16_t *) destination;
+                for (uint32_t i = 0; i < components; i++) out[i] = packHalf(values[i]);
+                break;
+            }
+            case FORMAT_UNORM16: {
+                uint16_t *out = (uint16_t *) destination;
+                for (uint32_t i = 0; i < components; i++) out[i] = (uint16_t) lrintf(clampf(values[i], 0.0f, 1.0f) * 65535.0f);
+                break;
+            }
+            case FORMAT_SNORM10: {
+                uint32_t word = 0;
+                for (uint32_t i = 0; i < components && i < 3; i++) {
+                    int32_t v = (int32_t) lrintf(clampf(values[i], -1.0f, 1.0f) * 511.0f);
+                    word |= ((uint32_t) v & 0x3ff) << (10 * i);
+                }
+                memcpy(destination, &word, sizeof(word));
+                break;
+            }
+            case FORMAT_UNORM8: {
+                uint8_t *out = (uint8_t *) destination;
+                for (uint32_t i = 0; i < components; i++) out[i] = (uint8_t) lrintf(clampf(values[i], 0.0f, 1.0f) * 255.0f);
+                break;
+            }
+        }
+    }
+
+    void unpackAttribute(const void *source, float *values, uint32_t components, AttributeFormat format) {
+        switch (format) {
+            case FORMAT_FLOAT:
+                memcpy(values, source, components * sizeof(float));
+                break;
+            case FORMAT_HALF: {
+                const uint16_t *in = (const uint16_t *) source;
+                for (uint32_t i = 0; i < components; i++) values[i] = unpackHalf(in[i]);
+                break;
+            }
+            case FORMAT_UNORM16: {
+                const uint16_t *in = (const uint16_t *) source;
+                for (uint32_t i = 0; i < components; i++) values[i] = in[i] / 65535.0f;
+                break;
+            }
+            case FORMAT_SNORM10: {
+                uint32_t word;
+                memcpy(&word, source, sizeof(word));
+                for (uint32_t i = 0; i < components && i < 3; i++) {
+                    // Sign-extends the 10-bit field.
+                    int32_t v = (int32_t) (word << (22 - 10 * i)) >> 22;
+                    values[i] = v < -511 ? -1.0f : v / 511.0f;
+                }
+                break;
+            }
+            case FORMAT_UNORM8: {
+                const uint8_t *in = (const uint8_t *) source;
+                for (uint32_t i = 0; i < components; i++) values[i] = in[i] / 255.0f;
+                break;
+            }
+        }
+    }
+
+    void applyLayout(const VertexLayout &layout, size_t baseOffset) {
+        for (uint32_t i = 0; i < layout.attributeCount; i++) {
+            const VertexAttribute &attribute = layout.attributes[i];
+            glVertexAttribPointer(attribute.location, attribute.components, attribute.type,
+                                  attribute.normalized ? GL_TRUE : GL_FALSE, layout.stride,
+                                  (void *) (baseOffset + attribute.offset));
+            glEnableVertexAttribArray(attribute.location);
+        }
+    }
+}